@@ -141,12 +141,13 @@ syntax match vifmHiGroups contained
 		\ "column:\(ext\|name\|size\|atime\|ctime\|mtime\|iname\|dir\|type\|fileext\|nitems\|groups\|target\|root\|fileroot\|gid\|gname\|mode\|uid\|uname\|perms\|nlinks\|inode\)"
 
 " Options
-syntax keyword vifmOption contained aproposprg autocd autochpos caseoptions
-		\ cdpath cd chaselinks classify columns co confirm cf cpoptions cpo
-		\ cvoptions deleteprg dotdirs dotfiles dirsize fastrun fillchars fcs findprg
-		\ followlinks fusehome gdefault grepprg histcursor history hi hloptions
-		\ hlsearch hls iec ignorecase ic iooptions incsearch is laststatus lines
-		\ locateprg ls lsoptions lsview mediaprg milleroptions millerview
+syntax keyword vifmOption contained aproposprg autocd autochpos bgjobs caseoptions
+		\ cdpath cd chaselinks classify columns co confirm cf copyjobs cpoptions cpo
+		\ cvoptions deleteprg dotdirs dotfiles dirsize dirsizecache dirsizewatch
+		\ fastrun fillchars fcs findprg followlinks fusehome gdefault grepprg
+		\ histcursor history hi
+		\ hloptions hlsearch hls iec ignorecase ic iooptions incsearch is laststatus
+		\ lines locateprg ls lsoptions lsview mediaprg milleroptions millerview
 		\ mintimeoutlen mouse navoptions number nu numberwidth nuw previewoptions
 		\ previewprg quickview relativenumber rnu rulerformat ruf runexec scrollbind
 		\ scb scrolloff sessionoptions ssop so sort sortgroups sortorder sortnumbers
@@ -34,12 +34,14 @@
 
 #include <assert.h> /* assert() */
 #include <errno.h> /* errno */
+#include <limits.h> /* INT_MAX */
 #include <stddef.h> /* NULL wchar_t */
 #include <stdint.h> /* uintptr_t */
 #include <stdlib.h> /* EXIT_FAILURE _Exit() free() malloc() */
 #include <string.h> /* strdup() */
 
 #include "cfg/config.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "engine/var.h"
 #include "engine/variables.h"
@@ -48,6 +50,7 @@
 #include "ui/statusline.h"
 #include "ui/ui.h"
 #include "utils/cancellation.h"
+#include "utils/darray.h"
 #include "utils/env.h"
 #include "utils/fs.h"
 #include "utils/log.h"
@@ -56,6 +59,7 @@
 #include "utils/str.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
+#include "event_loop.h"
 #include "status.h"
 
 /**
@@ -73,11 +77,22 @@
  *
  * Operations are displayed on designated job bar.
  *
+ * Tasks and operations are executed by a pool of at most 'bgjobs' threads,
+ * which are started on demand and then wait for more work.  Tasks are picked
+ * before operations, operations can't occupy the last thread of the pool (so
+ * that tasks don't wait for long copies to finish) and only a couple of them
+ * can perform I/O on the same device at the same time.  Operations that copy
+ * several files at once also take a slot of destination device per file, which
+ * limits number of files written to a device by all of them.
+ *
  * On non-Windows systems background thread reads data from error streams of
  * external applications, which are then displayed by main thread.  This thread
  * maintains its own list of jobs (via err_next field), which is added to by
- * building a temporary list with new_err_jobs pointing to its head.  Every job
- * that has associated external process has the following life cycle:
+ * building a temporary list with new_err_jobs pointing to its head.  The thread
+ * sleeps until one of the streams has data or it's woken up via err_selector
+ * because of a change in the set of jobs.  Main thread learns about new errors
+ * and finished jobs via bg_has_events().  Every job that has associated
+ * external process has the following life cycle:
  *  1. Created by main thread and passed to error thread through new_err_jobs.
  *  2. Either gets marked by signal handler or its stream reaches EOF.
  *  3. Its use_count field is decremented.
@@ -102,16 +117,48 @@
 #define NO_JOB_ID INVALID_HANDLE_VALUE
 #endif
 
-/* Structure with passed to background_task_bootstrap() so it can perform
- * correct initialization/cleanup. */
-typedef struct
+/* Maximum number of operations that perform I/O on the same device at the same
+ * time. */
+#define MAX_OPS_PER_DEVICE 2
+
+/* Structure with passed to run_task() so it can perform correct
+ * initialization/cleanup. */
+typedef struct background_task_args
 {
 	bg_task_func func; /* Function to execute in a background thread. */
 	void *args;        /* Argument to pass. */
 	bg_job_t *job;     /* Job identifier that corresponds to the task. */
+	int important;     /* Whether this is an operation rather than a task. */
+	int on_device;     /* Whether dev field is set. */
+	dev_t dev;         /* Device on which the task performs I/O. */
+
+	struct background_task_args *next; /* Next entry of pool's list. */
 }
 background_task_args;
 
+/* State of the pool of threads that execute tasks and operations.  Protected
+ * by pool_lock. */
+typedef struct
+{
+	background_task_args *queue;   /* Tasks waiting for a thread (FIFO). */
+	background_task_args *running; /* Tasks being executed. */
+	int limit;                     /* Maximum number of running tasks. */
+	int workers;                   /* Number of threads in the pool. */
+	int idle;                      /* Number of threads waiting for work. */
+	int queued;                    /* Number of elements in the queue. */
+	int nrunning;                  /* Number of elements in running list. */
+	int nops;                      /* Number of running operations. */
+}
+pool_t;
+
+/* Number of files that are being written to a device. */
+typedef struct
+{
+	dev_t dev; /* The device. */
+	int count; /* Number of files. */
+}
+dev_load_t;
+
 static void set_jobcount_var(int count);
 static void job_check(bg_job_t *job);
 static void job_free(bg_job_t *job);
@@ -132,9 +179,17 @@ static void place_on_job_bar(bg_job_t *job);
 static void get_off_job_bar(bg_job_t *job);
 static bg_job_t * add_background_job(pid_t pid, const char cmd[],
 		uintptr_t err, uintptr_t data, BgJobType type, int with_bg_op);
-static void * background_task_bootstrap(void *arg);
+static int pool_enqueue(background_task_args *task);
+static void * pool_worker(void *arg);
+static background_task_args * pick_task(void);
+static int ops_on_device(dev_t dev);
+static dev_load_t * find_dev_load(dev_t dev);
+static background_task_args * take_task(background_task_args **task);
+static void finish_task(background_task_args *task);
+static void run_task(background_task_args *task);
 static int update_job_status(bg_job_t *job);
 static void mark_job_finished(bg_job_t *job, int exit_code);
+static void report_events(void);
 static int bg_op_cancel(bg_op_t *bg_op);
 
 bg_job_t *bg_jobs = NULL;
@@ -146,9 +201,29 @@ static pthread_mutex_t new_err_jobs_lock = PTHREAD_MUTEX_INITIALIZER;
 /* Conditional variable to signal availability of new jobs in new_err_jobs. */
 static pthread_cond_t new_err_jobs_cond = PTHREAD_COND_INITIALIZER;
 
+/* Selector of error thread, can be used to wake the thread up. */
+static selector_t *err_selector;
+
+/* Whether there are changes in state of jobs that weren't processed by
+ * bg_check() yet.  Accessed atomically. */
+static int has_events;
+
 /* Thread-local storage for bg_job_t associated with active thread. */
 static pthread_key_t current_job;
 
+/* Pool of threads for tasks and operations. */
+static pool_t pool;
+/* Mutex to protect pool. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Conditional variable to signal that there might be tasks to execute. */
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+
+/* Devices with files being written to them.  Protected by pool_lock. */
+static dev_load_t *dev_loads;
+static DA_INSTANCE(dev_loads);
+/* Conditional variable to signal that a device slot was released. */
+static pthread_cond_t dev_cond = PTHREAD_COND_INITIALIZER;
+
 int
 bg_init(void)
 {
@@ -158,18 +233,34 @@ bg_init(void)
 		return 1;
 	}
 
+	err_selector = selector_alloc();
+	if(err_selector == NULL)
+	{
+		return 1;
+	}
+
 	pthread_t id;
-	if(pthread_create(&id, NULL, &error_thread, NULL) != 0)
+	if(pthread_create(&id, NULL, &error_thread, err_selector) != 0)
 	{
+		selector_free(err_selector);
+		err_selector = NULL;
 		return 1;
 	}
 
 	return 0;
 }
 
+int
+bg_has_events(void)
+{
+	return __atomic_load_n(&has_events, __ATOMIC_ACQUIRE);
+}
+
 void
 bg_check(void)
 {
+	__atomic_store_n(&has_events, 0, __ATOMIC_RELEASE);
+
 #ifndef _WIN32
 	rip_children();
 #endif
@@ -413,15 +504,8 @@ bg_and_wait_for_errors(char cmd[], const struct cancellation_t *cancellation)
 static void *
 error_thread(void *p)
 {
-	enum { ERROR_SELECT_TIMEOUT_MS = 250 };
-
 	bg_job_t *jobs = NULL;
-
-	selector_t *selector = selector_alloc();
-	if(selector == NULL)
-	{
-		return NULL;
-	}
+	selector_t *const selector = p;
 
 	(void)pthread_detach(pthread_self());
 	block_all_thread_signals();
@@ -430,9 +514,10 @@ error_thread(void *p)
 	{
 		update_error_jobs(&jobs);
 		make_ready_list(jobs, selector);
-		while(selector_wait(selector, ERROR_SELECT_TIMEOUT_MS))
+		while(selector_wait(selector, /*delay=*/-1))
 		{
 			int need_update_list = (jobs == NULL);
+			int got_data = 0;
 
 			bg_job_t **job = &jobs;
 			while(*job != NULL)
@@ -445,6 +530,7 @@ error_thread(void *p)
 				{
 					goto next_job;
 				}
+				got_data = 1;
 
 #ifndef _WIN32
 				nread = read(j->err_stream, err_msg, sizeof(err_msg) - 1U);
@@ -471,6 +557,7 @@ error_thread(void *p)
 					selector_remove(selector, j->err_stream);
 					*job = j->err_next;
 					bg_job_decref(j);
+					report_events();
 					continue;
 				}
 
@@ -481,6 +568,9 @@ error_thread(void *p)
 				job = &j->err_next;
 			}
 
+			/* Being woken up means that list of jobs needs an update. */
+			need_update_list |= !got_data;
+
 			if(!need_update_list && pthread_mutex_lock(&new_err_jobs_lock) == 0)
 			{
 				need_update_list = (new_err_jobs != NULL);
@@ -493,7 +583,6 @@ error_thread(void *p)
 		}
 	}
 
-	selector_free(selector);
 	return NULL;
 }
 
@@ -647,6 +736,7 @@ append_error_msg(bg_job_t *job, const char err_msg[])
 		(void)strappend(&job->errors, &job->errors_len, err_msg);
 		(void)strappend(&job->new_errors, &job->new_errors_len, err_msg);
 		(void)pthread_spin_unlock(&job->errors_lock);
+		report_events();
 	}
 }
 
@@ -1261,17 +1351,27 @@ int
 bg_execute(const char descr[], const char op_descr[], int total, int important,
 		bg_task_func task_func, void *args)
 {
-	pthread_t id;
-	int ret;
+	return bg_execute_on(NULL, descr, op_descr, total, important, task_func,
+			args);
+}
 
+int
+bg_execute_on(const char io_path[], const char descr[], const char op_descr[],
+		int total, int important, bg_task_func task_func, void *args)
+{
 	background_task_args *const task_args = malloc(sizeof(*task_args));
 	if(task_args == NULL)
 	{
 		return 1;
 	}
 
+	struct stat st;
 	task_args->func = task_func;
 	task_args->args = args;
+	task_args->important = important;
+	task_args->on_device = (io_path != NULL && os_stat(io_path, &st) == 0);
+	task_args->dev = (task_args->on_device ? st.st_dev : 0);
+	task_args->next = NULL;
 	task_args->job = add_background_job(WRONG_PID, descr, (uintptr_t)NO_JOB_ID,
 			(uintptr_t)NO_JOB_ID, important ? BJT_OPERATION : BJT_TASK, 1);
 
@@ -1289,8 +1389,7 @@ bg_execute(const char descr[], const char op_descr[], int total, int important,
 		place_on_job_bar(task_args->job);
 	}
 
-	ret = 0;
-	if(pthread_create(&id, NULL, &background_task_bootstrap, task_args) != 0)
+	if(pool_enqueue(task_args) != 0)
 	{
 		/* Mark job as finished with error. */
 		if(pthread_spin_lock(&task_args->job->status_lock) == 0)
@@ -1301,10 +1400,250 @@ bg_execute(const char descr[], const char op_descr[], int total, int important,
 		}
 
 		free(task_args);
-		ret = 1;
+		return 1;
 	}
 
-	return ret;
+	return 0;
+}
+
+/* Adds task to the queue of the pool starting a new thread if there aren't
+ * enough of them.  Returns zero on success. */
+static int
+pool_enqueue(background_task_args *task)
+{
+	if(pthread_mutex_lock(&pool_lock) != 0)
+	{
+		return 1;
+	}
+
+	pool.limit = (cfg.bg_jobs > 0 ? cfg.bg_jobs : INT_MAX);
+
+	background_task_args **tail = &pool.queue;
+	while(*tail != NULL)
+	{
+		tail = &(*tail)->next;
+	}
+	*tail = task;
+	++pool.queued;
+
+	if(pool.queued > pool.idle && pool.workers < pool.limit)
+	{
+		pthread_t id;
+		if(pthread_create(&id, NULL, &pool_worker, NULL) == 0)
+		{
+			++pool.workers;
+		}
+		else if(pool.workers == 0)
+		{
+			/* Nobody will ever pick up the task. */
+			*tail = NULL;
+			--pool.queued;
+			(void)pthread_mutex_unlock(&pool_lock);
+			return 1;
+		}
+	}
+
+	(void)pthread_cond_signal(&pool_cond);
+	(void)pthread_mutex_unlock(&pool_lock);
+	return 0;
+}
+
+/* pthreads entry point for a thread of the pool.  Executes tasks as they
+ * become available.  Returns result for this thread. */
+static void *
+pool_worker(void *arg)
+{
+	(void)pthread_detach(pthread_self());
+	block_all_thread_signals();
+
+	(void)pthread_mutex_lock(&pool_lock);
+	while(1)
+	{
+		background_task_args *const task = pick_task();
+		if(task == NULL)
+		{
+			++pool.idle;
+			(void)pthread_cond_wait(&pool_cond, &pool_lock);
+			--pool.idle;
+			continue;
+		}
+
+		(void)pthread_mutex_unlock(&pool_lock);
+		run_task(task);
+		(void)pthread_mutex_lock(&pool_lock);
+
+		finish_task(task);
+		free(task);
+
+		/* Completion of the task might allow starting some of the others. */
+		(void)pthread_cond_broadcast(&pool_cond);
+	}
+
+	return NULL;
+}
+
+/* Picks next task to execute respecting priorities and limits.  Must be called
+ * with pool_lock held.  Returns the task or NULL if there is nothing to do. */
+static background_task_args *
+pick_task(void)
+{
+	if(pool.nrunning >= pool.limit)
+	{
+		return NULL;
+	}
+
+	background_task_args **task;
+	for(task = &pool.queue; *task != NULL; task = &(*task)->next)
+	{
+		if(!(*task)->important)
+		{
+			return take_task(task);
+		}
+	}
+
+	const int ops_limit = (pool.limit > 1 ? pool.limit - 1 : 1);
+	if(pool.nops >= ops_limit)
+	{
+		return NULL;
+	}
+
+	for(task = &pool.queue; *task != NULL; task = &(*task)->next)
+	{
+		if(!(*task)->on_device ||
+				ops_on_device((*task)->dev) < MAX_OPS_PER_DEVICE)
+		{
+			return take_task(task);
+		}
+	}
+
+	return NULL;
+}
+
+/* Counts running operations that perform I/O on the device.  Must be called
+ * with pool_lock held.  Returns the number. */
+static int
+ops_on_device(dev_t dev)
+{
+	int count = 0;
+	const background_task_args *task;
+	for(task = pool.running; task != NULL; task = task->next)
+	{
+		count += (task->important && task->on_device && task->dev == dev);
+	}
+	return count;
+}
+
+void
+bg_dev_acquire(dev_t dev, int limit)
+{
+	(void)pthread_mutex_lock(&pool_lock);
+
+	dev_load_t *load = find_dev_load(dev);
+	while(load != NULL && load->count >= limit)
+	{
+		(void)pthread_cond_wait(&dev_cond, &pool_lock);
+		load = find_dev_load(dev);
+	}
+
+	if(load == NULL)
+	{
+		load = DA_EXTEND(dev_loads);
+		if(load != NULL)
+		{
+			load->dev = dev;
+			load->count = 0;
+			DA_COMMIT(dev_loads);
+		}
+	}
+
+	/* Failing to allocate an entry just leaves this file unaccounted. */
+	if(load != NULL)
+	{
+		++load->count;
+	}
+
+	(void)pthread_mutex_unlock(&pool_lock);
+}
+
+void
+bg_dev_release(dev_t dev)
+{
+	(void)pthread_mutex_lock(&pool_lock);
+
+	dev_load_t *const load = find_dev_load(dev);
+	if(load != NULL && --load->count == 0)
+	{
+		DA_REMOVE(dev_loads, load);
+	}
+
+	(void)pthread_cond_broadcast(&dev_cond);
+	(void)pthread_mutex_unlock(&pool_lock);
+}
+
+/* Looks up number of files written to the device.  Must be called with
+ * pool_lock held.  Returns the entry or NULL if there is none. */
+static dev_load_t *
+find_dev_load(dev_t dev)
+{
+	size_t i;
+	for(i = 0U; i < DA_SIZE(dev_loads); ++i)
+	{
+		if(dev_loads[i].dev == dev)
+		{
+			return &dev_loads[i];
+		}
+	}
+	return NULL;
+}
+
+/* Moves task from the queue to the list of running tasks.  Must be called with
+ * pool_lock held.  Returns the task. */
+static background_task_args *
+take_task(background_task_args **task)
+{
+	background_task_args *const taken = *task;
+	*task = taken->next;
+	--pool.queued;
+
+	taken->next = pool.running;
+	pool.running = taken;
+	++pool.nrunning;
+	pool.nops += (taken->important != 0);
+
+	return taken;
+}
+
+/* Removes task from the list of running tasks.  Must be called with pool_lock
+ * held. */
+static void
+finish_task(background_task_args *task)
+{
+	background_task_args **entry = &pool.running;
+	while(*entry != task)
+	{
+		entry = &(*entry)->next;
+	}
+	*entry = task->next;
+
+	--pool.nrunning;
+	pool.nops -= (task->important != 0);
+}
+
+/* Executes the task in the current thread with related updates of internal
+ * data structures. */
+static void
+run_task(background_task_args *task)
+{
+	if(pthread_setspecific(current_job, task->job) == 0)
+	{
+		task->func(&task->job->bg_op, task->args);
+		(void)pthread_setspecific(current_job, NULL);
+		mark_job_finished(task->job, /*exit_code=*/0);
+	}
+	else
+	{
+		mark_job_finished(task->job, /*exit_code=*/1);
+	}
 }
 
 /* Makes the job appear on the job bar. */
@@ -1397,6 +1736,10 @@ add_background_job(pid_t pid, const char cmd[], uintptr_t err, uintptr_t data,
 		new_err_jobs = new;
 		(void)pthread_mutex_unlock(&new_err_jobs_lock);
 		(void)pthread_cond_signal(&new_err_jobs_cond);
+		if(err_selector != NULL)
+		{
+			selector_wake(err_selector);
+		}
 	}
 
 	new->with_bg_op = with_bg_op;
@@ -1428,32 +1771,6 @@ free_new:
 	return NULL;
 }
 
-/* pthreads entry point for a new background task.  Performs correct
- * startup/exit with related updates of internal data structures.  Returns
- * result for this thread. */
-static void *
-background_task_bootstrap(void *arg)
-{
-	background_task_args *const task_args = arg;
-
-	(void)pthread_detach(pthread_self());
-	block_all_thread_signals();
-
-	if(pthread_setspecific(current_job, task_args->job) == 0)
-	{
-		task_args->func(&task_args->job->bg_op, task_args->args);
-		mark_job_finished(task_args->job, /*exit_code=*/0);
-	}
-	else
-	{
-		mark_job_finished(task_args->job, /*exit_code=*/1);
-	}
-
-	free(task_args);
-
-	return NULL;
-}
-
 int
 bg_has_active_jobs(int important_only)
 {
@@ -1651,6 +1968,22 @@ mark_job_finished(bg_job_t *job, int exit_code)
 		job->exit_code = exit_code;
 		(void)pthread_spin_unlock(&job->status_lock);
 	}
+
+	report_events();
+
+	/* Error thread might be waiting for the job to finish to forget about it. */
+	if(job->err_stream != NO_JOB_ID && err_selector != NULL)
+	{
+		selector_wake(err_selector);
+	}
+}
+
+/* Lets main thread know that there are changes in state of jobs. */
+static void
+report_events(void)
+{
+	__atomic_store_n(&has_events, 1, __ATOMIC_RELEASE);
+	event_loop_wake();
 }
 
 void
@@ -24,7 +24,7 @@
 #include <windef.h>
 #endif
 
-#include <sys/types.h> /* pid_t */
+#include <sys/types.h> /* dev_t pid_t */
 
 #include <stdio.h>
 
@@ -70,7 +70,8 @@ typedef struct bg_op_t
 	int total; /* Total number of coarse operations. */
 	int done;  /* Number of already processed coarse operations. */
 
-	int progress; /* Progress in percents.  -1 if task doesn't provide one. */
+	int progress; /* Progress in percents.  -1 if task doesn't provide one, -2
+	                 while amount of work is still being estimated. */
 	char *descr;  /* Description of current activity, can be NULL. */
 
 	int cancelled; /* Whether cancellation has been requested. */
@@ -171,11 +172,34 @@ pid_t bg_run_and_capture(char cmd[], int user_sh, FILE *in, FILE **out,
  * needed. */
 void bg_check(void);
 
-/* Starts new background task, which is run in a separate thread.  Returns zero
- * on success, otherwise non-zero is returned. */
+/* Checks whether state of background jobs has changed (new error messages or
+ * finished jobs) since the last call of bg_check().  Returns non-zero if so,
+ * otherwise zero is returned. */
+int bg_has_events(void);
+
+/* Starts new background task, which is run by a thread of a shared pool of
+ * at most 'bgjobs' threads.  Tasks that aren't important are started before
+ * important ones if both are waiting for a thread.  Returns zero on success,
+ * otherwise non-zero is returned. */
 int bg_execute(const char descr[], const char op_descr[], int total,
 		int important, bg_task_func task_func, void *args);
 
+/* Same as bg_execute(), but for tasks that perform I/O on a device of the
+ * io_path.  Number of important tasks running on the same device at the same
+ * time is limited.  io_path can be NULL.  Returns zero on success, otherwise
+ * non-zero is returned. */
+int bg_execute_on(const char io_path[], const char descr[],
+		const char op_descr[], int total, int important, bg_task_func task_func,
+		void *args);
+
+/* Waits until less than limit files are being written to the device by
+ * operations and then accounts for one more file.  Each call must be paired
+ * with bg_dev_release(). */
+void bg_dev_acquire(dev_t dev, int limit);
+
+/* Stops accounting for a file written to the device. */
+void bg_dev_release(dev_t dev);
+
 /* Checks whether there are any internal jobs (important_only is non-zero) or
  * jobs or tasks (important_only is zero) running in background.  External
  * applications whose state is tracked are always ignored by this function. */
@@ -219,8 +219,11 @@ cfg_init(void)
 	cfg.word_chars['\x20'] = 0;
 
 	cfg.view_dir_size = VDS_SIZE;
+	cfg.dir_size_cache = 0;
+	cfg.dir_size_watch = 0;
 
 	cfg.log_file[0] = '\0';
+	cfg.journal_dir[0] = '\0';
 
 	cfg_set_shell(env_get_def("SHELL", DEFAULT_SHELL_CMD));
 	cfg.shell_cmd_flag = strdup((curr_stats.shell_type == ST_CMD) ? "/C" : "-c");
@@ -233,6 +236,12 @@ cfg_init(void)
 
 	cfg.fast_file_cloning = 0;
 	cfg.data_sync = 1;
+	cfg.sparse_files = 0;
+	cfg.io_uring = 0;
+	cfg.bypass_cache = 0;
+	cfg.verify_copies = 0;
+	cfg.copy_jobs = 1;
+	cfg.bg_jobs = 8;
 
 	cfg.cvoptions = 0;
 
@@ -603,6 +612,7 @@ store_config_paths(const char data_dir[])
 	free(trash_base);
 
 	snprintf(cfg.log_file, sizeof(cfg.log_file), "%s/" LOG, base);
+	snprintf(cfg.journal_dir, sizeof(cfg.journal_dir), "%s/journal", base);
 
 	char *fuse_home = format_str("%s/fuse/", base);
 	(void)cfg_set_fuse_home(fuse_home);
@@ -190,6 +190,7 @@ typedef struct config_t
 	/* This one should be set using trash_set_specs() function. */
 	char trash_dir[PATH_MAX + 64];
 	char log_file[PATH_MAX + 8];
+	char journal_dir[PATH_MAX + 16]; /* Where journals of operations are kept. */
 	char *vi_command;
 	int vi_cmd_bg;
 	char *vi_x_command;
@@ -352,11 +353,28 @@ typedef struct config_t
 	char word_chars[256]; /* Whether corresponding character is a word char. */
 
 	ViewDirSize view_dir_size; /* Type of size display for directories in view. */
+	/* Maximum number of directory sizes stored between runs, zero disables. */
+	int dir_size_cache;
+	/* Maximum number of directories watched to keep their sizes up to date,
+	 * zero disables. */
+	int dir_size_watch;
 
 	/* Controls use of fast file cloning for file systems that support it. */
 	int fast_file_cloning;
 	/* Force writing data onto media during file copying. */
 	int data_sync;
+	/* Preserve holes of sparse files during file copying. */
+	int sparse_files;
+	/* Use io_uring for reading and writing file data during file copying. */
+	int io_uring;
+	/* Don't keep data in page cache during file copying. */
+	int bypass_cache;
+	/* Read data of copied files back to check that it matches the source. */
+	int verify_copies;
+	/* Maximum number of files copied at the same time by background jobs. */
+	int copy_jobs;
+	/* Maximum number of background tasks and operations running at once. */
+	int bg_jobs;
 
 	/* Whether various things should be reset on entering/leaving custom views. */
 	int cvoptions;
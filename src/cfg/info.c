@@ -303,6 +303,7 @@ void
 state_store(void)
 {
 	write_info_file();
+	dcache_store();
 
 	if(sessions_active())
 	{
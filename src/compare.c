@@ -22,7 +22,7 @@
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* INTPTR_MAX INT64_MAX */
 #include <stdio.h> /* FILE fclose() feof() fopen() fread() */
-#include <stdlib.h> /* free() malloc() */
+#include <stdlib.h> /* calloc() free() malloc() */
 #include <string.h> /* memcmp() */
 
 #include "compat/fs_limits.h"
@@ -39,6 +39,7 @@
 #include "utils/path.h"
 #include "utils/str.h"
 #include "utils/string_array.h"
+#include "utils/test_helpers.h"
 #include "utils/trie.h"
 #include "utils/utils.h"
 #include "filelist.h"
@@ -66,7 +67,7 @@
  *       * compute contents fingerprint for current file and insert it
  */
 
-/* This is the only unit that uses xxhash, so import it directly here. */
+/* xxhash is imported directly into units that use it. */
 #define XXH_PRIVATE_API
 #include "utils/xxhash.h"
 
@@ -86,6 +87,34 @@ typedef struct compare_record_t
 }
 compare_record_t;
 
+/* Parameters of displaying intermediate results of comparison. */
+typedef struct
+{
+	view_t *view;   /* View of single pane comparison. */
+	entries_t curr; /* Processed files of current view in two pane comparison. */
+	CompareType ct; /* Type of comparison. */
+	ListType lt;    /* Type of resulting list. */
+	int flags;      /* Flags of comparison. */
+}
+diff_preview_t;
+
+/* Displays intermediate results of comparison given files processed so far and
+ * the next unused id. */
+typedef void (*diff_preview_func)(entries_t so_far, int next_id,
+		const diff_preview_t *preview);
+
+/* Number of files to process before emulating cancellation request, zero
+ * disables emulation.  Exists for tests. */
+TSTATIC int cancel_countdown;
+
+/* Number of processed files after which intermediate results are displayed for
+ * the first time.  The number doubles after every display, which keeps total
+ * amount of work proportional to building the final result.  Zero disables
+ * intermediate results. */
+TSTATIC int preview_period = 256;
+
+static void drop_unconfirmed(entries_t *curr, entries_t other, int next_id,
+		int by_paths, int flags);
 static void make_unique_lists(entries_t curr, entries_t other);
 static void leave_only_dups(entries_t *curr, entries_t *other);
 static int is_not_duplicate(view_t *view, const dir_entry_t *entry, void *arg);
@@ -99,7 +128,8 @@ static void put_side_by_side_pair(dir_entry_t *curr, dir_entry_t *other,
 static int id_sorter(const void *first, const void *second);
 static void put_or_free(view_t *view, dir_entry_t *entry, int id, int take);
 static entries_t make_diff_list(trie_t *trie, view_t *view, int *next_id,
-		CompareType ct, int dups_only, int flags);
+		CompareType ct, int dups_only, int flags, diff_preview_func show_preview,
+		const diff_preview_t *preview);
 static void list_view_entries(const view_t *view, strlist_t *list);
 static int append_valid_nodes(const char name[], int valid,
 		const void *parent_data, void *data, void *arg);
@@ -116,6 +146,14 @@ static void put_file_id(trie_t *trie, const char path[],
 		const char fingerprint[], int id, int is_partial, CompareType ct);
 static void free_compare_records(void *ptr);
 static void compare_move_entry(ops_t *ops, view_t *from, view_t *to, int idx);
+static void preview_two_panes(entries_t so_far, int next_id,
+		const diff_preview_t *preview);
+static int show_two_panes(entries_t curr, entries_t other, CompareType ct,
+		ListType lt, int flags, int partial, int next_id);
+static void preview_one_pane(entries_t so_far, int next_id,
+		const diff_preview_t *preview);
+static int show_one_pane(view_t *view, entries_t curr, ListType lt, int flags,
+		int partial);
 
 int
 compare_two_panes(CompareType ct, ListType lt, int flags)
@@ -123,8 +161,6 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 	assert((flags & (CF_IGNORE_CASE | CF_RESPECT_CASE)) !=
 			(CF_IGNORE_CASE | CF_RESPECT_CASE) && "Wrong combination of flags.");
 
-	const int group_paths = flags & CF_GROUP_PATHS;
-
 	/* We don't compare lists of files, so skip the check if at least one of the
 	 * views is a custom one. */
 	if(!flist_custom_active(&lwin) && !flist_custom_active(&rwin) &&
@@ -140,8 +176,26 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 	trie_t *const trie = trie_create(&free_compare_records);
 	ui_cancellation_push_on();
 
-	curr = make_diff_list(trie, curr_view, &next_id, ct, /*dups_only=*/0, flags);
-	other = make_diff_list(trie, other_view, &next_id, ct, lt == LT_DUPS, flags);
+	curr = make_diff_list(trie, curr_view, &next_id, ct, /*dups_only=*/0, flags,
+			NULL, NULL);
+	if(ui_cancellation_requested())
+	{
+		other = (entries_t){};
+	}
+	else
+	{
+		/* Files of the other side are matched against complete list of the current
+		 * side, so results can be displayed as they become known.  Lists of unique
+		 * files can't be formed until the end. */
+		const diff_preview_t preview = {
+			.curr = curr, .ct = ct, .lt = lt, .flags = flags
+		};
+		other = make_diff_list(trie, other_view, &next_id, ct, lt == LT_DUPS,
+				flags, lt == LT_UNIQUE ? NULL : &preview_two_panes, &preview);
+	}
+
+	/* The request is forgotten on popping the state. */
+	const int partial = ui_cancellation_requested();
 
 	ui_cancellation_pop();
 	trie_free(trie);
@@ -149,7 +203,11 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 	/* Clear progress message displayed by make_diff_list(). */
 	ui_sb_quick_msg_clear();
 
-	if(ui_cancellation_requested())
+	/* Cancellation can happen only while processing the other side, so its
+	 * processed files were compared against all files of the current side, but
+	 * not the other way round.  Show only what's known, unless there is nothing
+	 * to compare. */
+	if(partial && (curr.nentries == 0 || other.nentries == 0))
 	{
 		free_dir_entries(&curr.entries, &curr.nentries);
 		free_dir_entries(&other.entries, &other.nentries);
@@ -157,6 +215,60 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 		return 1;
 	}
 
+	if(show_two_panes(curr, other, ct, lt, flags, partial, next_id) != 0)
+	{
+		show_error_msg("Comparison", "No results to display");
+		return 0;
+	}
+
+	if(partial)
+	{
+		ui_sb_msg("Comparison has been cancelled, results are partial");
+		return 1;
+	}
+	return 0;
+}
+
+/* Displays results of two pane comparison known so far and redraws the
+ * screen. */
+static void
+preview_two_panes(entries_t so_far, int next_id, const diff_preview_t *preview)
+{
+	entries_t curr = {}, other = {};
+	replace_dir_entries(curr_view, &curr.entries, &curr.nentries,
+			preview->curr.entries, preview->curr.nentries);
+	replace_dir_entries(other_view, &other.entries, &other.nentries,
+			so_far.entries, so_far.nentries);
+
+	if(curr.nentries == 0 || other.nentries == 0)
+	{
+		free_dir_entries(&curr.entries, &curr.nentries);
+		free_dir_entries(&other.entries, &other.nentries);
+		return;
+	}
+
+	if(show_two_panes(curr, other, preview->ct, preview->lt, preview->flags,
+				/*partial=*/1, next_id) == 0)
+	{
+		update_screen(UT_REDRAW);
+	}
+}
+
+/* Fills both views with results of comparison, lists are consumed.  Partial
+ * results are limited to what's known for sure.  Returns non-zero if there is
+ * nothing to display. */
+static int
+show_two_panes(entries_t curr, entries_t other, CompareType ct, ListType lt,
+		int flags, int partial, int next_id)
+{
+	const int group_paths = flags & CF_GROUP_PATHS;
+
+	if(partial)
+	{
+		drop_unconfirmed(&curr, other, next_id, group_paths && lt == LT_ALL,
+				flags);
+	}
+
 	if(!group_paths || lt != LT_ALL)
 	{
 		/* Sort both lists according to unique file numbers to group identical files
@@ -177,8 +289,11 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 		leave_only_dups(&curr, &other);
 	}
 
-	flist_custom_start(curr_view, lt == LT_ALL ? "diff" : "dups diff");
-	flist_custom_start(other_view, lt == LT_ALL ? "diff" : "dups diff");
+	const char *const title = (lt == LT_ALL)
+	                        ? (partial ? "partial diff" : "diff")
+	                        : (partial ? "partial dups diff" : "dups diff");
+	flist_custom_start(curr_view, title);
+	flist_custom_start(other_view, title);
 
 	compare_stats_t stats = {};
 
@@ -198,8 +313,7 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 
 	if(flist_custom_finish(curr_view, CV_DIFF, 0) != 0)
 	{
-		show_error_msg("Comparison", "No results to display");
-		return 0;
+		return 1;
 	}
 	if(flist_custom_finish(other_view, CV_DIFF, 0) != 0)
 	{
@@ -228,6 +342,47 @@ compare_two_panes(CompareType ct, ListType lt, int flags)
 	return 0;
 }
 
+/* Removes entries of the current side that weren't matched against processed
+ * files of the other side because comparison was cancelled.  In path mode the
+ * entries that come before the last processed path are kept as well, because
+ * both sides are processed in the same order. */
+static void
+drop_unconfirmed(entries_t *curr, entries_t other, int next_id, int by_paths,
+		int flags)
+{
+	char *const matched = calloc(next_id, 1);
+	if(matched == NULL)
+	{
+		return;
+	}
+
+	int i;
+	for(i = 0; i < other.nentries; ++i)
+	{
+		matched[other.entries[i].id] = 1;
+	}
+
+	dir_entry_t *const last = &other.entries[other.nentries - 1];
+
+	int j = 0;
+	for(i = 0; i < curr->nentries; ++i)
+	{
+		dir_entry_t *const entry = &curr->entries[i];
+		if(matched[entry->id] ||
+				(by_paths && compare_entries(entry, last, flags) <= 0))
+		{
+			curr->entries[j++] = *entry;
+		}
+		else
+		{
+			fentry_free(entry);
+		}
+	}
+	curr->nentries = j;
+
+	free(matched);
+}
+
 /* Composes two views containing only files that are unique to each of them.
  * Assumes that both lists are sorted by id. */
 static void
@@ -596,18 +751,22 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags)
 	assert((flags & (CF_IGNORE_CASE | CF_RESPECT_CASE)) !=
 			(CF_IGNORE_CASE | CF_RESPECT_CASE) && "Wrong combination of flags.");
 
-	int i, dup_id;
-	view_t *other = (view == curr_view) ? other_view : curr_view;
-	const char *const title = (lt == LT_ALL)  ? "compare"
-	                        : (lt == LT_DUPS) ? "dups" : "nondups";
-
 	int next_id = 1;
 	entries_t curr;
 
 	trie_t *trie = trie_create(&free_compare_records);
 	ui_cancellation_push_on();
 
-	curr = make_diff_list(trie, view, &next_id, ct, /*dups_only=*/0, flags);
+	/* Groups of identical files among processed ones can be displayed as they
+	 * become known, but not files that have no match. */
+	const diff_preview_t preview = {
+		.view = view, .ct = ct, .lt = lt, .flags = flags
+	};
+	curr = make_diff_list(trie, view, &next_id, ct, /*dups_only=*/0, flags,
+			lt == LT_UNIQUE ? NULL : &preview_one_pane, &preview);
+
+	/* The request is forgotten on popping the state. */
+	const int partial = ui_cancellation_requested();
 
 	ui_cancellation_pop();
 	trie_free(trie);
@@ -615,15 +774,64 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags)
 	/* Clear progress message displayed by make_diff_list(). */
 	ui_sb_quick_msg_clear();
 
-	if(ui_cancellation_requested())
+	/* Files that were processed before cancellation were compared only against
+	 * each other, so groups of identical files are known, but any file can still
+	 * have a match among the rest.  Hence there is no list of unique files. */
+	if(partial && (curr.nentries == 0 || lt == LT_UNIQUE))
 	{
 		free_dir_entries(&curr.entries, &curr.nentries);
 		ui_sb_msg("Comparison has been cancelled");
 		return 1;
 	}
 
+	if(show_one_pane(view, curr, lt, flags, partial) != 0)
+	{
+		show_error_msg("Comparison", "No results to display");
+		return 0;
+	}
+
+	if(partial)
+	{
+		ui_sb_msg("Comparison has been cancelled, results are partial");
+		return 1;
+	}
+	return 0;
+}
+
+/* Displays results of single pane comparison known so far and redraws the
+ * screen. */
+static void
+preview_one_pane(entries_t so_far, int next_id, const diff_preview_t *preview)
+{
+	entries_t curr = {};
+	replace_dir_entries(preview->view, &curr.entries, &curr.nentries,
+			so_far.entries, so_far.nentries);
+
+	if(curr.nentries != 0 &&
+			show_one_pane(preview->view, curr, preview->lt, preview->flags,
+				/*partial=*/1) == 0)
+	{
+		update_screen(UT_REDRAW);
+	}
+}
+
+/* Fills the view with results of comparison, the list is consumed.  Returns
+ * non-zero if there is nothing to display. */
+static int
+show_one_pane(view_t *view, entries_t curr, ListType lt, int flags,
+		int partial)
+{
+	int i, dup_id, next_id;
+	view_t *other = (view == curr_view) ? other_view : curr_view;
+	const char *title = (lt == LT_ALL)  ? "compare"
+	                  : (lt == LT_DUPS) ? "dups" : "nondups";
+
 	safe_qsort(curr.entries, curr.nentries, sizeof(*curr.entries), &id_sorter);
 
+	if(partial)
+	{
+		title = (lt == LT_ALL) ? "partial compare" : "partial dups";
+	}
 	flist_custom_start(view, title);
 
 	dup_id = -1;
@@ -664,8 +872,7 @@ compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags)
 	if(flist_custom_finish(view, lt == LT_UNIQUE ? CV_REGULAR : CV_COMPARE,
 				0) != 0)
 	{
-		show_error_msg("Comparison", "No results to display");
-		return 0;
+		return 1;
 	}
 
 	/* Leave the other pane, if it's in the CV_DIFF mode, two panes are needed for
@@ -711,10 +918,12 @@ put_or_free(view_t *view, dir_entry_t *entry, int id, int take)
 
 /* Makes sorted by path list of entries that.  The trie is used to keep track of
  * identical files.  With non-zero dups_only, new files aren't added to the
- * trie. */
+ * trie.  On cancellation only files processed so far are returned.  Unless
+ * show_preview is NULL, it's periodically passed files processed so far. */
 static entries_t
 make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
-		int dups_only, int flags)
+		int dups_only, int flags, diff_preview_func show_preview,
+		const diff_preview_t *preview)
 {
 	const int skip_empty = flags & CF_SKIP_EMPTY;
 
@@ -722,6 +931,8 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 	strlist_t files = {};
 	entries_t r = {};
 	int last_progress = 0;
+	int nmatched = 0;
+	int next_preview = preview_period;
 
 	show_progress("Listing...", 0);
 	if(flist_custom_active(view) &&
@@ -756,6 +967,8 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 			continue;
 		}
 
+		const int first_new_id = *next_id;
+
 		entry->tag = i;
 		entry->id = add_file_to_diff(trie, path, entry, ct, dups_only, flags,
 				next_id);
@@ -765,6 +978,22 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 			fentry_free(entry);
 			--r.nentries;
 		}
+		else if(entry->id < first_new_id)
+		{
+			++nmatched;
+		}
+
+		if(cancel_countdown > 0 && --cancel_countdown == 0)
+		{
+			ui_cancellation_request();
+		}
+
+		if(show_preview != NULL && next_preview > 0 && i + 1 >= next_preview &&
+				!ui_cancellation_requested())
+		{
+			show_preview(r, *next_id, preview);
+			next_preview *= 2;
+		}
 
 		progress = (i*100)/files.nitems;
 		if(progress != last_progress)
@@ -772,8 +1001,8 @@ make_diff_list(trie_t *trie, view_t *view, int *next_id, CompareType ct,
 			char progress_msg[128];
 
 			last_progress = progress;
-			snprintf(progress_msg, sizeof(progress_msg), "Querying... %d (% 2d%%)", i,
-					progress);
+			snprintf(progress_msg, sizeof(progress_msg),
+					"Querying... %d (% 2d%%), matched: %d", i, progress, nmatched);
 			show_progress(progress_msg, -1);
 		}
 	}
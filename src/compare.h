@@ -20,6 +20,7 @@
 #define VIFM__DIFF_H__
 
 #include "ui/ui.h"
+#include "utils/test_helpers.h"
 
 /* Comparison flags. */
 typedef enum
@@ -59,6 +60,11 @@ int compare_one_pane(view_t *view, CompareType ct, ListType lt, int flags);
  * bar message should be preserved. */
 int compare_move(view_t *from, view_t *to);
 
+TSTATIC_DEFS(
+	extern int cancel_countdown;
+	extern int preview_period;
+)
+
 #endif /* VIFM__DIFF_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
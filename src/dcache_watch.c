@@ -0,0 +1,327 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "dcache_watch.h"
+
+#ifdef HAVE_INOTIFY
+
+#include <sys/inotify.h> /* IN_* inotify_* */
+#include <unistd.h> /* close() read() */
+
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint32_t */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memmove() strdup() */
+#include <time.h> /* time_t time() */
+
+#include "cfg/config.h"
+#include "compat/fs_limits.h"
+#include "compat/pthread.h"
+#include "compat/reallocarray.h"
+#include "utils/string_array.h"
+#include "fops_misc.h"
+#include "status.h"
+
+/* Minimal number of seconds between starts of recalculations. */
+#define RECALC_PERIOD 2
+
+/* Watched directory. */
+typedef struct
+{
+	int wd;     /* Watch descriptor. */
+	char *path; /* Path to the directory. */
+}
+watch_t;
+
+static int find_watch(int wd, int *pos);
+static void read_events(void);
+static void add_changed(const char path[]);
+
+/* Events that can affect size of a directory. */
+static const uint32_t EVENTS_MASK = IN_CREATE | IN_DELETE | IN_MODIFY
+                                  | IN_MOVED_FROM | IN_MOVED_TO
+                                  | IN_DELETE_SELF | IN_MOVE_SELF
+                                  | IN_EXCL_UNLINK | IN_ONLYDIR;
+
+/* Thread-safety guard for the state below. */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+/* inotify instance or -1. */
+static int fd = -1;
+/* Watched directories sorted by watch descriptors. */
+static watch_t *watches;
+/* Number of elements in watches. */
+static int nwatches;
+/* Changed directories that haven't been processed yet. */
+static strlist_t changed;
+/* When recalculation was started last time. */
+static time_t last_recalc;
+
+void
+dcache_watch_add(const char path[])
+{
+	pthread_mutex_lock(&lock);
+
+	if(nwatches >= cfg.dir_size_watch)
+	{
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	if(fd == -1)
+	{
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	}
+
+	const int wd = (fd == -1 ? -1 : inotify_add_watch(fd, path, EVENTS_MASK));
+	char *const path_copy = (wd == -1 ? NULL : strdup(path));
+	if(path_copy == NULL)
+	{
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	int pos;
+	if(find_watch(wd, &pos))
+	{
+		/* The same directory might have been reached by a different path. */
+		free(watches[pos].path);
+		watches[pos].path = path_copy;
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	watch_t *const new_watches = reallocarray(watches, nwatches + 1,
+			sizeof(*watches));
+	if(new_watches == NULL)
+	{
+		inotify_rm_watch(fd, wd);
+		free(path_copy);
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+	watches = new_watches;
+
+	memmove(&watches[pos + 1], &watches[pos],
+			sizeof(*watches)*(nwatches - pos));
+	watches[pos].wd = wd;
+	watches[pos].path = path_copy;
+	++nwatches;
+
+	pthread_mutex_unlock(&lock);
+}
+
+void
+dcache_watch_check(void)
+{
+	pthread_mutex_lock(&lock);
+
+	if(fd != -1)
+	{
+		read_events();
+	}
+
+	const time_t now = time(NULL);
+	if(changed.nitems == 0 || now - last_recalc < RECALC_PERIOD)
+	{
+		pthread_mutex_unlock(&lock);
+		return;
+	}
+
+	strlist_t paths = changed;
+	changed = (strlist_t){ };
+	last_recalc = now;
+
+	pthread_mutex_unlock(&lock);
+
+	/* Directories whose sizes are going to be recalculated. */
+	strlist_t tops = { };
+
+	int i;
+	for(i = 0; i < paths.nitems; ++i)
+	{
+		char top[PATH_MAX + 1];
+		if(dcache_invalidate(paths.items[i], top, sizeof(top)) == 0 &&
+				!is_in_string_array(tops.items, tops.nitems, top))
+		{
+			tops.nitems = add_to_string_array(&tops.items, tops.nitems, top);
+		}
+	}
+
+	/* Only outdated subdirectories are traversed, the rest of sizes come from
+	 * the cache. */
+	for(i = 0; i < tops.nitems; ++i)
+	{
+		fops_dir_size_bg(tops.items[i]);
+	}
+
+	free_string_array(paths.items, paths.nitems);
+	free_string_array(tops.items, tops.nitems);
+}
+
+void
+dcache_watch_reset(void)
+{
+	pthread_mutex_lock(&lock);
+
+	if(fd != -1)
+	{
+		close(fd);
+		fd = -1;
+	}
+
+	int i;
+	for(i = 0; i < nwatches; ++i)
+	{
+		free(watches[i].path);
+	}
+	free(watches);
+	watches = NULL;
+	nwatches = 0;
+
+	free_string_array(changed.items, changed.nitems);
+	changed = (strlist_t){ };
+	last_recalc = 0;
+
+	pthread_mutex_unlock(&lock);
+}
+
+int
+dcache_watch_get_fd(void)
+{
+	pthread_mutex_lock(&lock);
+	const int result = fd;
+	pthread_mutex_unlock(&lock);
+	return result;
+}
+
+/* Looks up a watch by its descriptor.  *pos is set to index of the watch or to
+ * index at which it should be inserted.  Returns non-zero if watch was
+ * found. */
+static int
+find_watch(int wd, int *pos)
+{
+	int l = 0, u = nwatches - 1;
+	while(l <= u)
+	{
+		const int i = l + (u - l)/2;
+		if(watches[i].wd == wd)
+		{
+			*pos = i;
+			return 1;
+		}
+
+		if(watches[i].wd < wd)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i - 1;
+		}
+	}
+
+	*pos = l;
+	return 0;
+}
+
+/* Reads all pending inotify events and records affected directories.  Must be
+ * called with the lock held. */
+static void
+read_events(void)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+
+	ssize_t len;
+	while((len = read(fd, buf, sizeof(buf))) > 0)
+	{
+		const char *p = buf;
+		while(p < buf + len)
+		{
+			const struct inotify_event *const e = (const void *)p;
+			p += sizeof(*e) + e->len;
+
+			if(e->mask & IN_Q_OVERFLOW)
+			{
+				/* Some events were lost, so everything could have changed. */
+				int i;
+				for(i = 0; i < nwatches; ++i)
+				{
+					add_changed(watches[i].path);
+				}
+				continue;
+			}
+
+			int pos;
+			if(!find_watch(e->wd, &pos))
+			{
+				continue;
+			}
+
+			if(e->mask & IN_IGNORED)
+			{
+				/* Directory was removed or unmounted. */
+				free(watches[pos].path);
+				memmove(&watches[pos], &watches[pos + 1],
+						sizeof(*watches)*(nwatches - pos - 1));
+				--nwatches;
+				continue;
+			}
+
+			add_changed(watches[pos].path);
+		}
+	}
+}
+
+/* Records path of a changed directory unless it's already recorded. */
+static void
+add_changed(const char path[])
+{
+	if(!is_in_string_array(changed.items, changed.nitems, path))
+	{
+		changed.nitems = add_to_string_array(&changed.items, changed.nitems, path);
+	}
+}
+
+#else
+
+void
+dcache_watch_add(const char path[])
+{
+}
+
+void
+dcache_watch_check(void)
+{
+}
+
+void
+dcache_watch_reset(void)
+{
+}
+
+int
+dcache_watch_get_fd(void)
+{
+	return -1;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
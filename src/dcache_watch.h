@@ -0,0 +1,45 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__DCACHE_WATCH_H__
+#define VIFM__DCACHE_WATCH_H__
+
+/* dcache_watch - watches directories with cached sizes for changes, marks sizes
+ * of changed directories and their parents as outdated and recalculates them
+ * in background.  Works only where inotify is available. */
+
+/* Starts watching a directory whose size has been cached.  Does nothing if
+ * watching is disabled or 'dirsizewatch' limit is reached.  Thread-safe. */
+void dcache_watch_add(const char path[]);
+
+/* Processes changes of watched directories.  Recalculation of sizes is
+ * started at most once per couple of seconds, changes that arrive in between
+ * are accumulated. */
+void dcache_watch_check(void);
+
+/* Stops watching all directories. */
+void dcache_watch_reset(void);
+
+/* Retrieves file descriptor that becomes readable on changes of watched
+ * directories.  Returns the descriptor or -1 if nothing is being watched. */
+int dcache_watch_get_fd(void);
+
+#endif /* VIFM__DCACHE_WATCH_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
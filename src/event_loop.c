@@ -20,13 +20,17 @@
 #include "event_loop.h"
 
 #include <curses.h>
-#include <unistd.h>
+#ifndef _WIN32
+#include <poll.h> /* POLLIN poll() pollfd */
+#endif
+#include <unistd.h> /* STDIN_FILENO */
 
 #include <assert.h> /* assert() */
 #include <signal.h> /* signal() */
 #include <stddef.h> /* NULL size_t wchar_t */
 #include <stdlib.h> /* free() */
 #include <string.h> /* memmove() strncpy() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() */
 #include <wchar.h> /* wint_t wcslen() wcscmp() wcsncat() wmemmove() */
 
 #include "cfg/config.h"
@@ -44,13 +48,16 @@
 #include "ui/statusbar.h"
 #include "ui/statusline.h"
 #include "ui/ui.h"
+#include "utils/fswatch.h"
 #include "utils/log.h"
 #include "utils/macros.h"
+#include "utils/selector.h"
 #include "utils/test_helpers.h"
 #include "utils/utf8.h"
 #include "utils/utils.h"
 #include "background.h"
 #include "bracket_notation.h"
+#include "dcache_watch.h"
 #include "filelist.h"
 #include "instance.h"
 #include "ipc.h"
@@ -59,11 +66,27 @@
 #include "vcache.h"
 #include "vifm.h"
 
+#if !defined(_WIN32) && !defined(__PDCURSES__)
+/* Terminal can be waited on along with other sources of events. */
+# define EVENT_DRIVEN_LOOP
+#endif
+
 static int ensure_term_is_ready(void);
 static int get_char_async_loop(WINDOW *win, wint_t *c, int timeout);
+static int needs_polling(void);
+static int read_char(WINDOW *win, wint_t *c, int delay, int *timeout);
+#ifdef EVENT_DRIVEN_LOOP
+static void wait_for_events(selector_t *selector, int delay);
+static void add_to_selector(selector_t *selector, int fd);
+static selector_t * get_selector(void);
+static long long get_monotonic_ms(void);
+#endif
 static int is_previewed(const char path[]);
+static void process_paced_updates(void);
 static void process_scheduled_updates(void);
 TSTATIC int process_scheduled_updates_of_view(view_t *view);
+static int process_scheduled_reload_of_view(view_t *view);
+static int has_pending_input(void);
 static void update_hardware_cursor(void);
 static int should_check_views_for_changes(void);
 static void check_view_for_changes(view_t *view);
@@ -86,9 +109,17 @@ static const size_t *curr_input_buf_pos;
 /* Whether suggestion box is active. */
 static int suggestions_are_visible;
 
+/* Selector used to wait for input and other events or NULL.  Accessed
+ * atomically. */
+static selector_t *loop_selector;
+
 /* Source of fake input that has priority over real input. */
 static wchar_t input_queue[128];
 
+/* Whether processing of scheduled updates was postponed to merge it with
+ * updates that follow. */
+static int updates_postponed;
+
 void
 event_loop(const int *quit, int manage_marking)
 {
@@ -116,6 +147,10 @@ event_loop(const int *quit, int manage_marking)
 	 * desired state even before any events are processed. */
 	(void)vifm_chdir(flist_get_dir(curr_view));
 
+	/* Refreshes of windows are merged and sent to the terminal when there is
+	 * nothing else to do. */
+	ui_frame_begin();
+
 	while(!*quit)
 	{
 		wint_t c;
@@ -321,6 +356,8 @@ event_loop(const int *quit, int manage_marking)
 		modes_post();
 	}
 
+	ui_frame_end();
+
 	curr_input_buf = prev_input_buf;
 	curr_input_buf_pos = prev_input_buf_pos;
 }
@@ -342,6 +379,7 @@ ensure_term_is_ready(void)
 	if(curr_stats.term_state == TS_TOO_SMALL)
 	{
 		ui_display_too_small_term_msg();
+		ui_frame_flush();
 		wait_for_signal();
 		return 0;
 	}
@@ -363,19 +401,25 @@ ensure_term_is_ready(void)
  * performing the following tasks while waiting for input:
  *  - checks for new IPC messages;
  *  - checks whether contents of displayed directories changed;
+ *  - checks whether sizes of watched directories changed;
  *  - redraws UI if requested.
+ * Sleeps until one of the sources of events becomes ready unless some of them
+ * need to be polled.
  * Returns KEY_CODE_YES for functional keys (preprocesses *c in this case), OK
  * for wide character and ERR otherwise (e.g. after timeout). */
 static int
 get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 {
-	const int IPC_F = ipc_enabled() ? 10 : 1;
-
 	do
 	{
 		int i;
 
-		int delay_slice = DIV_ROUND_UP(MIN(cfg.min_timeout_len, timeout), IPC_F);
+		const int polling = needs_polling();
+		const int IPC_F = (ipc_enabled() && polling) ? 10 : 1;
+
+		int delay_slice = polling
+		                ? DIV_ROUND_UP(MIN(cfg.min_timeout_len, timeout), IPC_F)
+		                : timeout;
 #ifdef __PDCURSES__
 		/* pdcurses performs delays in 50 ms intervals (1/20 of a second). */
 		delay_slice = MAX(50, delay_slice);
@@ -387,13 +431,19 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 			check_view_for_changes(other_view);
 		}
 
-		process_scheduled_updates();
+		dcache_watch_check();
+
+		process_paced_updates();
 
 		for(i = 0; i < IPC_F && timeout > 0; ++i)
 		{
 			if(curr_stats.ipc != NULL)
 			{
-				ipc_check(curr_stats.ipc);
+				/* Several messages could have been read from the pipe at once. */
+				while(ipc_check(curr_stats.ipc))
+				{
+					/* Do nothing. */
+				}
 			}
 
 			if(vcache_check(&is_previewed))
@@ -401,8 +451,13 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 				stats_redraw_later();
 			}
 
-			wtimeout(win, delay_slice);
-			timeout -= delay_slice;
+			/* Let the caller process changes of background jobs right away unless
+			 * a key sequence is being entered (it would be affected by the
+			 * timeout). */
+			if(*curr_input_buf_pos == 0 && bg_has_events())
+			{
+				return ERR;
+			}
 
 			if(suggestions_are_visible)
 			{
@@ -423,7 +478,7 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 				return OK;
 			}
 
-			int result = compat_wget_wch(win, c);
+			int result = read_char(win, c, delay_slice, &timeout);
 			if(result != ERR)
 			{
 				if(result == KEY_CODE_YES)
@@ -462,7 +517,7 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 				return result;
 			}
 
-			process_scheduled_updates();
+			process_paced_updates();
 		}
 	}
 	while(timeout > 0);
@@ -470,6 +525,159 @@ get_char_async_loop(WINDOW *win, wint_t *c, int timeout)
 	return ERR;
 }
 
+/* Checks whether some sources of events can't wake up the loop and need to be
+ * checked periodically.  Returns non-zero if so, otherwise zero is returned. */
+static int
+needs_polling(void)
+{
+#ifdef EVENT_DRIVEN_LOOP
+	if(get_selector() == NULL)
+	{
+		return 1;
+	}
+
+	/* Progress of jobs and output of viewers aren't signaled. */
+	if(bg_has_active_jobs(0) || vcache_has_jobs())
+	{
+		return 1;
+	}
+
+	/* Without a descriptor file-system changes are detected by polling. */
+	return (fswatch_get_fd() == -1 && should_check_views_for_changes());
+#else
+	return 1;
+#endif
+}
+
+/* Reads a character waiting for it for at most delay milliseconds.  *timeout
+ * is decreased by the time spent waiting.  Returns result of
+ * compat_wget_wch(). */
+static int
+read_char(WINDOW *win, wint_t *c, int delay, int *timeout)
+{
+	/* Keep updating the terminal even if input keeps coming. */
+	if(ui_frame_pending() && ui_frame_time_left() == 0)
+	{
+		ui_frame_flush();
+	}
+
+#ifdef EVENT_DRIVEN_LOOP
+	selector_t *const selector = get_selector();
+	if(selector != NULL)
+	{
+		/* Curses might have buffered some input, so check it first. */
+		wtimeout(win, 0);
+		const int result = compat_wget_wch(win, c);
+		if(result != ERR)
+		{
+			return result;
+		}
+
+		/* Wake up when it's time to update the terminal or to process postponed
+		 * updates. */
+		if(ui_frame_pending() || updates_postponed)
+		{
+			delay = MIN(delay, ui_frame_time_left());
+		}
+
+		const long long start = get_monotonic_ms();
+		wait_for_events(selector, delay);
+		const long long elapsed = get_monotonic_ms() - start;
+
+		/* Waking up on an event shouldn't shorten the timeout, but the loop needs
+		 * to finish even if something is ready all the time. */
+		*timeout -= MAX(1, MIN(elapsed, delay));
+		return compat_wget_wch(win, c);
+	}
+#endif
+
+	ui_frame_flush();
+
+	wtimeout(win, delay);
+	*timeout -= delay;
+	return compat_wget_wch(win, c);
+}
+
+#ifdef EVENT_DRIVEN_LOOP
+
+/* Sleeps until terminal input or another event becomes available, a wake up
+ * is requested or delay in milliseconds runs out. */
+static void
+wait_for_events(selector_t *selector, int delay)
+{
+	selector_reset(selector);
+	selector_add(selector, STDIN_FILENO);
+
+	add_to_selector(selector, dcache_watch_get_fd());
+
+	/* Events of watchers are read only when views are checked, don't wake up on
+	 * them otherwise. */
+	if(should_check_views_for_changes())
+	{
+		add_to_selector(selector, fswatch_get_fd());
+	}
+
+	if(curr_stats.ipc != NULL)
+	{
+		add_to_selector(selector, ipc_get_fd(curr_stats.ipc));
+	}
+
+	(void)selector_wait(selector, delay);
+}
+
+/* Adds file descriptor to the selector if it's valid. */
+static void
+add_to_selector(selector_t *selector, int fd)
+{
+	if(fd != -1)
+	{
+		selector_add(selector, fd);
+	}
+}
+
+/* Retrieves selector of the loop allocating it on the first call.  Returns the
+ * selector or NULL on failure to allocate it. */
+static selector_t *
+get_selector(void)
+{
+	static int failed;
+
+	if(loop_selector == NULL && !failed)
+	{
+		selector_t *const selector = selector_alloc();
+		failed = (selector == NULL);
+		__atomic_store_n(&loop_selector, selector, __ATOMIC_RELEASE);
+	}
+
+	return loop_selector;
+}
+
+/* Retrieves current time of a monotonic clock.  Returns the time in
+ * milliseconds. */
+static long long
+get_monotonic_ms(void)
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	{
+		return 0;
+	}
+	return ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
+#endif
+
+void
+event_loop_wake(void)
+{
+	selector_t *const selector = __atomic_load_n(&loop_selector,
+			__ATOMIC_ACQUIRE);
+	if(selector != NULL)
+	{
+		selector_wake(selector);
+	}
+}
+
 /* Checks if preview of specified path is visible.  Returns non-zero if so and
  * zero otherwise. */
 static int
@@ -484,10 +692,38 @@ is_previewed(const char path[])
 	return (fview_previews(curr_view, path) || fview_previews(other_view, path));
 }
 
+/* Processes scheduled updates at most once per frame interval, which merges
+ * bursts of them. */
+static void
+process_paced_updates(void)
+{
+	updates_postponed = (ui_frame_time_left() != 0);
+	if(!updates_postponed)
+	{
+		process_scheduled_updates();
+	}
+}
+
 /* Updates TUI or its elements if something is scheduled. */
 static void
 process_scheduled_updates(void)
 {
+	if(has_pending_input())
+	{
+		/* Drawing is a waste of time when more input is about to change the
+		 * screen, but reloads can't wait as they affect handling of input. */
+		if(vle_mode_get_primary() != MENU_MODE)
+		{
+			int reloaded = process_scheduled_reload_of_view(curr_view);
+			reloaded |= process_scheduled_reload_of_view(other_view);
+			if(reloaded)
+			{
+				stats_redraw_later();
+			}
+		}
+		return;
+	}
+
 	int need_redraw = 0;
 
 	ui_stat_job_bar_check_for_updates();
@@ -533,6 +769,54 @@ process_scheduled_updates_of_view(view_t *view)
 	return 0;
 }
 
+/* Performs postponed reload of the view leaving redraw for later.  Returns
+ * non-zero if the view was reloaded, and zero otherwise. */
+static int
+process_scheduled_reload_of_view(view_t *view)
+{
+	if(!window_shows_dirlist(view))
+	{
+		return 0;
+	}
+
+	switch(ui_view_query_scheduled_event(view))
+	{
+		case UUE_NONE:
+			/* Nothing to do. */
+			return 0;
+		case UUE_REDRAW:
+			ui_view_schedule_redraw(view);
+			return 0;
+		case UUE_RELOAD:
+			load_saving_pos(view);
+			return 1;
+	}
+
+	assert(0 && "Unexpected type of scheduled UI event.");
+	return 0;
+}
+
+/* Checks whether there is input that has been received, but not processed
+ * yet.  Returns non-zero if so, otherwise zero is returned. */
+static int
+has_pending_input(void)
+{
+	if(input_queue[0] != L'\0')
+	{
+		return 1;
+	}
+
+#ifndef _WIN32
+	if(!vifm_testing())
+	{
+		struct pollfd pfd = { .fd = STDIN_FILENO, .events = POLLIN };
+		return (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN));
+	}
+#endif
+
+	return 0;
+}
+
 /* Updates hardware cursor to be on currently active area of the interface,
  * which depends mainly on current mode.. */
 static void
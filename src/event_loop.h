@@ -27,6 +27,10 @@
  * nested event loops. */
 void event_loop(const int *quit, int manage_marking);
 
+/* Makes the loop stop waiting for events and check their sources.  Can be
+ * called from any thread and from signal handlers. */
+void event_loop_wake(void);
+
 void update_input_buf(void);
 
 int is_input_buf_empty(void);
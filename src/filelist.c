@@ -308,6 +308,11 @@ flist_free_view(view_t *view)
 
 	update_string(&view->last_curr_file, NULL);
 
+	free(view->drawn_cells);
+	view->drawn_cells = NULL;
+	view->ndrawn_cells = 0;
+	view->drawn_layout = 0;
+
 	free_string_array(view->saved_selection, view->nsaved_selection);
 	view->nsaved_selection = 0;
 	view->saved_selection = NULL;
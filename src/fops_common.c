@@ -70,6 +70,7 @@
 #include "filelist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
+#include "journal.h"
 #include "ops.h"
 #include "running.h"
 #include "status.h"
@@ -252,6 +253,11 @@ calc_io_progress(const io_progress_t *state, int *skip)
 	{
 		return estim->total_items/IO_PRECISION;
 	}
+	else if(estim->estimating)
+	{
+		/* Totals can be less than current values at this point. */
+		return 0;
+	}
 	else if(estim->total_bytes == 0)
 	{
 		if(estim->total_items == 0)
@@ -644,7 +650,8 @@ io_progress_bg(const io_progress_t *state, int progress)
 	progress_data_t *const pdata = estim->param;
 	bg_op_t *const bg_op = pdata->bg_op;
 
-	bg_op->progress = progress/IO_PRECISION;
+	/* Percentage is meaningless until totals are known. */
+	bg_op->progress = estim->estimating ? -2 : progress/IO_PRECISION;
 	bg_op_changed(bg_op);
 }
 
@@ -1261,6 +1268,7 @@ fops_free_bg_args(bg_args_t *args)
 	free_string_array(args->sel_list, args->sel_list_len);
 	free(args->is_in_trash);
 	fops_free_ops(args->ops);
+	journal_finish(args->journal);
 	free(args);
 }
 
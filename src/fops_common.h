@@ -54,6 +54,7 @@ typedef struct
 	char *is_in_trash;       /* Flags indicating whether i-th file is in trash.
 	                            Can be NULL when unused. */
 	ops_t *ops;              /* Pointer to pre-allocated operation description. */
+	struct journal_t *journal; /* Journal of the operation or NULL. */
 }
 bg_args_t;
 
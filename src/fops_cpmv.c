@@ -20,6 +20,7 @@
 #include "fops_cpmv.h"
 
 #include <assert.h> /* assert() */
+#include <stdlib.h> /* calloc() */
 #include <string.h> /* strcmp() strdup() */
 
 #include "compat/reallocarray.h"
@@ -35,6 +36,7 @@
 #include "flist_pos.h"
 #include "fops_common.h"
 #include "fops_misc.h"
+#include "journal.h"
 #include "ops.h"
 #include "trash.h"
 #include "undo.h"
@@ -61,9 +63,14 @@ static int verify_list(char *files[], int nfiles, char *names[], int nnames,
 static int check_for_clashes(verify_args_t *args, char *list[], char *marked[],
 		int nlines, char **error);
 static const char * cmlo_to_str(CopyMoveLikeOp op);
+static void start_journal(bg_args_t *args, const char descr[]);
 static void cpmv_files_in_bg(bg_op_t *bg_op, void *arg);
-static void cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[],
-		int move, int force, int skip, int from_trash, const char dst_dir[]);
+static OpsResult cpmv_file_in_bg(ops_t *ops, const char src[],
+		const char dst[], int move, int force, int skip, int from_trash,
+		const char dst_dir[], journal_t *journal, int idx);
+static void resume_files_in_bg(bg_op_t *bg_op, void *arg);
+static OpsResult resume_file_in_bg(ops_t *ops, const char src[],
+		const char dst[], int move, JournalConflict conflict, int started);
 static int cp_file_f(const char src[], const char dst[], CopyMoveLikeOp op,
 		int bg, int cancellable, ops_t *ops, int force);
 
@@ -351,9 +358,10 @@ fops_cpmv_bg(view_t *view, char *list[], int nlines, int move, int flags)
 
 	args->ops = fops_get_bg_ops(move ? OP_MOVE : OP_COPY,
 			move ? "moving" : "copying", args->path);
+	start_journal(args, task_desc);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &cpmv_files_in_bg,
-				args) != 0)
+	if(bg_execute_on(args->path, task_desc, "...", args->sel_list_len, 1,
+				&cpmv_files_in_bg, args) != 0)
 	{
 		fops_free_bg_args(args);
 
@@ -364,6 +372,32 @@ fops_cpmv_bg(view_t *view, char *list[], int nlines, int move, int flags)
 	return 0;
 }
 
+/* Starts journal of copying/moving files in background. */
+static void
+start_journal(bg_args_t *args, const char descr[])
+{
+	char **dsts = NULL;
+	int ndsts = 0;
+
+	size_t i;
+	for(i = 0U; i < args->sel_list_len; ++i)
+	{
+		char *const dst = join_paths(args->path, args->list[i]);
+		ndsts = put_into_string_array(&dsts, ndsts, dst);
+	}
+
+	if(ndsts == (int)args->sel_list_len)
+	{
+		const JournalConflict conflict = args->skip ? JC_SKIP
+		                               : args->force ? JC_OVERWRITE
+		                               : JC_FAIL;
+		args->journal = journal_create(descr, args->move, conflict, args->sel_list,
+				dsts, ndsts);
+	}
+
+	free_string_array(dsts, ndsts);
+}
+
 /* Checks operation for adequacy.  Displays error message in case of issues.
  * Returns non-zero if operation must be aborted, otherwise zero is returned. */
 static int
@@ -608,18 +642,23 @@ cpmv_files_in_bg(bg_op_t *bg_op, void *arg)
 		const char *const src = args->sel_list[i];
 		const char *const dst = args->list[i];
 		bg_op_set_descr(bg_op, src);
-		cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->skip,
-				args->is_in_trash[i], args->path);
+		if(cpmv_file_in_bg(ops, src, dst, args->move, args->force, args->skip,
+					args->is_in_trash[i], args->path, args->journal, i) == OPS_SUCCEEDED)
+		{
+			journal_item_done(args->journal, i);
+		}
 		++bg_op->done;
 	}
 
 	fops_free_bg_args(args);
 }
 
-/* Actual implementation of background file copying/moving. */
-static void
+/* Actual implementation of background file copying/moving.  journal can be
+ * NULL.  Returns status. */
+static OpsResult
 cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
-		int force, int skip, int from_trash, const char dst_dir[])
+		int force, int skip, int from_trash, const char dst_dir[],
+		journal_t *journal, int idx)
 {
 	char dst_full[PATH_MAX + 1];
 	snprintf(dst_full, sizeof(dst_full), "%s/%s", dst_dir, dst);
@@ -627,7 +666,7 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 	{
 		if(skip)
 		{
-			return;
+			return OPS_SKIPPED;
 		}
 
 		if(force && !from_trash)
@@ -636,14 +675,13 @@ cpmv_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
 		}
 	}
 
-	if(move)
-	{
-		(void)fops_mv_file_f(src, dst_full, OP_MOVE, 1, 1, ops);
-	}
-	else
-	{
-		(void)cp_file_f(src, dst_full, CMLO_COPY, 1, 1, ops, 0);
-	}
+	/* Destination that exists at this point belongs to the operation. */
+	journal_item_started(journal, idx);
+
+	const int error = move
+	                ? fops_mv_file_f(src, dst_full, OP_MOVE, 1, 1, ops)
+	                : cp_file_f(src, dst_full, CMLO_COPY, 1, 1, ops, 0);
+	return (error ? OPS_FAILED : OPS_SUCCEEDED);
 }
 
 /* Copies file from one location to another.  Returns zero on success, otherwise
@@ -693,5 +731,158 @@ cp_file_f(const char src[], const char dst[], CopyMoveLikeOp op, int bg,
 	return 0;
 }
 
+int
+fops_resume(const char journal_path[])
+{
+	journal_t *const journal = journal_read(journal_path);
+	if(journal == NULL)
+	{
+		show_error_msg("Can't resume operation",
+				"The operation is still running or its journal is broken");
+		return 1;
+	}
+
+	if(journal_claim(journal) != 0)
+	{
+		journal_free(journal);
+		show_error_msg("Can't resume operation", "Failed to open journal");
+		return 1;
+	}
+
+	bg_args_t *args = calloc(1, sizeof(*args));
+	if(args == NULL)
+	{
+		journal_free(journal);
+		show_error_msg("Can't resume operation", "Out of memory");
+		return 1;
+	}
+
+	args->move = journal->move;
+	args->sel_list = copy_string_array(journal->src, journal->count);
+	args->sel_list_len = (args->sel_list == NULL ? 0 : journal->count);
+	args->list = copy_string_array(journal->dst, journal->count);
+	args->nlines = (args->list == NULL ? 0 : journal->count);
+	args->journal = journal;
+
+	copy_str(args->path, sizeof(args->path), journal->dst[0]);
+	remove_last_path_component(args->path);
+
+	args->ops = fops_get_bg_ops(args->move ? OP_MOVE : OP_COPY,
+			args->move ? "moving" : "copying", args->path);
+
+	if(args->sel_list == NULL || args->list == NULL)
+	{
+		args->journal = NULL;
+		journal_free(journal);
+		fops_free_bg_args(args);
+		show_error_msg("Can't resume operation", "Out of memory");
+		return 1;
+	}
+
+	if(bg_execute_on(args->path, journal->descr, "...", journal->count, 1,
+				&resume_files_in_bg, args) != 0)
+	{
+		/* Keep the journal to be able to try again. */
+		args->journal = NULL;
+		journal_free(journal);
+		fops_free_bg_args(args);
+
+		show_error_msg("Can't resume operation",
+				"Failed to initiate background operation");
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Entry point for a background task that resumes interrupted operation. */
+static void
+resume_files_in_bg(bg_op_t *bg_op, void *arg)
+{
+	int i;
+	bg_args_t *const args = arg;
+	journal_t *const journal = args->journal;
+	ops_t *ops = args->ops;
+	fops_bg_ops_init(ops, bg_op);
+
+	if(ops->use_system_calls)
+	{
+		bg_op_set_descr(bg_op, "estimating...");
+		for(i = 0; i < journal->count; ++i)
+		{
+			if(journal->state[i] != JIS_DONE)
+			{
+				ops_enqueue(ops, journal->src[i], journal->dst[i]);
+			}
+		}
+	}
+
+	for(i = 0; i < journal->count; ++i, ++bg_op->done)
+	{
+		if(journal->state[i] == JIS_DONE)
+		{
+			continue;
+		}
+
+		const int started = (journal->state[i] == JIS_STARTED);
+		bg_op_set_descr(bg_op, journal->src[i]);
+		journal_item_started(journal, i);
+		if(resume_file_in_bg(ops, journal->src[i], journal->dst[i], journal->move,
+					journal->conflict, started) == OPS_SUCCEEDED)
+		{
+			journal_item_done(journal, i);
+		}
+	}
+
+	fops_free_bg_args(args);
+}
+
+/* Processes single item of interrupted operation.  Destination of an item whose
+ * processing has started is completed rather than replaced.  Returns
+ * status. */
+static OpsResult
+resume_file_in_bg(ops_t *ops, const char src[], const char dst[], int move,
+		JournalConflict conflict, int started)
+{
+	if(paths_are_equal(src, dst) || !path_exists(src, NODEREF))
+	{
+		/* Source is gone after it was moved successfully. */
+		return OPS_SUCCEEDED;
+	}
+
+	OPS op = (move ? OP_MOVE : OP_COPY);
+	if(path_exists(dst, NODEREF))
+	{
+		if(started && move && is_dir(src) && !is_symlink(src))
+		{
+			/* Directory is merged only by copying, so finish moving it manually like
+			 * moving between file systems does. */
+			const OpsResult result = perform_operation(OP_COPYA, ops, NULL, src,
+					dst);
+			if(result != OPS_SUCCEEDED)
+			{
+				return result;
+			}
+			return perform_operation(OP_REMOVESL, NULL, (void *)1, src, NULL);
+		}
+
+		if(started)
+		{
+			/* Keep what was copied so far and copy only the rest. */
+			op = (move ? OP_MOVEA : OP_COPYA);
+		}
+		else if(conflict == JC_SKIP)
+		{
+			return OPS_SKIPPED;
+		}
+		else if(conflict == JC_OVERWRITE)
+		{
+			(void)perform_operation(OP_REMOVESL, NULL, (void *)1, dst, NULL);
+		}
+	}
+
+	return perform_operation(op, ops, NULL, src, dst);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -59,6 +59,11 @@ void fops_replace_entry(struct ops_t *ops, struct view_t *src,
 int fops_cpmv_bg(struct view_t *view, char *list[], int nlines, int move,
 		int flags);
 
+/* Resumes copying or moving files that was interrupted by termination of the
+ * application using journal at the specified path.  Returns zero on success,
+ * otherwise non-zero is returned and error message is displayed. */
+int fops_resume(const char journal_path[]);
+
 #endif /* VIFM__FOPS_CPMV_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -19,13 +19,20 @@
 
 #include "fops_misc.h"
 
-#include <sys/stat.h> /* stat */
+#include <sys/stat.h> /* S_ISDIR stat fstatat() */
 #include <sys/types.h> /* gid_t uid_t */
+#include <dirent.h> /* DIR dirfd() fdopendir() readdir() */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW O_* open() */
+#include <unistd.h> /* close() */
 
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* free() malloc() */
 #include <string.h> /* strdup() strlen() */
+#include <time.h> /* CLOCK_REALTIME clock_gettime() */
 
 #include "cfg/config.h"
 #include "compat/os.h"
+#include "compat/pthread.h"
 #include "modes/dialogs/msg_dialog.h"
 #include "ui/cancellation.h"
 #include "ui/fileview.h"
@@ -39,6 +46,7 @@
 #include "utils/test_helpers.h"
 #include "utils/utils.h"
 #include "cmd_completion.h"
+#include "dcache_watch.h"
 #include "filelist.h"
 #include "flist_pos.h"
 #include "flist_sel.h"
@@ -55,6 +63,48 @@ typedef struct
 }
 dir_size_args_t;
 
+#ifndef _WIN32
+
+/* Maximum number of threads (including the calling one) that calculate size of
+ * a single directory. */
+#define DIR_SIZE_THREADS 8
+
+/* Directory which is being processed by calc_dir_size(). */
+typedef struct size_node_t
+{
+	struct size_node_t *parent; /* Directory that contains this one or NULL. */
+	struct size_node_t *next;   /* Next node in the stack of work. */
+	char *path;                 /* Full path to the directory. */
+	uint64_t inode;             /* Inode number of the directory. */
+	uint64_t size;              /* Size of processed part of contents. */
+	int pending;                /* Unfinished scan of this directory and
+	                               subdirectories. */
+	int unreadable;             /* Whether directory couldn't be listed. */
+}
+size_node_t;
+
+/* State shared by threads of calc_dir_size(). */
+typedef struct
+{
+	pthread_mutex_t lock;       /* Protects fields below except for the
+	                               read-only ones. */
+	pthread_cond_t cond;        /* Signals new work or completion. */
+	size_node_t *work;          /* Stack of directories to scan. */
+	int idle;                   /* Number of threads waiting for work. */
+	int nthreads;               /* Number of started helper threads. */
+	pthread_t threads[DIR_SIZE_THREADS - 1]; /* Helper threads. */
+	int done;                   /* Whether root directory is finished. */
+	int cancelled;              /* Whether calculation was cancelled.  Accessed
+	                               atomically. */
+	uint64_t size;              /* Size of the root directory once done. */
+	int force;                  /* Whether to ignore cached sizes (read-only). */
+	int progressive;            /* Whether to redraw views as top-level
+	                               subdirectories are done (read-only). */
+}
+size_calc_t;
+
+#endif
+
 /* Arguments pack for fops_query_list() verification function. */
 typedef struct
 {
@@ -90,6 +140,17 @@ static void start_dir_size_calc(const char path[], int force);
 static void dir_size_bg(bg_op_t *bg_op, void *arg);
 static void dir_size(bg_op_t *bg_op, const char path[], int force);
 static int bg_cancellation_hook(void *arg);
+static uint64_t calc_dir_size(const char path[], int force, int progressive,
+		const cancellation_t *cancellation);
+#ifndef _WIN32
+static void * size_helper(void *arg);
+static void size_worker(size_calc_t *calc, const cancellation_t *cancellation);
+static uint64_t scan_dir(size_calc_t *calc, size_node_t *node,
+		const cancellation_t *cancellation);
+static int push_size_node(size_calc_t *calc, size_node_t *parent,
+		const char path[], uint64_t inode);
+static void finish_size_node(size_calc_t *calc, size_node_t *node);
+#endif
 #ifndef _WIN32
 static void change_owner_cb(const char new_owner[], void *arg);
 static int complete_owner(const char str[], void *arg);
@@ -366,8 +427,8 @@ fops_delete_bg(view_t *view, int use_trash)
 	args->ops = fops_get_bg_ops(use_trash ? OP_REMOVE : OP_REMOVESL,
 			use_trash ? "deleting" : "Deleting", args->path);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &delete_files_in_bg,
-				args) != 0)
+	if(bg_execute_on(args->path, task_desc, "...", args->sel_list_len, 1,
+				&delete_files_in_bg, args) != 0)
 	{
 		fops_free_bg_args(args);
 
@@ -1230,6 +1291,12 @@ fops_size_bg(view_t *view, int force)
 	}
 }
 
+void
+fops_dir_size_bg(const char path[])
+{
+	start_dir_size_calc(path, /*force=*/0);
+}
+
 /* Initiates background size calculation for view entry. */
 static void
 update_dir_entry_size(dir_entry_t *entry, int force)
@@ -1303,7 +1370,7 @@ dir_size(bg_op_t *bg_op, const char path[], int force)
 		.hook = &bg_cancellation_hook,
 	};
 
-	(void)fops_dir_size(path, force, &bg_cancellation_info);
+	(void)calc_dir_size(path, force, /*progressive=*/1, &bg_cancellation_info);
 
 	/* Redraw the views unconditionally, because checking their location from a
 	 * background thread will cause a data race. */
@@ -1322,10 +1389,17 @@ uint64_t
 fops_dir_size(const char path[], int force_update,
 		const cancellation_t *cancellation)
 {
-	struct dirent *dentry;
-	const char *slash;
-	uint64_t size;
+	return calc_dir_size(path, force_update, /*progressive=*/0, cancellation);
+}
 
+/* Calculates size of a directory possibly using cache of known sizes and
+ * caching sizes of all processed directories.  Progressive calculation
+ * schedules redraw of views when a subdirectory is done.  Returns size of a
+ * directory or zero on error. */
+static uint64_t
+calc_dir_size(const char path[], int force, int progressive,
+		const cancellation_t *cancellation)
+{
 	time_t mtime = 0;
 	uint64_t inode = DCACHE_UNKNOWN;
 	struct stat s;
@@ -1337,7 +1411,7 @@ fops_dir_size(const char path[], int force_update,
 
 	/* The check is at the top and not in the loop to do only one stat() for each
 	 * path. */
-	if(!force_update)
+	if(!force)
 	{
 		uint64_t dir_size;
 		dcache_get_at(path, mtime, inode, &dir_size, NULL);
@@ -1347,6 +1421,59 @@ fops_dir_size(const char path[], int force_update,
 		}
 	}
 
+#ifndef _WIN32
+	size_calc_t calc = {
+		.idle = 0,
+		.nthreads = 0,
+		.done = 0,
+		.cancelled = 0,
+		.force = force,
+		.progressive = progressive,
+	};
+
+	if(pthread_mutex_init(&calc.lock, NULL) != 0)
+	{
+		return 0U;
+	}
+	if(pthread_cond_init(&calc.cond, NULL) != 0)
+	{
+		pthread_mutex_destroy(&calc.lock);
+		return 0U;
+	}
+
+	/* The calling thread is one of the workers, helpers are started as
+	 * subdirectories are discovered. */
+	calc.work = NULL;
+	pthread_mutex_lock(&calc.lock);
+	if(push_size_node(&calc, NULL, path, inode) != 0)
+	{
+		calc.done = 1;
+		calc.cancelled = 1;
+	}
+	pthread_mutex_unlock(&calc.lock);
+
+	size_worker(&calc, cancellation);
+
+	/* No helpers can be started once the root is done. */
+	pthread_mutex_lock(&calc.lock);
+	const int nthreads = calc.nthreads;
+	pthread_mutex_unlock(&calc.lock);
+
+	int i;
+	for(i = 0; i < nthreads; ++i)
+	{
+		(void)pthread_join(calc.threads[i], NULL);
+	}
+
+	pthread_cond_destroy(&calc.cond);
+	pthread_mutex_destroy(&calc.lock);
+
+	return (calc.cancelled ? 0U : calc.size);
+#else
+	struct dirent *dentry;
+	const char *slash;
+	uint64_t size;
+
 	DIR *dir = os_opendir(path);
 	if(dir == NULL)
 	{
@@ -1368,7 +1495,7 @@ fops_dir_size(const char path[], int force_update,
 				dentry->d_name);
 		if(fops_is_dir_entry(full_path, dentry))
 		{
-			size += fops_dir_size(full_path, force_update, cancellation);
+			size += calc_dir_size(full_path, force, progressive, cancellation);
 		}
 		else
 		{
@@ -1388,8 +1515,254 @@ fops_dir_size(const char path[], int force_update,
 	 * up memory, because interest in size sort of excludes interest in nitems. */
 	(void)dcache_set_at(path, inode, size, DCACHE_UNKNOWN);
 	return size;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Entry point of a helper thread of calc_dir_size().  Returns NULL. */
+static void *
+size_helper(void *arg)
+{
+	block_all_thread_signals();
+	size_worker(arg, NULL);
+	return NULL;
 }
 
+/* Scans directories from the stack of work until the root one is done.  Only
+ * the calling thread of calc_dir_size() checks for cancellation and passes its
+ * result to other threads. */
+static void
+size_worker(size_calc_t *calc, const cancellation_t *cancellation)
+{
+	enum { CANCELLATION_CHECK_MS = 10 };
+
+	pthread_mutex_lock(&calc->lock);
+	while(!calc->done)
+	{
+		if(cancellation != NULL && cancellation_requested(cancellation))
+		{
+			__atomic_store_n(&calc->cancelled, 1, __ATOMIC_RELAXED);
+		}
+
+		size_node_t *const node = calc->work;
+		if(node == NULL)
+		{
+			++calc->idle;
+			if(cancellation == NULL)
+			{
+				(void)pthread_cond_wait(&calc->cond, &calc->lock);
+			}
+			else
+			{
+				struct timespec deadline;
+				(void)clock_gettime(CLOCK_REALTIME, &deadline);
+				deadline.tv_nsec += CANCELLATION_CHECK_MS*1000000L;
+				if(deadline.tv_nsec >= 1000000000L)
+				{
+					++deadline.tv_sec;
+					deadline.tv_nsec -= 1000000000L;
+				}
+				(void)pthread_cond_timedwait(&calc->cond, &calc->lock, &deadline);
+			}
+			--calc->idle;
+			continue;
+		}
+
+		calc->work = node->next;
+		pthread_mutex_unlock(&calc->lock);
+
+		const uint64_t size = scan_dir(calc, node, cancellation);
+
+		pthread_mutex_lock(&calc->lock);
+		node->size += size;
+		finish_size_node(calc, node);
+	}
+	pthread_mutex_unlock(&calc->lock);
+}
+
+/* Sums up sizes of files of a directory using cached sizes of subdirectories
+ * when possible and scheduling the rest for processing.  Returns the sum. */
+static uint64_t
+scan_dir(size_calc_t *calc, size_node_t *node,
+		const cancellation_t *cancellation)
+{
+	if(__atomic_load_n(&calc->cancelled, __ATOMIC_RELAXED))
+	{
+		return 0U;
+	}
+
+	const int fd = open(node->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if(fd == -1)
+	{
+		node->unreadable = 1;
+		return 0U;
+	}
+
+	DIR *const dir = fdopendir(fd);
+	if(dir == NULL)
+	{
+		node->unreadable = 1;
+		close(fd);
+		return 0U;
+	}
+
+	const char *const slash = (ends_with_slash(node->path) ? "" : "/");
+	uint64_t size = 0U;
+	struct dirent *dentry;
+	while((dentry = readdir(dir)) != NULL)
+	{
+		if(is_builtin_dir(dentry->d_name))
+		{
+			continue;
+		}
+
+		struct stat st;
+		if(fstatat(dirfd(dir), dentry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+		{
+			continue;
+		}
+
+		if(!S_ISDIR(st.st_mode))
+		{
+			size += st.st_size;
+			continue;
+		}
+
+		char *const path = format_str("%s%s%s", node->path, slash,
+				dentry->d_name);
+		if(path == NULL)
+		{
+			continue;
+		}
+
+		uint64_t dir_size = DCACHE_UNKNOWN;
+		if(!calc->force)
+		{
+			dcache_get_at(path, st.st_mtime, st.st_ino, &dir_size, NULL);
+		}
+
+		if(dir_size != DCACHE_UNKNOWN)
+		{
+			size += dir_size;
+		}
+		else
+		{
+			pthread_mutex_lock(&calc->lock);
+			if(push_size_node(calc, node, path, st.st_ino) != 0)
+			{
+				/* Size would be incomplete, so don't cache it. */
+				node->unreadable = 1;
+			}
+			pthread_mutex_unlock(&calc->lock);
+		}
+		free(path);
+
+		if(cancellation != NULL && cancellation_requested(cancellation))
+		{
+			__atomic_store_n(&calc->cancelled, 1, __ATOMIC_RELAXED);
+		}
+		if(__atomic_load_n(&calc->cancelled, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+
+	closedir(dir);
+	return size;
+}
+
+/* Schedules processing of a directory starting a helper thread if there is no
+ * one to pick it up.  Must be called with calc->lock held.  Returns zero on
+ * success and non-zero on error. */
+static int
+push_size_node(size_calc_t *calc, size_node_t *parent, const char path[],
+		uint64_t inode)
+{
+	size_node_t *const node = malloc(sizeof(*node));
+	if(node == NULL)
+	{
+		return 1;
+	}
+
+	node->path = strdup(path);
+	if(node->path == NULL)
+	{
+		free(node);
+		return 1;
+	}
+
+	node->parent = parent;
+	node->inode = inode;
+	node->size = 0U;
+	node->pending = 1;
+	node->unreadable = 0;
+
+	if(parent != NULL)
+	{
+		++parent->pending;
+	}
+
+	node->next = calc->work;
+	calc->work = node;
+
+	/* Root directory is picked up by the calling thread. */
+	pthread_t helper;
+	if(parent != NULL && calc->idle == 0 &&
+			calc->nthreads < DIR_SIZE_THREADS - 1 &&
+			pthread_create(&helper, NULL, &size_helper, calc) == 0)
+	{
+		calc->threads[calc->nthreads++] = helper;
+	}
+	pthread_cond_signal(&calc->cond);
+	return 0;
+}
+
+/* Marks part of processing of a node as done and propagates size of finished
+ * directories to their parents.  Must be called with calc->lock held. */
+static void
+finish_size_node(size_calc_t *calc, size_node_t *node)
+{
+	while(node != NULL && --node->pending == 0)
+	{
+		size_node_t *const parent = node->parent;
+
+		/* Could calculate nitems here, but they aren't recursive and might only
+		 * take up memory, because interest in size sort of excludes interest in
+		 * nitems. */
+		if(!node->unreadable &&
+				!__atomic_load_n(&calc->cancelled, __ATOMIC_RELAXED))
+		{
+			(void)dcache_set_at(node->path, node->inode, node->size,
+					DCACHE_UNKNOWN);
+			dcache_watch_add(node->path);
+
+			if(calc->progressive && parent != NULL && parent->parent == NULL)
+			{
+				ui_view_schedule_redraw(&lwin);
+				ui_view_schedule_redraw(&rwin);
+			}
+		}
+
+		if(parent == NULL)
+		{
+			calc->size = node->size;
+			calc->done = 1;
+			pthread_cond_broadcast(&calc->cond);
+		}
+		else
+		{
+			parent->size += node->size;
+		}
+
+		free(node->path);
+		free(node);
+		node = parent;
+	}
+}
+
+#endif
+
 #ifndef _WIN32
 
 int
@@ -75,6 +75,10 @@ int fops_restore(struct view_t *view);
  * previously cached values. */
 void fops_size_bg(struct view_t *view, int force);
 
+/* Initiates background recalculation of size of a directory specified by path
+ * reusing sizes of its subdirectories that are still valid. */
+void fops_dir_size_bg(const char path[]);
+
 struct cancellation_t;
 
 /* Calculates size of a directory specified by path possibly using cache of
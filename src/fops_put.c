@@ -45,6 +45,7 @@
 #include "flist_pos.h"
 #include "fops_common.h"
 #include "fops_cpmv.h"
+#include "journal.h"
 #include "ops.h"
 #include "registers.h"
 #include "trash.h"
@@ -204,9 +205,11 @@ fops_put_bg(view_t *view, int at, int reg_name, int move)
 
 	args->ops = fops_get_bg_ops((args->move ? OP_MOVE : OP_COPY),
 			move ? "Putting" : "putting", args->path);
+	args->journal = journal_create(task_desc, args->move, JC_SKIP, args->sel_list,
+			args->list, args->sel_list_len);
 
-	if(bg_execute(task_desc, "...", args->sel_list_len, 1, &put_files_in_bg,
-				args) != 0)
+	if(bg_execute_on(args->path, task_desc, "...", args->sel_list_len, 1,
+				&put_files_in_bg, args) != 0)
 	{
 		fops_free_bg_args(args);
 
@@ -265,7 +268,11 @@ put_files_in_bg(bg_op_t *bg_op, void *arg)
 		}
 
 		bg_op_set_descr(bg_op, src);
-		(void)perform_operation(ops->main_op, ops, NULL, src, dst);
+		journal_item_started(args->journal, i);
+		if(perform_operation(ops->main_op, ops, NULL, src, dst) == OPS_SUCCEEDED)
+		{
+			journal_item_done(args->journal, i);
+		}
 	}
 
 	fops_free_bg_args(args);
@@ -121,10 +121,23 @@ struct io_args_t
 	{
 		struct
 		{
-			/* Whether try to use O(1) file cloning feature of btrfs. */
+			/* Whether try to use O(1) file cloning feature of file systems. */
 			unsigned int fast_file_cloning : 1;
 			/* Whether to call fdatasync() periodically. */
 			unsigned int data_sync : 1;
+			/* Whether to preserve holes of sparse files on copying. */
+			unsigned int sparse_files : 1;
+			/* Whether to read and write data via io_uring when it's available. */
+			unsigned int io_uring : 1;
+			/* Whether to avoid keeping copied data in page cache. */
+			unsigned int bypass_cache : 1;
+			/* Whether to check that data of copied files matches source data by
+			 * reading it back. */
+			unsigned int verify_data : 1;
+			/* Maximum number of files to copy at the same time.  Values less than
+			 * two mean sequential copying.  Has effect only for operations that
+			 * can't interact with the user (no confirm and errors callbacks). */
+			int parallel_jobs;
 		};
 	}
 	arg4;
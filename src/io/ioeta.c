@@ -18,17 +18,64 @@
 
 #include "ioeta.h"
 
+#include <pthread.h> /* PTHREAD_* pthread_* */
+
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
-#include <stdlib.h> /* calloc() free() */
+#include <stdlib.h> /* calloc() free() malloc() */
+#include <string.h> /* strdup() */
 
+#include "../utils/trie.h"
+#include "../utils/utils.h"
 #include "private/ioc.h"
 #include "private/ioeta.h"
 #include "private/traverser.h"
 
+/* Path queued for calculation in background. */
+typedef struct bg_path_t
+{
+	char *path;             /* Root of the subtree. */
+	int shallow;            /* Whether to not recur into directories. */
+	struct bg_path_t *next; /* Next entry of the queue or NULL. */
+}
+bg_path_t;
+
+/* State of calculation in background. */
+struct ioeta_bg_t
+{
+	pthread_mutex_t lock; /* Protects the queue and thread state. */
+	bg_path_t *head;      /* First path to process or NULL. */
+	bg_path_t *tail;      /* Last path to process or NULL. */
+	int running;          /* Whether the thread is processing the queue. */
+	int joinable;         /* Whether the thread needs to be joined. */
+	pthread_t thread;     /* Thread that processes the queue. */
+
+	/* Files with several hard links that were accounted for or NULL.  Used only
+	 * by the thread. */
+	struct trie_t *links;
+
+	/* These fields are accessed atomically. */
+	int stop;             /* Whether thread should stop as soon as possible. */
+	int busy;             /* Whether there is unprocessed data. */
+	size_t items;         /* Number of found items. */
+	uint64_t bytes;       /* Number of found bytes. */
+
+	/* Portion of the counters above that was merged into the estimation.  Used
+	 * only by the thread owning the estimation. */
+	size_t merged_items;
+	uint64_t merged_bytes;
+
+	io_cancellation_t cancellation; /* Cancellation of the estimation. */
+};
+
 static VisitResult eta_visitor(const char full_path[], VisitAction action,
-		void *param);
+		const visit_entry_t *entry, void *param);
+static struct ioeta_bg_t * bg_alloc(const ioeta_estim_t *estim);
+static void bg_free(struct ioeta_bg_t *bg);
+static void * bg_calculate(void *arg);
+static VisitResult bg_eta_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param);
 
 ioeta_estim_t *
 ioeta_alloc(void *param, io_cancellation_t cancellation)
@@ -49,6 +96,8 @@ ioeta_free(ioeta_estim_t *estim)
 {
 	if(estim != NULL)
 	{
+		bg_free(estim->bg);
+		trie_free(estim->links);
 		ioeta_release(estim);
 		free(estim);
 	}
@@ -63,14 +112,236 @@ ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow)
 	}
 	else
 	{
-		(void)traverse(path, &eta_visitor, estim);
+		(void)traverse_ex(path, TF_STAT, &eta_visitor, estim);
+	}
+}
+
+void
+ioeta_calculate_bg(ioeta_estim_t *estim, const char path[], int shallow)
+{
+	if(estim->bg == NULL)
+	{
+		estim->bg = bg_alloc(estim);
+	}
+
+	bg_path_t *const entry = malloc(sizeof(*entry));
+	char *const path_copy = strdup(path);
+	if(estim->bg == NULL || entry == NULL || path_copy == NULL)
+	{
+		free(entry);
+		free(path_copy);
+		ioeta_calculate(estim, path, shallow);
+		return;
+	}
+
+	entry->path = path_copy;
+	entry->shallow = shallow;
+	entry->next = NULL;
+
+	struct ioeta_bg_t *const bg = estim->bg;
+	estim->estimating = 1;
+
+	pthread_mutex_lock(&bg->lock);
+
+	if(bg->tail == NULL)
+	{
+		bg->head = entry;
+	}
+	else
+	{
+		bg->tail->next = entry;
+	}
+	bg->tail = entry;
+	__atomic_store_n(&bg->busy, 1, __ATOMIC_RELEASE);
+
+	int run_here = 0;
+	if(!bg->running)
+	{
+		if(bg->joinable)
+		{
+			/* The thread has already released the lock for the last time. */
+			(void)pthread_join(bg->thread, NULL);
+			bg->joinable = 0;
+		}
+
+		if(pthread_create(&bg->thread, NULL, &bg_calculate, bg) == 0)
+		{
+			bg->joinable = 1;
+		}
+		else
+		{
+			run_here = 1;
+		}
+		bg->running = 1;
+	}
+
+	pthread_mutex_unlock(&bg->lock);
+
+	if(run_here)
+	{
+		/* Fall back to doing all the work right now. */
+		(void)bg_calculate(bg);
+	}
+}
+
+void
+ioeta_sync(ioeta_estim_t *estim)
+{
+	struct ioeta_bg_t *const bg = estim->bg;
+	if(bg == NULL)
+	{
+		return;
+	}
+
+	/* Reading the flag first makes sure that counters are final if it's off. */
+	const int busy = __atomic_load_n(&bg->busy, __ATOMIC_ACQUIRE);
+	const size_t items = __atomic_load_n(&bg->items, __ATOMIC_RELAXED);
+	const uint64_t bytes = __atomic_load_n(&bg->bytes, __ATOMIC_RELAXED);
+
+	estim->total_items += items - bg->merged_items;
+	estim->total_bytes += bytes - bg->merged_bytes;
+	bg->merged_items = items;
+	bg->merged_bytes = bytes;
+
+	estim->estimating = busy;
+}
+
+/* Allocates state of calculation in background.  Returns the state or NULL on
+ * error. */
+static struct ioeta_bg_t *
+bg_alloc(const ioeta_estim_t *estim)
+{
+	struct ioeta_bg_t *const bg = calloc(1U, sizeof(*bg));
+	if(bg == NULL)
+	{
+		return NULL;
+	}
+
+	if(pthread_mutex_init(&bg->lock, NULL) != 0)
+	{
+		free(bg);
+		return NULL;
+	}
+
+	bg->cancellation = estim->cancellation;
+	return bg;
+}
+
+/* Stops calculation in background and frees its state.  bg can be NULL. */
+static void
+bg_free(struct ioeta_bg_t *bg)
+{
+	if(bg == NULL)
+	{
+		return;
+	}
+
+	__atomic_store_n(&bg->stop, 1, __ATOMIC_RELAXED);
+
+	pthread_mutex_lock(&bg->lock);
+	const int joinable = bg->joinable;
+	pthread_mutex_unlock(&bg->lock);
+
+	if(joinable)
+	{
+		(void)pthread_join(bg->thread, NULL);
+	}
+
+	while(bg->head != NULL)
+	{
+		bg_path_t *const next = bg->head->next;
+		free(bg->head->path);
+		free(bg->head);
+		bg->head = next;
+	}
+
+	trie_free(bg->links);
+	pthread_mutex_destroy(&bg->lock);
+	free(bg);
+}
+
+/* Entry point of a thread that processes queue of paths.  Returns NULL. */
+static void *
+bg_calculate(void *arg)
+{
+	struct ioeta_bg_t *const bg = arg;
+
+	block_all_thread_signals();
+
+	while(1)
+	{
+		pthread_mutex_lock(&bg->lock);
+
+		bg_path_t *const entry = bg->head;
+		if(entry == NULL || __atomic_load_n(&bg->stop, __ATOMIC_RELAXED))
+		{
+			bg->running = 0;
+			__atomic_store_n(&bg->busy, 0, __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&bg->lock);
+			break;
+		}
+
+		bg->head = entry->next;
+		if(bg->head == NULL)
+		{
+			bg->tail = NULL;
+		}
+
+		pthread_mutex_unlock(&bg->lock);
+
+		if(entry->shallow)
+		{
+			__atomic_add_fetch(&bg->items, 1, __ATOMIC_RELAXED);
+		}
+		else
+		{
+			(void)traverse_ex(entry->path, TF_STAT, &bg_eta_visitor, bg);
+		}
+
+		free(entry->path);
+		free(entry);
+	}
+
+	return NULL;
+}
+
+/* Implementation of traverse_ex() visitor for calculation in background.
+ * Returns 0 on success, otherwise non-zero is returned. */
+static VisitResult
+bg_eta_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
+{
+	struct ioeta_bg_t *const bg = param;
+
+	if(__atomic_load_n(&bg->stop, __ATOMIC_RELAXED) ||
+			cancelled(&bg->cancellation))
+	{
+		return VR_CANCELLED;
+	}
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			return VR_SKIP_DIR_LEAVE;
+		case VA_FILE:
+			/* Mirrors ioeta_add_file(). */
+			__atomic_add_fetch(&bg->bytes,
+					ioeta_file_size(&bg->links, full_path, entry->st), __ATOMIC_RELAXED);
+			__atomic_add_fetch(&bg->items, 1, __ATOMIC_RELAXED);
+			return VR_OK;
+		case VA_DIR_LEAVE:
+			assert(0 && "Can't get here because of VR_SKIP_DIR_LEAVE.");
+			return VR_OK;
 	}
+
+	return VR_OK;
 }
 
-/* Implementation of traverse() visitor for subtree copying.  Returns 0 on
+/* Implementation of traverse_ex() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-eta_visitor(const char full_path[], VisitAction action, void *param)
+eta_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
 {
 	ioeta_estim_t *const estim = param;
 
@@ -85,7 +356,10 @@ eta_visitor(const char full_path[], VisitAction action, void *param)
 			ioeta_add_dir(estim, full_path);
 			return VR_SKIP_DIR_LEAVE;
 		case VA_FILE:
-			ioeta_add_file(estim, full_path);
+			/* Same as ioeta_add_file(), but without querying file information. */
+			estim->total_bytes += ioeta_file_size(&estim->links, full_path,
+					entry->st);
+			ioeta_add_item(estim, full_path);
 			return VR_OK;
 		case VA_DIR_LEAVE:
 			assert(0 && "Can't get here because of VR_SKIP_DIR_LEAVE.");
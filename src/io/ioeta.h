@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__IOETA_H__
 #define VIFM__IO__IOETA_H__
 
+#include <pthread.h> /* pthread_mutex_t */
+
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 
@@ -68,6 +70,21 @@ typedef struct ioeta_estim_t
 
 	/* Provides means for cancellation checking. */
 	io_cancellation_t cancellation;
+
+	/* Whether totals are still being calculated in background.  Total values can
+	 * be less than current ones while this flag is on. */
+	int estimating;
+
+	/* State of calculation in background or NULL. */
+	struct ioeta_bg_t *bg;
+
+	/* Files with several hard links that were accounted for or NULL. */
+	struct trie_t *links;
+
+	/* Serializes updates of progress made by several threads at once or NULL.
+	 * Progress of the current file isn't tracked while this is set as there are
+	 * several of them. */
+	pthread_mutex_t *lock;
 }
 ioeta_estim_t;
 
@@ -82,6 +99,12 @@ void ioeta_free(ioeta_estim_t *estim);
  * directories. */
 void ioeta_calculate(ioeta_estim_t *estim, const char path[], int shallow);
 
+/* Same as ioeta_calculate(), but returns right away and lets the calculation
+ * proceed in background.  Totals are updated on the next progress update after
+ * new data becomes available.  Paths of successive calls are processed in
+ * order. */
+void ioeta_calculate_bg(ioeta_estim_t *estim, const char path[], int shallow);
+
 #endif /* VIFM__IO__IOETA_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
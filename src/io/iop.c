@@ -25,17 +25,28 @@
 #ifndef _WIN32
 #include <sys/ioctl.h> /* ioctl() */
 #endif
+#ifdef __linux__
+#include <sys/sendfile.h> /* sendfile() */
+#endif
 #include <sys/stat.h> /* stat */
-#include <sys/types.h> /* mode_t */
-#include <unistd.h> /* symlink() unlink() */
+#include <sys/types.h> /* dev_t mode_t off_t ssize_t */
+#include <fcntl.h> /* O_DIRECT O_RDONLY POSIX_FADV_DONTNEED SYNC_FILE_RANGE_*
+                      fcntl() open() posix_fadvise() sync_file_range() */
+#include <unistd.h> /* SEEK_DATA SEEK_HOLE close() copy_file_range() ftruncate()
+                       lseek() pread() read() symlink() unlink() write() */
+
+#include <pthread.h> /* PTHREAD_MUTEX_INITIALIZER pthread_mutex_* */
 
 #include <assert.h> /* assert() */
-#include <errno.h> /* EEXIST ENOENT EISDIR errno */
+#include <errno.h> /* EBADF EEXIST EINTR EINVAL EIO ENOENT ENOMEM ENOSYS
+                      ENOTTY ENXIO EISDIR EOPNOTSUPP EPERM EXDEV errno */
 #include <stddef.h> /* NULL size_t */
 #include <stdio.h> /* FILE fpos_t fclose() fgetpos() fflush() fread() fseek()
                       fsetpos() fwrite() snprintf() */
-#include <stdlib.h> /* free() */
+#include <stdint.h> /* UINT64_MAX uint64_t */
+#include <stdlib.h> /* free() malloc() posix_memalign() */
 #include <string.h> /* strchr() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() */
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
@@ -49,14 +60,102 @@
 #include "private/ioc.h"
 #include "private/ioe.h"
 #include "private/ioeta.h"
+#include "private/iouring.h"
 #include "ioc.h"
 
-/* Amount of data to transfer at once. */
+/* xxhash is imported directly into units that use it. */
+#define XXH_PRIVATE_API
+#include "../utils/xxhash.h"
+
+/* Amount of data to transfer at once (initial and minimal one in case of
+ * adaptive block size). */
 #define BLOCK_SIZE 32*1024
 
+/* Maximal amount of data to transfer at once when copying in user space. */
+#define MAX_USER_BLOCK_SIZE 8*1024*1024
+
+/* Minimal and maximal amount of data to transfer at once when copying is done
+ * by the kernel. */
+#define KERNEL_BLOCK_SIZE 1024*1024
+#define MAX_KERNEL_BLOCK_SIZE 64*1024*1024
+
+/* Time in milliseconds that transferring a single block should take. */
+#define BLOCK_TIME_TARGET 250
+
+/* Minimal size of a file for it to be written bypassing page cache. */
+#define DIRECT_IO_MIN_SIZE 64*1024*1024
+
+/* Alignment of buffers and sizes for direct I/O. */
+#define DIRECT_IO_ALIGNMENT 4096
+
 /* Amount of data after which data flush should be performed. */
 #define FLUSH_SIZE 256*1024*1024
 
+/* Amount of data to transfer at once when copying is done via io_uring. */
+#define URING_BLOCK_SIZE 1024*1024
+
+/* Maximum number of blocks in flight when copying is done via io_uring. */
+#define URING_QUEUE_DEPTH 8
+
+/* Amount of data to read at once when verifying copied data. */
+#define VERIFY_BLOCK_SIZE 1024*1024
+
+/* Number of pairs of file systems to remember cloning support for. */
+#define CLONE_CACHE_SIZE 16
+
+/* Whether cloning between a pair of file systems works. */
+typedef struct
+{
+	dev_t src_dev; /* Device of source file system. */
+	dev_t dst_dev; /* Device of destination file system. */
+	int supported; /* Whether cloning has succeeded at least once. */
+}
+clone_support_t;
+
+/* Means of copying file data inside the kernel. */
+typedef enum
+{
+	KCM_COPY_FILE_RANGE, /* copy_file_range(), which can also clone data. */
+	KCM_SENDFILE,        /* sendfile() between two files. */
+	KCM_NONE,            /* No more methods to try. */
+}
+KernelCopyMethod;
+
+/* Size of a block of data that adapts to speed of transferring it. */
+typedef struct
+{
+	size_t size;       /* Current size. */
+	size_t min;        /* Minimal size. */
+	size_t max;        /* Maximal size. */
+	long long started; /* Time at which transferring of current block started. */
+}
+block_size_t;
+
+/* State of dropping copied data from page cache. */
+typedef struct
+{
+	int enabled;          /* Whether dropping is enabled. */
+	int dst_fd;           /* Destination file descriptor. */
+	int src_fd;           /* Source file descriptor. */
+	uint64_t dst_pos;     /* Position of sequential copying in destination. */
+	uint64_t src_pos;     /* Position of sequential copying in source. */
+	uint64_t pending_off; /* Offset of destination range to be dropped. */
+	uint64_t pending_len; /* Length of destination range to be dropped. */
+}
+cache_dropper_t;
+
+/* State of a single block of data being copied via io_uring. */
+typedef struct
+{
+	char *buf;        /* Buffer of URING_BLOCK_SIZE bytes. */
+	uint64_t offset;  /* Offset of the block in both files. */
+	unsigned int len; /* Size of the block (might be less than buffer size). */
+	unsigned int pos; /* Number of bytes read or written so far. */
+	int writing;      /* Whether the block is being written out. */
+	int ready;        /* Whether the block waits for its turn to be written. */
+}
+uring_block_t;
+
 /* Type of io function used by retry_wrapper(). */
 typedef IoRes (*iop_func)(io_args_t *args);
 
@@ -66,6 +165,46 @@ static IoRes iop_rmfile_internal(io_args_t *args);
 static IoRes iop_rmdir_internal(io_args_t *args);
 static IoRes iop_cp_internal(io_args_t *args);
 static int clone_file(int dst_fd, int src_fd);
+#ifdef __linux__
+static clone_support_t * find_clone_support(dev_t src_dev, dev_t dst_dev);
+static void remember_clone_support(dev_t src_dev, dev_t dst_dev,
+		int supported);
+static int is_clone_unsupported(int error);
+#endif
+static int copy_sparse(io_args_t *args, int dst_fd, int src_fd,
+		const struct stat *st);
+static int copy_in_user_space(io_args_t *args, int dst_fd, int src_fd,
+		uint64_t len, int direct, XXH3_state_t *hash);
+#ifndef _WIN32
+static int copy_and_verify(io_args_t *args, int dst_fd, int src_fd,
+		uint64_t dst_offset, int direct);
+static int verify_copy(io_args_t *args, int dst_fd, uint64_t offset,
+		XXH64_hash_t expected);
+#endif
+static char * alloc_block(size_t size);
+static int enable_direct_io(int fd);
+static void disable_direct_io(int fd, int flags);
+static void block_size_init(block_size_t *bs, size_t min, size_t max);
+static void block_size_start(block_size_t *bs);
+static void block_size_update(block_size_t *bs, size_t transferred);
+static long long time_in_ms(void);
+static void drop_init(cache_dropper_t *dropper, int enabled, int dst_fd,
+		int src_fd);
+static void drop_copied(cache_dropper_t *dropper, uint64_t len);
+static void drop_range(cache_dropper_t *dropper, uint64_t src_off,
+		uint64_t dst_off, uint64_t len);
+static void drop_finish(cache_dropper_t *dropper);
+static int copy_via_uring(io_args_t *args, int dst_fd, int src_fd,
+		uint64_t len);
+static int submit_next_write(iouring_t *ring, uring_block_t blocks[],
+		unsigned int nblocks, uint64_t offset, int dst_fd, int src_fd);
+static int submit_uring_block(iouring_t *ring, uring_block_t *block,
+		unsigned int idx, int dst_fd, int src_fd);
+static int copy_in_kernel(io_args_t *args, int dst_fd, int src_fd,
+		uint64_t len);
+static ssize_t kernel_copy_block(KernelCopyMethod method, int dst_fd,
+		int src_fd, size_t len);
+static int is_kernel_copy_unsupported(int error);
 #ifdef _WIN32
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
 		LARGE_INTEGER transferred, LARGE_INTEGER stream_size,
@@ -76,6 +215,18 @@ static IoRes iop_ln_internal(io_args_t *args);
 static IoRes retry_wrapper(iop_func func, io_args_t *args);
 static IoRes io_res_from_code(int code);
 
+#ifdef __linux__
+/* Known state of cloning support between file systems.  Access is guarded by
+ * clone_cache_mutex as copying can be performed by several threads. */
+static clone_support_t clone_cache[CLONE_CACHE_SIZE];
+/* Number of used elements of clone_cache. */
+static int clone_cache_len;
+/* Index of the next element of clone_cache to replace when it's full. */
+static int clone_cache_next;
+/* Protects clone_cache and related variables. */
+static pthread_mutex_t clone_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 IoRes
 iop_mkfile(io_args_t *args)
 {
@@ -304,6 +455,7 @@ iop_cp_internal(io_args_t *args)
 	FILE *in, *out;
 	int error;
 	int cloned;
+	int copied;
 	struct stat src_st;
 	const char *open_mode = "wb";
 
@@ -518,6 +670,7 @@ iop_cp_internal(io_args_t *args)
 
 	error = 0;
 	cloned = 0;
+	copied = 0;
 
 	if(crs == IO_CRS_APPEND_TO_FILES)
 	{
@@ -544,17 +697,70 @@ iop_cp_internal(io_args_t *args)
 		}
 	}
 
-	/* TODO: use sendfile() if platform supports it. */
+#ifndef _WIN32
+	if(!error && !cloned && args->arg4.verify_data)
+	{
+		/* Checksum has to be computed on data passing through user space, so other
+		 * ways of copying are skipped. */
+		const int direct = (args->arg4.bypass_cache &&
+				st.st_size >= DIRECT_IO_MIN_SIZE && crs != IO_CRS_APPEND_TO_FILES);
+		error = (copy_and_verify(args, fileno(out), fileno(in), orig_out_size,
+					direct) != 0);
+		copied = 1;
+	}
+#endif
+
+	if(!error && !cloned && !copied && crs != IO_CRS_APPEND_TO_FILES &&
+			args->arg4.sparse_files)
+	{
+		switch(copy_sparse(args, fileno(out), fileno(in), &st))
+		{
+			case 0:  copied = 1; break;
+			case 1:  copied = 0; break;
+			default: error = 1;  break;
+		}
+	}
 
-	if(!error && !cloned)
+	if(!error && !cloned && !copied && crs != IO_CRS_APPEND_TO_FILES &&
+			args->arg4.io_uring)
 	{
+		switch(copy_via_uring(args, fileno(out), fileno(in), st.st_size))
+		{
+			case 0:  copied = 1; break;
+			case 1:  copied = 0; break;
+			default: error = 1;  break;
+		}
+	}
+
+	if(!error && !cloned && !copied && crs != IO_CRS_APPEND_TO_FILES &&
+			args->arg4.bypass_cache && st.st_size >= DIRECT_IO_MIN_SIZE)
+	{
+		/* Copying in kernel goes through page cache, so avoid it for large
+		 * files. */
+		error = (copy_in_user_space(args, fileno(out), fileno(in), UINT64_MAX,
+					/*direct=*/1, /*hash=*/NULL) != 0);
+		copied = 1;
+	}
+
+	if(!error && !cloned && !copied)
+	{
+		switch(copy_in_kernel(args, fileno(out), fileno(in), UINT64_MAX))
+		{
+			case 0:  copied = 1; break;
+			case 1:  copied = 0; break;
+			default: error = 1;  break;
+		}
+	}
+
+	if(!error && !cloned && !copied)
+	{
+#ifndef _WIN32
+		error = (copy_in_user_space(args, fileno(out), fileno(in), UINT64_MAX,
+					/*direct=*/0, /*hash=*/NULL) != 0);
+#else
 		char block[BLOCK_SIZE];
 		/* Suppress possible false-positive compiler warning. */
 		size_t nread = (size_t)-1;
-#ifndef _WIN32
-		size_t ncopied = 0U;
-		const int data_sync = args->arg4.data_sync;
-#endif
 		while((nread = fread(&block, 1, sizeof(block), in)) != 0U)
 		{
 			if(io_cancelled(args))
@@ -572,17 +778,6 @@ iop_cp_internal(io_args_t *args)
 			}
 
 			ioeta_update(args->estim, NULL, NULL, 0, nread);
-
-#ifndef _WIN32
-			/* Force flushing data to disk to not pollute RAM with this data too
-			 * much. */
-			ncopied += nread;
-			if(data_sync && ncopied >= FLUSH_SIZE)
-			{
-				(void)os_fdatasync(fileno(out));
-				ncopied -= FLUSH_SIZE;
-			}
-#endif
 		}
 
 		if(nread == 0U && !feof(in) && ferror(in))
@@ -599,6 +794,7 @@ iop_cp_internal(io_args_t *args)
 					"Write to destination file failed");
 			error = 1;
 		}
+#endif
 	}
 
 	/* Note that we truncate output file even if operation was cancelled by the
@@ -650,17 +846,51 @@ iop_cp_internal(io_args_t *args)
 	return io_res_from_code(error);
 }
 
-/* Try to clone file fast on btrfs.  Returns 0 on success, otherwise non-zero is
- * returned. */
+/* Tries to clone file fast on a file system that supports reflinks (btrfs, XFS,
+ * bcachefs, OCFS2, etc.).  Pairs of file systems that don't support it are
+ * remembered to not retry on each file.  Returns 0 on success, otherwise
+ * non-zero is returned. */
 static int
 clone_file(int dst_fd, int src_fd)
 {
 #ifdef __linux__
-#undef BTRFS_IOCTL_MAGIC
-#define BTRFS_IOCTL_MAGIC 0x94
-#undef BTRFS_IOC_CLONE
-#define BTRFS_IOC_CLONE _IOW(BTRFS_IOCTL_MAGIC, 9, int)
-	return ioctl(dst_fd, BTRFS_IOC_CLONE, src_fd);
+/* Generic version of BTRFS_IOC_CLONE, which is defined here to not depend on
+ * kernel headers. */
+#undef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+	struct stat src_st, dst_st;
+	if(fstat(src_fd, &src_st) != 0 || fstat(dst_fd, &dst_st) != 0)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&clone_cache_mutex);
+	const clone_support_t *const support =
+		find_clone_support(src_st.st_dev, dst_st.st_dev);
+	const int known = (support != NULL);
+	const int supported = (known && support->supported);
+	pthread_mutex_unlock(&clone_cache_mutex);
+
+	if(known && !supported)
+	{
+		return -1;
+	}
+
+	if(ioctl(dst_fd, FICLONE, src_fd) == 0)
+	{
+		if(!known)
+		{
+			remember_clone_support(src_st.st_dev, dst_st.st_dev, 1);
+		}
+		return 0;
+	}
+
+	/* Once cloning has worked, failures are specific to files. */
+	if(!known && is_clone_unsupported(errno))
+	{
+		remember_clone_support(src_st.st_dev, dst_st.st_dev, 0);
+	}
+	return -1;
 #else
 	(void)dst_fd;
 	(void)src_fd;
@@ -668,6 +898,930 @@ clone_file(int dst_fd, int src_fd)
 #endif
 }
 
+#ifdef __linux__
+
+/* Looks up cached information about cloning between two file systems.  Must be
+ * called with clone_cache_mutex locked.  Returns pointer to the entry or NULL if
+ * there is no information. */
+static clone_support_t *
+find_clone_support(dev_t src_dev, dev_t dst_dev)
+{
+	int i;
+	for(i = 0; i < clone_cache_len; ++i)
+	{
+		if(clone_cache[i].src_dev == src_dev && clone_cache[i].dst_dev == dst_dev)
+		{
+			return &clone_cache[i];
+		}
+	}
+	return NULL;
+}
+
+/* Records whether cloning between two file systems works.  Replaces the oldest
+ * entry if the cache is full. */
+static void
+remember_clone_support(dev_t src_dev, dev_t dst_dev, int supported)
+{
+	pthread_mutex_lock(&clone_cache_mutex);
+
+	clone_support_t *support = find_clone_support(src_dev, dst_dev);
+	if(support == NULL)
+	{
+		if(clone_cache_len < CLONE_CACHE_SIZE)
+		{
+			support = &clone_cache[clone_cache_len++];
+		}
+		else
+		{
+			support = &clone_cache[clone_cache_next];
+			clone_cache_next = (clone_cache_next + 1)%CLONE_CACHE_SIZE;
+		}
+	}
+
+	support->src_dev = src_dev;
+	support->dst_dev = dst_dev;
+	support->supported = supported;
+
+	pthread_mutex_unlock(&clone_cache_mutex);
+}
+
+/* Checks whether error returned by clone request means that it isn't supported
+ * between the file systems.  EINVAL isn't one of them, because it's also
+ * reported for files that can't be cloned for their own reasons (like
+ * mismatched flags on btrfs), so it only makes the file be copied otherwise.
+ * Returns non-zero if so. */
+static int
+is_clone_unsupported(int error)
+{
+	return error == EOPNOTSUPP
+	    || error == ENOTTY
+	    || error == EXDEV
+	    || error == ENOSYS;
+}
+
+#endif
+
+/* Copies contents of a file that has holes in it only writing its data and
+ * leaving holes at the destination.  Holes count as processed data for the
+ * purposes of progress reporting.  Returns zero on success, one if the file
+ * isn't sparse or holes can't be detected (caller should copy the data by
+ * itself) and -1 on error (including cancellation). */
+static int
+copy_sparse(io_args_t *args, int dst_fd, int src_fd, const struct stat *st)
+{
+#if !defined(_WIN32) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+	const off_t size = st->st_size;
+
+	/* Files without holes are copied as usual. */
+	if((uint64_t)st->st_blocks*512U >= (uint64_t)size)
+	{
+		return 1;
+	}
+
+	off_t offset = 0;
+	while(offset < size)
+	{
+		off_t data = lseek(src_fd, offset, SEEK_DATA);
+		if(data < 0 && errno == ENXIO)
+		{
+			/* The rest of the file is a hole. */
+			data = size;
+		}
+		else if(data < 0)
+		{
+			if(offset == 0 && errno == EINVAL)
+			{
+				/* File system doesn't support looking for holes. */
+				return 1;
+			}
+
+			(void)ioe_errlst_append(&args->result.errors, src, errno,
+					"Failed to find data in source file");
+			return -1;
+		}
+
+		off_t hole = size;
+		if(data < size)
+		{
+			hole = lseek(src_fd, data, SEEK_HOLE);
+			if(hole < 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, src, errno,
+						"Failed to find hole in source file");
+				return -1;
+			}
+			/* The file might have grown, copy only what was there originally. */
+			hole = MIN(hole, size);
+		}
+
+		ioeta_update(args->estim, NULL, NULL, 0, data - offset);
+		if(data == size)
+		{
+			break;
+		}
+
+		if(lseek(src_fd, data, SEEK_SET) < 0 || lseek(dst_fd, data, SEEK_SET) < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Failed to change position in a file");
+			return -1;
+		}
+
+		int result = copy_in_kernel(args, dst_fd, src_fd, hole - data);
+		if(result == 1)
+		{
+			result = copy_in_user_space(args, dst_fd, src_fd, hole - data, 0, NULL);
+		}
+		if(result != 0)
+		{
+			return -1;
+		}
+
+		offset = hole;
+	}
+
+	/* Trailing hole isn't created by skipping it. */
+	if(ftruncate(dst_fd, size) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to set size of destination file");
+		return -1;
+	}
+
+	return 0;
+#else
+	(void)args;
+	(void)dst_fd;
+	(void)src_fd;
+	(void)st;
+	return 1;
+#endif
+}
+
+/* Copies up to len bytes of a file between current positions of two files by
+ * reading and writing blocks of data, size of which adapts to speed of copying.
+ * Destination is written bypassing page cache where possible if direct flag is
+ * set.  Data read from the source is fed to the hash if it's not NULL.  Returns
+ * zero on success and -1 on error (including cancellation). */
+static int
+copy_in_user_space(io_args_t *args, int dst_fd, int src_fd, uint64_t len,
+		int direct, XXH3_state_t *hash)
+{
+	const char *const src = args->arg1.src;
+	const char *const dst = args->arg2.dst;
+	char *block = NULL;
+	size_t allocated = 0U;
+	int result = 0;
+#ifndef _WIN32
+	uint64_t nunsynced = 0U;
+	const int data_sync = args->arg4.data_sync;
+#endif
+
+	block_size_t bs;
+	block_size_init(&bs, BLOCK_SIZE, MAX_USER_BLOCK_SIZE);
+
+	cache_dropper_t dropper;
+	drop_init(&dropper, args->arg4.bypass_cache, dst_fd, src_fd);
+
+	const int dst_flags = (direct ? enable_direct_io(dst_fd) : -1);
+	int direct_io = (dst_flags != -1);
+
+	while(len != 0U)
+	{
+		if(io_cancelled(args))
+		{
+			result = -1;
+			break;
+		}
+
+		if(allocated < bs.size)
+		{
+			free(block);
+			block = alloc_block(bs.size);
+			if(block == NULL)
+			{
+				(void)ioe_errlst_append(&args->result.errors, src, ENOMEM,
+						"Failed to allocate buffer");
+				result = -1;
+				break;
+			}
+			allocated = bs.size;
+		}
+
+		block_size_start(&bs);
+
+		const ssize_t nread = read(src_fd, block, MIN(bs.size, len));
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, src, errno,
+					"Read from source file failed");
+			result = -1;
+			break;
+		}
+		if(nread == 0)
+		{
+			break;
+		}
+
+		if(hash != NULL)
+		{
+			(void)XXH3_64bits_update(hash, block, nread);
+		}
+
+		ssize_t nwritten = 0;
+		while(nwritten < nread)
+		{
+			/* Direct I/O requires aligned sizes, which the tail might not be. */
+			if(direct_io && (nread - nwritten) % DIRECT_IO_ALIGNMENT != 0)
+			{
+				disable_direct_io(dst_fd, dst_flags);
+				direct_io = 0;
+			}
+
+			const ssize_t n = write(dst_fd, block + nwritten, nread - nwritten);
+			if(n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if(n < 0 && errno == EINVAL && direct_io)
+			{
+				/* File system doesn't accept direct I/O after all. */
+				disable_direct_io(dst_fd, dst_flags);
+				direct_io = 0;
+				continue;
+			}
+			if(n < 0)
+			{
+				(void)ioe_errlst_append(&args->result.errors, dst, errno,
+						"Write to destination file failed");
+				result = -1;
+				break;
+			}
+			nwritten += n;
+		}
+		if(result != 0)
+		{
+			break;
+		}
+
+		len -= nread;
+		ioeta_update(args->estim, NULL, NULL, 0, nread);
+		block_size_update(&bs, nread);
+		drop_copied(&dropper, nread);
+
+#ifndef _WIN32
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		nunsynced += nread;
+		if(data_sync && nunsynced >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			nunsynced -= FLUSH_SIZE;
+		}
+#endif
+	}
+
+	if(direct_io)
+	{
+		disable_direct_io(dst_fd, dst_flags);
+	}
+	drop_finish(&dropper);
+	free(block);
+	return result;
+}
+
+#ifndef _WIN32
+
+/* Copies the rest of the source file computing checksum of its data and then
+ * reads the data back from destination file starting at dst_offset to check
+ * that it matches.  Returns zero on success and -1 on error (including
+ * cancellation and mismatch). */
+static int
+copy_and_verify(io_args_t *args, int dst_fd, int src_fd, uint64_t dst_offset,
+		int direct)
+{
+	XXH3_state_t *const hash = XXH3_createState();
+	if(hash == NULL || XXH3_64bits_reset(hash) == XXH_ERROR)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg1.src, ENOMEM,
+				"Failed to initialize checksum");
+		XXH3_freeState(hash);
+		return -1;
+	}
+
+	int result = copy_in_user_space(args, dst_fd, src_fd, UINT64_MAX, direct,
+			hash);
+	if(result == 0)
+	{
+		result = verify_copy(args, dst_fd, dst_offset, XXH3_64bits_digest(hash));
+	}
+
+	XXH3_freeState(hash);
+	return result;
+}
+
+/* Checks that checksum of data of destination file (written via dst_fd)
+ * starting at the offset matches expected value.  Returns zero on success and
+ * -1 on error (including cancellation and mismatch). */
+static int
+verify_copy(io_args_t *args, int dst_fd, uint64_t offset, XXH64_hash_t expected)
+{
+	const char *const dst = args->arg2.dst;
+
+	/* Data has to reach the storage and leave page cache for it to be read back
+	 * from the device rather than from memory. */
+	if(os_fdatasync(dst_fd) != 0)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to flush destination file");
+		return -1;
+	}
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(dst_fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+	/* Destination descriptor can be write-only. */
+	const int fd = open(dst, O_RDONLY);
+	if(fd == -1)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, errno,
+				"Failed to open destination file for verification");
+		return -1;
+	}
+
+	XXH3_state_t *const hash = XXH3_createState();
+	char *const block = malloc(VERIFY_BLOCK_SIZE);
+	if(hash == NULL || block == NULL || XXH3_64bits_reset(hash) == XXH_ERROR)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, ENOMEM,
+				"Failed to initialize checksum");
+		XXH3_freeState(hash);
+		free(block);
+		close(fd);
+		return -1;
+	}
+
+	int result = 0;
+	while(1)
+	{
+		if(io_cancelled(args))
+		{
+			result = -1;
+			break;
+		}
+
+		const ssize_t nread = pread(fd, block, VERIFY_BLOCK_SIZE, offset);
+		if(nread < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(nread < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, dst, errno,
+					"Failed to read back destination file");
+			result = -1;
+			break;
+		}
+		if(nread == 0)
+		{
+			break;
+		}
+
+		(void)XXH3_64bits_update(hash, block, nread);
+		offset += nread;
+	}
+
+	if(result == 0 && XXH3_64bits_digest(hash) != expected)
+	{
+		(void)ioe_errlst_append(&args->result.errors, dst, EIO,
+				"Copied data doesn't match source file");
+		result = -1;
+	}
+
+	XXH3_freeState(hash);
+	free(block);
+	close(fd);
+	return result;
+}
+
+#endif
+
+/* Allocates a buffer suitable for direct I/O.  Returns the buffer or NULL on
+ * error. */
+static char *
+alloc_block(size_t size)
+{
+#ifndef _WIN32
+	void *block;
+	return (posix_memalign(&block, DIRECT_IO_ALIGNMENT, size) == 0 ? block
+	                                                                : NULL);
+#else
+	return malloc(size);
+#endif
+}
+
+/* Turns on direct I/O for the file descriptor.  Returns original flags of the
+ * file descriptor or -1 if direct I/O isn't available. */
+static int
+enable_direct_io(int fd)
+{
+#if !defined(_WIN32) && defined(O_DIRECT)
+	const int flags = fcntl(fd, F_GETFL);
+	if(flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) != 0)
+	{
+		return -1;
+	}
+	return flags;
+#else
+	return -1;
+#endif
+}
+
+/* Restores flags of the file descriptor changed by enable_direct_io(). */
+static void
+disable_direct_io(int fd, int flags)
+{
+#if !defined(_WIN32) && defined(O_DIRECT)
+	(void)fcntl(fd, F_SETFL, flags);
+#endif
+}
+
+/* Initializes adaptive size of a block. */
+static void
+block_size_init(block_size_t *bs, size_t min, size_t max)
+{
+	bs->size = min;
+	bs->min = min;
+	bs->max = max;
+	bs->started = 0;
+}
+
+/* Marks beginning of transferring a block. */
+static void
+block_size_start(block_size_t *bs)
+{
+	bs->started = time_in_ms();
+}
+
+/* Adjusts size of a block after it has been transferred, so that transferring
+ * a block takes about BLOCK_TIME_TARGET: large enough to make overhead of
+ * system calls negligible on fast devices and small enough to keep progress
+ * and cancellation responsive on slow ones. */
+static void
+block_size_update(block_size_t *bs, size_t transferred)
+{
+	const long long elapsed = time_in_ms() - bs->started;
+
+	if(transferred == bs->size && elapsed < BLOCK_TIME_TARGET/2)
+	{
+		bs->size = MIN(bs->size*2, bs->max);
+	}
+	else if(elapsed > BLOCK_TIME_TARGET*2)
+	{
+		bs->size = MAX(bs->size/2, bs->min);
+	}
+}
+
+/* Retrieves current time in milliseconds. */
+static long long
+time_in_ms(void)
+{
+	struct timespec current_time;
+	if(clock_gettime(CLOCK_MONOTONIC, &current_time) != 0)
+	{
+		return 0;
+	}
+
+	return current_time.tv_sec*1000LL + current_time.tv_nsec/1000000;
+}
+
+/* Initializes state of dropping copied data from page cache, which starts at
+ * current positions of file descriptors. */
+static void
+drop_init(cache_dropper_t *dropper, int enabled, int dst_fd, int src_fd)
+{
+	*dropper = (cache_dropper_t){ .dst_fd = dst_fd, .src_fd = src_fd };
+
+	if(enabled)
+	{
+		const off_t src_pos = lseek(src_fd, 0, SEEK_CUR);
+		const off_t dst_pos = lseek(dst_fd, 0, SEEK_CUR);
+		dropper->enabled = (src_pos >= 0 && dst_pos >= 0);
+		dropper->src_pos = src_pos;
+		dropper->dst_pos = dst_pos;
+	}
+}
+
+/* Drops next len bytes copied sequentially from page cache. */
+static void
+drop_copied(cache_dropper_t *dropper, uint64_t len)
+{
+	drop_range(dropper, dropper->src_pos, dropper->dst_pos, len);
+	dropper->src_pos += len;
+	dropper->dst_pos += len;
+}
+
+/* Drops a range of copied data from page cache.  Source data is clean and is
+ * dropped right away, while destination data is dropped once it reaches the
+ * storage, which is waited for on processing the next range to let the device
+ * write data in the background in the meantime. */
+static void
+drop_range(cache_dropper_t *dropper, uint64_t src_off, uint64_t dst_off,
+		uint64_t len)
+{
+	if(!dropper->enabled)
+	{
+		return;
+	}
+
+#ifdef HAVE_POSIX_FADVISE
+	(void)posix_fadvise(dropper->src_fd, src_off, len, POSIX_FADV_DONTNEED);
+#endif
+
+#if defined(HAVE_POSIX_FADVISE) && defined(SYNC_FILE_RANGE_WRITE)
+	(void)sync_file_range(dropper->dst_fd, dst_off, len, SYNC_FILE_RANGE_WRITE);
+	drop_finish(dropper);
+	dropper->pending_off = dst_off;
+	dropper->pending_len = len;
+#endif
+}
+
+/* Drops destination data that's still in page cache after the last range. */
+static void
+drop_finish(cache_dropper_t *dropper)
+{
+	if(!dropper->enabled || dropper->pending_len == 0U)
+	{
+		return;
+	}
+
+#if defined(HAVE_POSIX_FADVISE) && defined(SYNC_FILE_RANGE_WRITE)
+	(void)sync_file_range(dropper->dst_fd, dropper->pending_off,
+			dropper->pending_len, SYNC_FILE_RANGE_WAIT_BEFORE |
+			SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+	(void)posix_fadvise(dropper->dst_fd, dropper->pending_off,
+			dropper->pending_len, POSIX_FADV_DONTNEED);
+#endif
+	dropper->pending_len = 0U;
+}
+
+/* Copies len bytes from the beginning of a file keeping several reads in flight
+ * via io_uring.  Blocks are written out one at a time in order, so that
+ * interrupted copy leaves a prefix of the file without gaps, which is what
+ * resuming an operation relies on.  File positions aren't used nor changed.  If
+ * the file turns out to be shorter, only the available data is copied.
+ * Returns zero on success, one if io_uring isn't available and nothing was
+ * copied (caller should copy the data by itself) and -1 on error (including
+ * cancellation). */
+static int
+copy_via_uring(io_args_t *args, int dst_fd, int src_fd, uint64_t len)
+{
+	/* Empty file might be lying about its size (like files in /proc do). */
+	if(len == 0U)
+	{
+		return 1;
+	}
+
+	const unsigned int nblocks = MIN(DIV_ROUND_UP(len, URING_BLOCK_SIZE),
+			(uint64_t)URING_QUEUE_DEPTH);
+	iouring_t *const ring = iouring_create(nblocks);
+	if(ring == NULL)
+	{
+		return 1;
+	}
+
+	char *const buffers = malloc((size_t)nblocks*URING_BLOCK_SIZE);
+	if(buffers == NULL)
+	{
+		iouring_free(ring);
+		return 1;
+	}
+
+	uring_block_t blocks[URING_QUEUE_DEPTH];
+	uint64_t next_offset = 0U;
+	uint64_t write_offset = 0U;
+	int write_busy = 0;
+	unsigned int i, in_flight = 0U;
+	for(i = 0U; i < nblocks; ++i)
+	{
+		blocks[i] = (uring_block_t){
+			.buf = buffers + (size_t)i*URING_BLOCK_SIZE,
+			.offset = next_offset,
+			.len = MIN(len - next_offset, (uint64_t)URING_BLOCK_SIZE),
+		};
+		next_offset += blocks[i].len;
+
+		(void)submit_uring_block(ring, &blocks[i], i, dst_fd, src_fd);
+		++in_flight;
+	}
+
+	int error = 0;
+#ifndef _WIN32
+	uint64_t nunsynced = 0U;
+	const int data_sync = args->arg4.data_sync;
+#endif
+
+	cache_dropper_t dropper;
+	drop_init(&dropper, args->arg4.bypass_cache, dst_fd, src_fd);
+
+	while(in_flight != 0U)
+	{
+		uint64_t idx;
+		int res;
+		if(iouring_wait(ring, &idx, &res) != 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+					"Failed to wait for I/O completion");
+			/* Buffers might still be in use by the kernel, so don't free them. */
+			iouring_free(ring);
+			return -1;
+		}
+		--in_flight;
+
+		uring_block_t *const block = &blocks[idx];
+		if(res == -EINTR || res == -EAGAIN)
+		{
+			(void)submit_uring_block(ring, block, idx, dst_fd, src_fd);
+			++in_flight;
+			continue;
+		}
+
+		if(res < 0 || (res == 0 && block->writing))
+		{
+			if(!error)
+			{
+				const char *const path = block->writing ? args->arg2.dst
+				                                        : args->arg1.src;
+				const char *const msg = block->writing
+				                      ? "Write to destination file failed"
+				                      : "Read from source file failed";
+				(void)ioe_errlst_append(&args->result.errors, path,
+						res < 0 ? -res : IO_ERR_UNKNOWN, msg);
+			}
+			error = 1;
+			continue;
+		}
+
+		if(error || io_cancelled(args))
+		{
+			/* Just wait for requests in flight to finish. */
+			error = 1;
+			continue;
+		}
+
+		if(!block->writing && res == 0)
+		{
+			/* The file got shorter, nothing to read past this point. */
+			block->len = block->pos;
+			len = MIN(len, block->offset + block->len);
+			next_offset = MIN(next_offset, len);
+		}
+
+		block->pos += res;
+		if(block->pos < block->len)
+		{
+			/* Short read or write, continue with the rest of the block. */
+			(void)submit_uring_block(ring, block, idx, dst_fd, src_fd);
+			++in_flight;
+			continue;
+		}
+
+		if(!block->writing)
+		{
+			if(block->len != 0U)
+			{
+				block->ready = 1;
+				if(!write_busy)
+				{
+					write_busy = submit_next_write(ring, blocks, nblocks, write_offset,
+							dst_fd, src_fd);
+					in_flight += write_busy;
+				}
+			}
+			continue;
+		}
+
+		write_offset += block->len;
+		write_busy = 0;
+
+		ioeta_update(args->estim, NULL, NULL, 0, block->len);
+		drop_range(&dropper, block->offset, block->offset, block->len);
+
+#ifndef _WIN32
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		nunsynced += block->len;
+		if(data_sync && nunsynced >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			nunsynced -= FLUSH_SIZE;
+		}
+#endif
+
+		if(next_offset < len)
+		{
+			block->offset = next_offset;
+			block->len = MIN(len - next_offset, (uint64_t)URING_BLOCK_SIZE);
+			block->pos = 0U;
+			block->writing = 0;
+			next_offset += block->len;
+
+			(void)submit_uring_block(ring, block, idx, dst_fd, src_fd);
+			++in_flight;
+		}
+
+		write_busy = submit_next_write(ring, blocks, nblocks, write_offset, dst_fd,
+				src_fd);
+		in_flight += write_busy;
+	}
+
+	drop_finish(&dropper);
+	free(buffers);
+	iouring_free(ring);
+	return (error ? -1 : 0);
+}
+
+/* Queues writing of a block that was read and starts at the specified offset.
+ * Returns number of queued requests (zero or one). */
+static int
+submit_next_write(iouring_t *ring, uring_block_t blocks[], unsigned int nblocks,
+		uint64_t offset, int dst_fd, int src_fd)
+{
+	unsigned int i;
+	for(i = 0U; i < nblocks; ++i)
+	{
+		uring_block_t *const block = &blocks[i];
+		if(block->ready && block->offset == offset)
+		{
+			block->ready = 0;
+			block->writing = 1;
+			block->pos = 0U;
+			(void)submit_uring_block(ring, block, i, dst_fd, src_fd);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Queues reading or writing of the rest of a block.  Queue can't be full as
+ * there is at most one request per block in flight.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+submit_uring_block(iouring_t *ring, uring_block_t *block, unsigned int idx,
+		int dst_fd, int src_fd)
+{
+	char *const buf = block->buf + block->pos;
+	const unsigned int len = block->len - block->pos;
+	const uint64_t offset = block->offset + block->pos;
+
+	if(block->writing)
+	{
+		return iouring_write(ring, dst_fd, buf, len, offset, idx);
+	}
+	return iouring_read(ring, src_fd, buf, len, offset, idx);
+}
+
+/* Copies up to len bytes of a file without passing its data through user
+ * space.  Progress is reported and cancellation is checked after each block.
+ * Returns zero on success, one if none of the methods is supported for this
+ * pair of files and nothing was copied (caller should copy the data by itself)
+ * and -1 on error (including cancellation). */
+static int
+copy_in_kernel(io_args_t *args, int dst_fd, int src_fd, uint64_t len)
+{
+	KernelCopyMethod method = KCM_COPY_FILE_RANGE;
+	uint64_t ncopied = 0U;
+	int result = 0;
+#ifndef _WIN32
+	uint64_t nunsynced = 0U;
+	const int data_sync = args->arg4.data_sync;
+#endif
+
+	block_size_t bs;
+	block_size_init(&bs, KERNEL_BLOCK_SIZE, MAX_KERNEL_BLOCK_SIZE);
+
+	cache_dropper_t dropper;
+	drop_init(&dropper, args->arg4.bypass_cache, dst_fd, src_fd);
+
+	while(ncopied < len)
+	{
+		if(method == KCM_NONE)
+		{
+			result = 1;
+			break;
+		}
+
+		if(io_cancelled(args))
+		{
+			result = -1;
+			break;
+		}
+
+		block_size_start(&bs);
+
+		const size_t portion = MIN(len - ncopied, (uint64_t)bs.size);
+		const ssize_t nwritten = kernel_copy_block(method, dst_fd, src_fd,
+				portion);
+		if(nwritten < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		/* Zero at the very beginning might mean that the file lies about its size
+		 * (like files in /proc do), so make sure by trying another method. */
+		if(ncopied == 0U &&
+				(nwritten == 0 || (nwritten < 0 && is_kernel_copy_unsupported(errno))))
+		{
+			++method;
+			continue;
+		}
+
+		if(nwritten < 0)
+		{
+			(void)ioe_errlst_append(&args->result.errors, args->arg2.dst, errno,
+					"Copying of file data failed");
+			result = -1;
+			break;
+		}
+
+		if(nwritten == 0)
+		{
+			break;
+		}
+
+		ncopied += nwritten;
+		ioeta_update(args->estim, NULL, NULL, 0, nwritten);
+		block_size_update(&bs, nwritten);
+		drop_copied(&dropper, nwritten);
+
+#ifndef _WIN32
+		/* Force flushing data to disk to not pollute RAM with this data too
+		 * much. */
+		nunsynced += nwritten;
+		if(data_sync && nunsynced >= FLUSH_SIZE)
+		{
+			(void)os_fdatasync(dst_fd);
+			nunsynced -= FLUSH_SIZE;
+		}
+#endif
+	}
+
+	drop_finish(&dropper);
+	return result;
+}
+
+/* Copies next block of data of at most len bytes between current positions of
+ * two files using specified method.  Returns number of copied bytes, zero on
+ * end of file and -1 on error with errno set. */
+static ssize_t
+kernel_copy_block(KernelCopyMethod method, int dst_fd, int src_fd, size_t len)
+{
+	switch(method)
+	{
+		case KCM_COPY_FILE_RANGE:
+#ifdef HAVE_COPY_FILE_RANGE
+			return copy_file_range(src_fd, NULL, dst_fd, NULL, len, 0);
+#else
+			break;
+#endif
+		case KCM_SENDFILE:
+#ifdef __linux__
+			/* Only Linux supports sendfile() with a regular file as destination. */
+			return sendfile(dst_fd, src_fd, NULL, len);
+#else
+			break;
+#endif
+		case KCM_NONE:
+			break;
+	}
+
+	(void)dst_fd;
+	(void)src_fd;
+	(void)len;
+	errno = ENOSYS;
+	return -1;
+}
+
+/* Checks whether error reported by kernel copying means that the method isn't
+ * applicable to the files rather than an I/O error.  Returns non-zero if
+ * so. */
+static int
+is_kernel_copy_unsupported(int error)
+{
+	return error == ENOSYS
+	    || error == EXDEV
+	    || error == EINVAL
+	    || error == EBADF
+	    || error == EPERM
+	    || error == EOPNOTSUPP;
+}
+
 #ifdef _WIN32
 
 static DWORD CALLBACK win_progress_cb(LARGE_INTEGER total,
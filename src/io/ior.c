@@ -18,21 +18,33 @@
 
 #include "ior.h"
 
-#include <sys/stat.h> /* stat */
-#include <unistd.h> /* unlink() */
+#ifndef _WIN32
+#include <dirent.h> /* DIR closedir() fdopendir() readdir() */
+#include <fcntl.h> /* AT_FDCWD AT_REMOVEDIR AT_SYMLINK_NOFOLLOW F_DUPFD_CLOEXEC
+                       O_* fcntl() openat() */
+#endif
+#include <sys/stat.h> /* S_ISDIR() fstatat() stat */
+#include <unistd.h> /* close() link() unlink() unlinkat() */
+
+#include <pthread.h> /* pthread_* */
 
 #include <errno.h> /* EEXIST EISDIR ENOTEMPTY EXDEV errno */
-#include <stddef.h> /* NULL */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdio.h> /* remove() snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* strlen() */
+#include <string.h> /* strdup() strlen() */
 
+#include "../compat/dtype.h"
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
 #include "../utils/fs.h"
 #include "../utils/log.h"
+#include "../utils/macros.h"
 #include "../utils/path.h"
 #include "../utils/str.h"
+#include "../utils/string_array.h"
+#include "../utils/trie.h"
 #include "../utils/utils.h"
 #include "../background.h"
 #include "private/ioc.h"
@@ -42,27 +54,455 @@
 #include "ioc.h"
 #include "iop.h"
 
+/* Maximum number of files copied at the same time by a single operation. */
+#define MAX_CP_JOBS 64
+
+/* Number of files collected before they are copied in parallel. */
+#define CP_BATCH_SIZE 1024
+
+/* Number of threads that remove a directory tree.  Removal is bound by
+ * metadata updates of the file system rather than by CPU or by the device, so
+ * few threads are enough to hide latency of each other's system calls (which
+ * is what gives the speed up on network and FUSE file systems), while more of
+ * them mostly contend for locks of directories and of the journal.  This is
+ * also why the number isn't derived from count of CPUs or from 'copyjobs'. */
+#define RM_JOBS 4
+
+/* Directory that's being removed by several threads. */
+typedef struct rm_dir_t
+{
+	char *path;              /* Full path to the directory. */
+	const char *name;        /* Name relative to parent (points into path). */
+	int fd;                  /* Descriptor of the directory once it's scanned or
+	                            -1. */
+	struct rm_dir_t *parent; /* Parent directory or NULL for the root. */
+	int pending;             /* Subdirectories left plus one for own scan. */
+	struct rm_dir_t *next;   /* Next directory in the queue. */
+	struct rm_dir_t *next_allocated; /* Next element of list of all dirs. */
+}
+rm_dir_t;
+
+/* State of removal of a directory tree. */
+typedef struct
+{
+	io_args_t *args;       /* Arguments of the whole operation. */
+	rm_dir_t *queue;       /* Stack of directories to scan. */
+	rm_dir_t *allocated;   /* List of all directories for freeing. */
+	int active;            /* Number of threads scanning directories. */
+	int stop;              /* Whether removal should stop.  Read atomically. */
+	IoRes result;          /* Result of the operation. */
+	pthread_mutex_t lock;  /* Guards all fields, estimation and errors. */
+	pthread_cond_t cond;   /* Signals changes of the queue. */
+}
+rm_state_t;
+
+/* State of copying of a directory tree. */
+typedef struct
+{
+	io_args_t *args; /* Arguments of the whole operation. */
+	trie_t *links;   /* Maps device and inode of files with several hard links to
+	                    destination of their first copy.  Can be NULL. */
+}
+cp_tree_t;
+
+/* Copying of a single file during parallel copying. */
+typedef struct
+{
+	char *src;           /* Source path. */
+	char *dst;           /* Destination path. */
+	const char *link;    /* Copy of another hard link to link to or NULL. */
+	IoRes result;        /* Result of copying. */
+	ioe_errlst_t errors; /* Errors that occurred during copying. */
+}
+cp_job_t;
+
+/* State of parallel copying of a directory. */
+typedef struct
+{
+	io_args_t *args;                /* Arguments of the whole operation. */
+	cp_job_t jobs[CP_BATCH_SIZE];   /* Collected files to copy. */
+	size_t njobs;                   /* Number of elements in jobs. */
+	size_t next_job;                /* Index of the next job to pick. */
+	int failed;                     /* Stops picking jobs after an error. */
+	strlist_t dirs;                 /* Directories in the order of leaving. */
+	trie_t *links;                  /* Copies of hard links (see cp_tree_t). */
+	int on_device;                  /* Whether dev field is set. */
+	dev_t dev;                      /* Device of destination directory. */
+	pthread_mutex_t lock;           /* Guards next_job, failed and estim. */
+}
+cp_state_t;
+
+static int can_rm_in_parallel(const io_args_t *args);
+#ifndef _WIN32
+static IoRes rm_in_parallel(io_args_t *args);
+static void * rm_worker(void *arg);
+static void rm_scan(rm_state_t *state, rm_dir_t *dir);
+static void rm_queue_dir(rm_state_t *state, rm_dir_t *parent, char *path,
+		const char name[]);
+static int rm_parent_fd(const rm_dir_t *dir);
+static void rm_dir_finished(rm_state_t *state, rm_dir_t *dir);
+static void rm_fail(rm_state_t *state, IoRes result, const char path[],
+		const char name[], int error_code, const char msg[]);
+static int rm_stopped(rm_state_t *state);
+#endif
 static VisitResult rm_visitor(const char full_path[], VisitAction action,
 		void *param);
+static int can_cp_in_parallel(const io_args_t *args);
+static IoRes cp_in_parallel(io_args_t *args, trie_t *links);
+static VisitResult parallel_cp_visitor(const char full_path[],
+		VisitAction action, const visit_entry_t *entry, void *param);
+static IoRes run_cp_jobs(cp_state_t *state);
+static void * cp_worker(void *arg);
+static void drop_cp_jobs(cp_state_t *state);
+static const char * find_link_copy(trie_t *links, const char src[],
+		const char dst[], const struct stat *st);
+static int cp_as_link(io_args_t *args, const char src[], const char dst[],
+		const char target[]);
 static VisitResult cp_visitor(const char full_path[], VisitAction action,
-		void *param);
+		const visit_entry_t *entry, void *param);
 static IoRes mv_by_copy(io_args_t *args, int confirmed);
 static IoRes mv_replacing_all(io_args_t *args);
 static IoRes mv_replacing_files(io_args_t *args);
 static int is_file(const char path[]);
 static VisitResult mv_visitor(const char full_path[], VisitAction action,
-		void *param);
+		const visit_entry_t *entry, void *param);
 static VisitResult cp_mv_visitor(const char full_path[], VisitAction action,
-		void *param, int cp);
+		const visit_entry_t *entry, void *param, int cp, trie_t *links);
 static VisitResult vr_from_io_res(IoRes result);
 
 IoRes
 ior_rm(io_args_t *args)
 {
 	const char *const path = args->arg1.path;
+
+#ifndef _WIN32
+	if(can_rm_in_parallel(args))
+	{
+		return rm_in_parallel(args);
+	}
+#endif
+
 	return traverse(path, &rm_visitor, args);
 }
 
+/* Checks whether removal can be performed by several threads.  Returns non-zero
+ * if so. */
+static int
+can_rm_in_parallel(const io_args_t *args)
+{
+#ifndef _WIN32
+	const char *const path = args->arg1.path;
+
+	/* Parallel removal can't ask user what to do on errors. */
+	return args->result.errors_cb == NULL
+	    && !is_symlink(path)
+	    && is_dir(path);
+#else
+	return 0;
+#endif
+}
+
+#ifndef _WIN32
+
+/* Removes directory tree by several threads which take directories from a
+ * shared stack and remove files relative to directory file descriptors.  A
+ * directory is removed by the thread that finishes the last of its
+ * subdirectories.  Returns status. */
+static IoRes
+rm_in_parallel(io_args_t *args)
+{
+	char *const root = strdup(args->arg1.path);
+	if(root == NULL)
+	{
+		(void)ioe_errlst_append(&args->result.errors, args->arg1.path,
+				IO_ERR_UNKNOWN, "Not enough memory");
+		return IO_RES_FAILED;
+	}
+
+	rm_state_t state = {
+		.args = args,
+		.result = IO_RES_SUCCEEDED,
+	};
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.cond, NULL);
+
+	rm_queue_dir(&state, NULL, root, root);
+
+	pthread_t threads[RM_JOBS - 1];
+	int i, nstarted = 0;
+	for(i = 0; i < RM_JOBS - 1; ++i)
+	{
+		if(pthread_create(&threads[nstarted], NULL, &rm_worker, &state) == 0)
+		{
+			++nstarted;
+		}
+	}
+	(void)rm_worker(&state);
+	for(i = 0; i < nstarted; ++i)
+	{
+		(void)pthread_join(threads[i], NULL);
+	}
+
+	while(state.allocated != NULL)
+	{
+		rm_dir_t *const dir = state.allocated;
+		state.allocated = dir->next_allocated;
+		if(dir->fd != -1)
+		{
+			(void)close(dir->fd);
+		}
+		free(dir->path);
+		free(dir);
+	}
+
+	pthread_cond_destroy(&state.cond);
+	pthread_mutex_destroy(&state.lock);
+	return state.result;
+}
+
+/* Entry point of a thread that removes directories.  Returns NULL. */
+static void *
+rm_worker(void *arg)
+{
+	rm_state_t *const state = arg;
+
+	pthread_mutex_lock(&state->lock);
+	while(1)
+	{
+		while(state->queue == NULL && state->active != 0 && !state->stop)
+		{
+			pthread_cond_wait(&state->cond, &state->lock);
+		}
+
+		if(state->queue == NULL || state->stop)
+		{
+			/* Wake up other threads to let them finish as well. */
+			pthread_cond_broadcast(&state->cond);
+			break;
+		}
+
+		rm_dir_t *const dir = state->queue;
+		state->queue = dir->next;
+		++state->active;
+		ioeta_update(state->args->estim, dir->path, dir->path, 0, 0);
+		pthread_mutex_unlock(&state->lock);
+
+		rm_scan(state, dir);
+
+		pthread_mutex_lock(&state->lock);
+		if(--state->active == 0 && state->queue == NULL)
+		{
+			pthread_cond_broadcast(&state->cond);
+		}
+	}
+	pthread_mutex_unlock(&state->lock);
+
+	return NULL;
+}
+
+/* Removes files of a directory and queues its subdirectories.  Directory is
+ * opened relative to its parent and its descriptor is kept open for its
+ * subdirectories until the directory is removed, so symbolic links that
+ * replace directories during removal aren't followed. */
+static void
+rm_scan(rm_state_t *state, rm_dir_t *dir)
+{
+	io_args_t *const args = state->args;
+
+	const int fd = openat(rm_parent_fd(dir), dir->name,
+			O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+	const int dir_fd = (fd == -1 ? -1 : fcntl(fd, F_DUPFD_CLOEXEC, 0));
+	DIR *const d = (dir_fd == -1 ? NULL : fdopendir(dir_fd));
+	if(d == NULL)
+	{
+		rm_fail(state, IO_RES_FAILED, dir->path, NULL, errno,
+				"Failed to open directory");
+		if(dir_fd != -1)
+		{
+			(void)close(dir_fd);
+		}
+		if(fd != -1)
+		{
+			(void)close(fd);
+		}
+		return;
+	}
+	dir->fd = fd;
+
+	struct dirent *entry;
+	while((entry = readdir(d)) != NULL)
+	{
+		if(is_builtin_dir(entry->d_name))
+		{
+			continue;
+		}
+
+		if(rm_stopped(state))
+		{
+			break;
+		}
+
+		if(io_cancelled(args))
+		{
+			rm_fail(state, IO_RES_ABORTED, NULL, NULL, 0, NULL);
+			break;
+		}
+
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+		int entry_is_dir = (entry->d_type == DT_DIR);
+		const int type_known = (entry->d_type != DT_UNKNOWN);
+#else
+		int entry_is_dir = 0;
+		const int type_known = 0;
+#endif
+
+		/* Size is needed only for progress reporting. */
+		struct stat st;
+		int have_st = 0;
+		if(!type_known || (!entry_is_dir && args->estim != NULL))
+		{
+			have_st = (fstatat(fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0);
+			entry_is_dir = (have_st && S_ISDIR(st.st_mode));
+		}
+
+		if(entry_is_dir)
+		{
+			rm_queue_dir(state, dir, join_paths(dir->path, entry->d_name),
+					entry->d_name);
+			continue;
+		}
+
+		if(unlinkat(fd, entry->d_name, 0) != 0)
+		{
+			rm_fail(state, IO_RES_FAILED, dir->path, entry->d_name, errno,
+					"Failed to unlink file");
+			break;
+		}
+
+		pthread_mutex_lock(&state->lock);
+		ioeta_update(args->estim, NULL, NULL, 1,
+				(have_st && S_ISREG(st.st_mode)) ? st.st_size : 0);
+		pthread_mutex_unlock(&state->lock);
+	}
+	(void)closedir(d);
+
+	rm_dir_finished(state, dir);
+}
+
+/* Puts directory onto the stack of directories to be scanned.  Takes ownership
+ * of the path, name is its last component (the whole path for the root). */
+static void
+rm_queue_dir(rm_state_t *state, rm_dir_t *parent, char *path,
+		const char name[])
+{
+	rm_dir_t *const dir = (path == NULL ? NULL : malloc(sizeof(*dir)));
+	if(dir == NULL)
+	{
+		rm_fail(state, IO_RES_FAILED,
+				parent == NULL ? state->args->arg1.path : parent->path, NULL,
+				IO_ERR_UNKNOWN, "Not enough memory");
+		free(path);
+		return;
+	}
+
+	dir->path = path;
+	dir->name = (parent == NULL ? path : path + strlen(path) - strlen(name));
+	dir->fd = -1;
+	dir->parent = parent;
+	dir->pending = 1;
+
+	pthread_mutex_lock(&state->lock);
+	if(parent != NULL)
+	{
+		++parent->pending;
+	}
+	dir->next = state->queue;
+	state->queue = dir;
+	dir->next_allocated = state->allocated;
+	state->allocated = dir;
+	pthread_cond_signal(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Accounts for finishing scanning a directory or removing its subdirectory and
+ * removes the directory along with its parents if they have nothing else left
+ * in them. */
+static void
+rm_dir_finished(rm_state_t *state, rm_dir_t *dir)
+{
+	while(dir != NULL)
+	{
+		pthread_mutex_lock(&state->lock);
+		const int empty = (--dir->pending == 0 && !state->stop);
+		pthread_mutex_unlock(&state->lock);
+
+		if(!empty)
+		{
+			break;
+		}
+
+		(void)close(dir->fd);
+		dir->fd = -1;
+
+		if(unlinkat(rm_parent_fd(dir), dir->name, AT_REMOVEDIR) != 0)
+		{
+			rm_fail(state, IO_RES_FAILED, dir->path, NULL, errno,
+					"Failed to remove directory");
+			break;
+		}
+
+		pthread_mutex_lock(&state->lock);
+		ioeta_update(state->args->estim, NULL, NULL, 1, 0);
+		pthread_mutex_unlock(&state->lock);
+
+		dir = dir->parent;
+	}
+}
+
+/* Retrieves descriptor relative to which the directory is opened and removed.
+ * Returns the descriptor. */
+static int
+rm_parent_fd(const rm_dir_t *dir)
+{
+	return (dir->parent == NULL ? AT_FDCWD : dir->parent->fd);
+}
+
+/* Stops removal and records its result and an error if msg isn't NULL.  The
+ * name can be NULL, otherwise it's appended to the path.  Only the first
+ * failure is recorded. */
+static void
+rm_fail(rm_state_t *state, IoRes result, const char path[], const char name[],
+		int error_code, const char msg[])
+{
+	char *const full_path = (name == NULL ? NULL : join_paths(path, name));
+
+	pthread_mutex_lock(&state->lock);
+	if(!state->stop)
+	{
+		__atomic_store_n(&state->stop, 1, __ATOMIC_RELAXED);
+		state->result = result;
+		if(msg != NULL)
+		{
+			(void)ioe_errlst_append(&state->args->result.errors,
+					full_path == NULL ? path : full_path, error_code, msg);
+		}
+		pthread_cond_broadcast(&state->cond);
+	}
+	pthread_mutex_unlock(&state->lock);
+
+	free(full_path);
+}
+
+/* Checks whether removal should stop without taking a lock.  Returns non-zero
+ * if so. */
+static int
+rm_stopped(rm_state_t *state)
+{
+	return __atomic_load_n(&state->stop, __ATOMIC_RELAXED);
+}
+
+#endif
+
 /* Implementation of traverse() visitor for subtree removal.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
@@ -154,15 +594,398 @@ ior_cp(io_args_t *args)
 		}
 	}
 
-	return traverse(src, &cp_visitor, args);
+	cp_tree_t tree = { .args = args };
+#ifndef _WIN32
+	/* Hard links are recreated within the tree instead of copying data of the
+	 * same file several times.  Inode numbers aren't reliable on Windows. */
+	tree.links = trie_create(&free);
+#endif
+
+	IoRes result;
+	if(can_cp_in_parallel(args))
+	{
+		result = cp_in_parallel(args, tree.links);
+	}
+	else
+	{
+		result = traverse_ex(src, TF_STAT, &cp_visitor, &tree);
+	}
+
+	trie_free(tree.links);
+	return result;
+}
+
+/* Checks whether copying can be performed by several threads.  Returns non-zero
+ * if so. */
+static int
+can_cp_in_parallel(const io_args_t *args)
+{
+	const char *const src = args->arg1.src;
+
+	/* Parallel copying can't ask user for anything. */
+	return args->arg4.parallel_jobs > 1
+	    && args->confirm == NULL
+	    && args->result.errors_cb == NULL
+	    && args->arg3.crs != IO_CRS_APPEND_TO_FILES
+	    && !is_symlink(src)
+	    && is_dir(src);
+}
+
+/* Copies a directory by creating directory structure first, copying files in
+ * parallel by batches and then updating attributes of directories.  Errors are
+ * reported in the order of traversal.  Returns status. */
+static IoRes
+cp_in_parallel(io_args_t *args, trie_t *links)
+{
+	cp_state_t *const state = calloc(1, sizeof(*state));
+	if(state == NULL)
+	{
+		cp_tree_t tree = { .args = args, .links = links };
+		return traverse_ex(args->arg1.src, TF_STAT, &cp_visitor, &tree);
+	}
+
+	state->args = args;
+	state->links = links;
+	pthread_mutex_init(&state->lock, NULL);
+
+	IoRes result = traverse_ex(args->arg1.src, TF_STAT, &parallel_cp_visitor,
+			state);
+	if(result == IO_RES_SUCCEEDED)
+	{
+		result = run_cp_jobs(state);
+	}
+	else
+	{
+		drop_cp_jobs(state);
+	}
+
+	/* Directories are processed after all files in them, so that adding files
+	 * doesn't change their timestamps and permissions don't get in the way. */
+	int i;
+	for(i = 0; i < state->dirs.nitems && result == IO_RES_SUCCEEDED; ++i)
+	{
+		const VisitResult vr = cp_mv_visitor(state->dirs.items[i], VA_DIR_LEAVE,
+				NULL, args, 1, NULL);
+		result = (vr == VR_OK ? IO_RES_SUCCEEDED : IO_RES_FAILED);
+	}
+
+	free_string_array(state->dirs.items, state->dirs.nitems);
+	pthread_mutex_destroy(&state->lock);
+	free(state);
+	return result;
+}
+
+/* Implementation of traverse_ex() visitor for parallel subtree copying, which
+ * creates directories and collects files.  Returns 0 on success, otherwise
+ * non-zero is returned. */
+static VisitResult
+parallel_cp_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
+{
+	cp_state_t *const state = param;
+	io_args_t *const cp_args = state->args;
+
+	if(io_cancelled(cp_args))
+	{
+		return VR_CANCELLED;
+	}
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			return cp_mv_visitor(full_path, action, entry, cp_args, 1, NULL);
+		case VA_DIR_LEAVE:
+			state->dirs.nitems = add_to_string_array(&state->dirs.items,
+					state->dirs.nitems, full_path);
+			return VR_OK;
+		case VA_FILE:
+			break;
+	}
+
+	const char *const rel_part = full_path + strlen(cp_args->arg1.src);
+	cp_job_t *const job = &state->jobs[state->njobs];
+	job->src = strdup(full_path);
+	job->dst = join_paths(cp_args->arg2.dst, rel_part);
+	job->errors = (ioe_errlst_t){ .active = cp_args->result.errors.active };
+	if(job->src == NULL || job->dst == NULL)
+	{
+		free(job->src);
+		free(job->dst);
+		(void)ioe_errlst_append(&cp_args->result.errors, full_path,
+				IO_ERR_UNKNOWN, "Not enough memory");
+		return VR_ERROR;
+	}
+	/* Links are made after the batch is copied as their target might be in the
+	 * same batch. */
+	job->link = find_link_copy(state->links, job->src, job->dst, entry->st);
+	job->result = IO_RES_SUCCEEDED;
+	++state->njobs;
+
+	if(state->njobs == CP_BATCH_SIZE)
+	{
+		return vr_from_io_res(run_cp_jobs(state));
+	}
+	return VR_OK;
+}
+
+/* Copies collected files using several threads and empties the list.  Returns
+ * status of the first failed job in the list. */
+static IoRes
+run_cp_jobs(cp_state_t *state)
+{
+	io_args_t *const args = state->args;
+	const size_t nthreads = MIN(state->njobs,
+			(size_t)MIN(args->arg4.parallel_jobs, MAX_CP_JOBS));
+
+	state->next_job = 0U;
+	state->failed = 0;
+
+	/* Destination directory exists at this point. */
+	struct stat dst_st;
+	state->on_device = (os_stat(args->arg2.dst, &dst_st) == 0);
+	state->dev = (state->on_device ? dst_st.st_dev : 0);
+
+	/* Workers report progress of each file as they go. */
+	if(args->estim != NULL)
+	{
+		args->estim->lock = &state->lock;
+	}
+
+	/* Current thread is one of the workers. */
+	pthread_t threads[MAX_CP_JOBS];
+	size_t i, nstarted = 0U;
+	for(i = 1U; i < nthreads; ++i)
+	{
+		if(pthread_create(&threads[nstarted], NULL, &cp_worker, state) == 0)
+		{
+			++nstarted;
+		}
+	}
+	(void)cp_worker(state);
+	for(i = 0U; i < nstarted; ++i)
+	{
+		(void)pthread_join(threads[i], NULL);
+	}
+
+	if(args->estim != NULL)
+	{
+		args->estim->lock = NULL;
+	}
+
+	for(i = 0U; i < state->njobs; ++i)
+	{
+		cp_job_t *const job = &state->jobs[i];
+		if(job->link == NULL || state->failed)
+		{
+			continue;
+		}
+
+		if(cp_as_link(args, job->src, job->dst, job->link) == 0)
+		{
+			job->result = IO_RES_SUCCEEDED;
+			continue;
+		}
+
+		/* Fall back to copying when a link can't be made. */
+		io_args_t cp_args = {
+			.arg1.src = job->src,
+			.arg2.dst = job->dst,
+			.arg3.crs = args->arg3.crs,
+			.arg4 = args->arg4,
+
+			.cancellation = args->cancellation,
+			.estim = args->estim,
+
+			.result.errors = job->errors,
+		};
+		job->result = iop_cp(&cp_args);
+		job->errors = cp_args.result.errors;
+		if(job->result == IO_RES_FAILED || job->result == IO_RES_ABORTED)
+		{
+			state->failed = 1;
+		}
+	}
+
+	IoRes result = IO_RES_SUCCEEDED;
+	for(i = 0U; i < state->njobs; ++i)
+	{
+		cp_job_t *const job = &state->jobs[i];
+		if(result == IO_RES_SUCCEEDED &&
+				(job->result == IO_RES_FAILED || job->result == IO_RES_ABORTED))
+		{
+			result = job->result;
+		}
+
+		ioe_errlst_splice(&args->result.errors, &job->errors);
+		ioe_errlst_free(&job->errors);
+		free(job->src);
+		free(job->dst);
+	}
+	state->njobs = 0U;
+
+	if(result == IO_RES_SUCCEEDED && io_cancelled(args))
+	{
+		result = IO_RES_ABORTED;
+	}
+	return result;
+}
+
+/* Entry point of a thread that copies files.  Returns NULL. */
+static void *
+cp_worker(void *arg)
+{
+	cp_state_t *const state = arg;
+	io_args_t *const cp_args = state->args;
+
+	while(1)
+	{
+		pthread_mutex_lock(&state->lock);
+		const int done = (state->failed || state->next_job == state->njobs);
+		cp_job_t *const job = (done ? NULL : &state->jobs[state->next_job++]);
+		pthread_mutex_unlock(&state->lock);
+
+		if(job == NULL)
+		{
+			break;
+		}
+
+		if(job->link != NULL)
+		{
+			/* Done by run_cp_jobs() after all copies are made. */
+			continue;
+		}
+
+		if(io_cancelled(cp_args))
+		{
+			job->result = IO_RES_ABORTED;
+			continue;
+		}
+
+		/* Updates of estimation are serialized by run_cp_jobs(). */
+		io_args_t args = {
+			.arg1.src = job->src,
+			.arg2.dst = job->dst,
+			.arg3.crs = cp_args->arg3.crs,
+			.arg4 = cp_args->arg4,
+
+			.cancellation = cp_args->cancellation,
+			.estim = cp_args->estim,
+
+			.result.errors = job->errors,
+		};
+
+		/* Number of files copied to a device at once is limited for all
+		 * operations together, not just for this one. */
+		if(state->on_device)
+		{
+			bg_dev_acquire(state->dev, cp_args->arg4.parallel_jobs);
+		}
+		job->result = iop_cp(&args);
+		if(state->on_device)
+		{
+			bg_dev_release(state->dev);
+		}
+		job->errors = args.result.errors;
+
+		if(job->result == IO_RES_FAILED || job->result == IO_RES_ABORTED)
+		{
+			pthread_mutex_lock(&state->lock);
+			state->failed = 1;
+			pthread_mutex_unlock(&state->lock);
+		}
+	}
+
+	return NULL;
+}
+
+/* Frees collected jobs without performing them. */
+static void
+drop_cp_jobs(cp_state_t *state)
+{
+	size_t i;
+	for(i = 0U; i < state->njobs; ++i)
+	{
+		free(state->jobs[i].src);
+		free(state->jobs[i].dst);
+	}
+	state->njobs = 0U;
+}
+
+/* Looks up copy of another hard link to the same file as src.  Remembers dst as
+ * such a copy if there is none yet.  links can be NULL.  st is result of
+ * lstat() on src or NULL to query it.  Returns path to the copy or NULL if src
+ * has to be copied. */
+static const char *
+find_link_copy(trie_t *links, const char src[], const char dst[],
+		const struct stat *st)
+{
+#ifndef _WIN32
+	struct stat src_st;
+	if(links == NULL)
+	{
+		return NULL;
+	}
+	if(st == NULL)
+	{
+		if(os_lstat(src, &src_st) != 0)
+		{
+			return NULL;
+		}
+		st = &src_st;
+	}
+	if(!S_ISREG(st->st_mode) || st->st_nlink < 2)
+	{
+		return NULL;
+	}
+
+	char key[64];
+	snprintf(key, sizeof(key), "%llx:%llx", (unsigned long long)st->st_dev,
+			(unsigned long long)st->st_ino);
+
+	void *data;
+	if(trie_get(links, key, &data) == 0)
+	{
+		return data;
+	}
+
+	char *const copy = strdup(dst);
+	if(copy != NULL && trie_set(links, key, copy) != 0)
+	{
+		free(copy);
+	}
+#endif
+	return NULL;
 }
 
-/* Implementation of traverse() visitor for subtree copying.  Returns 0 on
+/* Creates dst as a hard link to target, which is a copy of another link to src.
+ * Existing dst is left for copying to deal with.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+cp_as_link(io_args_t *args, const char src[], const char dst[],
+		const char target[])
+{
+#ifndef _WIN32
+	if(path_exists(dst, NODEREF) || link(target, dst) != 0)
+	{
+		return 1;
+	}
+
+	/* No data is copied. */
+	ioeta_update(args->estim, src, dst, /*finished=*/1, 0);
+	return 0;
+#else
+	return 1;
+#endif
+}
+
+/* Implementation of traverse_ex() visitor for subtree copying.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-cp_visitor(const char full_path[], VisitAction action, void *param)
+cp_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
 {
-	return cp_mv_visitor(full_path, action, param, 1);
+	cp_tree_t *const tree = param;
+	return cp_mv_visitor(full_path, action, entry, tree->args, 1, tree->links);
 }
 
 IoRes
@@ -360,7 +1183,7 @@ mv_replacing_files(io_args_t *args)
 		}
 	}
 
-	return traverse(src, &mv_visitor, args);
+	return traverse_ex(src, TF_NONE, &mv_visitor, args);
 }
 
 /* Checks that path points to a file or symbolic link.  Returns non-zero if so,
@@ -372,18 +1195,21 @@ is_file(const char path[])
 	    || (is_symlink(path) && get_symlink_type(path) != SLT_UNKNOWN);
 }
 
-/* Implementation of traverse() visitor for subtree moving.  Returns 0 on
+/* Implementation of traverse_ex() visitor for subtree moving.  Returns 0 on
  * success, otherwise non-zero is returned. */
 static VisitResult
-mv_visitor(const char full_path[], VisitAction action, void *param)
+mv_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
 {
-	return cp_mv_visitor(full_path, action, param, 0);
+	return cp_mv_visitor(full_path, action, entry, param, 0, NULL);
 }
 
-/* Generic implementation of traverse() visitor for subtree copying/moving.
- * Returns 0 on success, otherwise non-zero is returned. */
+/* Generic implementation of traverse_ex() visitor for subtree copying/moving.
+ * entry can be NULL.  links is used to recreate hard links on copying and can
+ * be NULL.  Returns 0 on success, otherwise non-zero is returned. */
 static VisitResult
-cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
+cp_mv_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param, int cp, trie_t *links)
 {
 	io_args_t *const cp_args = param;
 	const char *dst_full_path;
@@ -405,7 +1231,9 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 	switch(action)
 	{
 		case VA_DIR_ENTER:
-			if(cp_args->arg3.crs != IO_CRS_REPLACE_FILES || !is_dir(dst_full_path))
+			if((cp_args->arg3.crs != IO_CRS_REPLACE_FILES &&
+						cp_args->arg3.crs != IO_CRS_APPEND_TO_FILES) ||
+					!is_dir(dst_full_path))
 			{
 				io_args_t args = {
 					.arg1.path = dst_full_path,
@@ -424,6 +1252,25 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 			}
 			break;
 		case VA_FILE:
+			if(cp_args->arg3.crs == IO_CRS_APPEND_TO_FILES &&
+					!is_regular_file_noderef(full_path) &&
+					path_exists(dst_full_path, NODEREF))
+			{
+				/* There is nothing to append to for files of other types. */
+				ioeta_update(cp_args->estim, full_path, dst_full_path, 1, 0);
+				break;
+			}
+
+			{
+				const char *const link_copy = find_link_copy(links, full_path,
+						dst_full_path, (entry == NULL ? NULL : entry->st));
+				if(link_copy != NULL &&
+						cp_as_link(cp_args, full_path, dst_full_path, link_copy) == 0)
+				{
+					break;
+				}
+			}
+
 			{
 				io_args_t args = {
 					.arg1.src = full_path,
@@ -432,6 +1279,10 @@ cp_mv_visitor(const char full_path[], VisitAction action, void *param, int cp)
 					/* It's safe to always use fast file cloning on moving files. */
 					.arg4.fast_file_cloning = cp ? cp_args->arg4.fast_file_cloning : 1,
 					.arg4.data_sync = cp_args->arg4.data_sync,
+					.arg4.sparse_files = cp_args->arg4.sparse_files,
+					.arg4.io_uring = cp_args->arg4.io_uring,
+					.arg4.bypass_cache = cp_args->arg4.bypass_cache,
+					.arg4.verify_data = cp_args->arg4.verify_data,
 
 					.cancellation = cp_args->cancellation,
 					.confirm = cp_args->confirm,
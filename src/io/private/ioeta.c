@@ -18,13 +18,20 @@
 
 #include "ioeta.h"
 
-#include <stddef.h> /* NULL */
+#include <sys/stat.h> /* S_ISLNK() S_ISREG() stat */
+#include <pthread.h> /* pthread_mutex_t pthread_mutex_lock()
+                        pthread_mutex_unlock() */
+
+#include <stddef.h> /* NULL size_t */
 #include <stdint.h> /* uint64_t */
+#include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
 #include <string.h> /* strdup() */
 
+#include "../../compat/os.h"
 #include "../../utils/fs.h"
 #include "../../utils/str.h"
+#include "../../utils/trie.h"
 #include "../ioeta.h"
 #include "ionotif.h"
 
@@ -45,14 +52,54 @@ ioeta_add_item(ioeta_estim_t *estim, const char path[])
 	ionotif_notify(IO_PS_ESTIMATING, estim);
 }
 
-void
-ioeta_add_file(ioeta_estim_t *estim, const char path[])
+uint64_t
+ioeta_file_size(struct trie_t **links, const char path[],
+		const struct stat *st)
 {
-	if(!is_symlink(path))
+#ifndef _WIN32
+	struct stat path_st;
+	if(st == NULL)
 	{
-		estim->total_bytes += get_file_size(path);
+		if(os_lstat(path, &path_st) != 0)
+		{
+			return 0U;
+		}
+		st = &path_st;
 	}
 
+	if(S_ISLNK(st->st_mode))
+	{
+		return 0U;
+	}
+
+	if(S_ISREG(st->st_mode) && st->st_nlink > 1)
+	{
+		char key[64];
+		snprintf(key, sizeof(key), "%llx:%llx", (unsigned long long)st->st_dev,
+				(unsigned long long)st->st_ino);
+
+		if(*links == NULL)
+		{
+			*links = trie_create(NULL);
+		}
+		if(*links != NULL && trie_put(*links, key) > 0)
+		{
+			return 0U;
+		}
+	}
+
+	return st->st_size;
+#else
+	(void)links;
+	(void)st;
+	return (is_symlink(path) ? 0U : get_file_size(path));
+#endif
+}
+
+void
+ioeta_add_file(ioeta_estim_t *estim, const char path[])
+{
+	estim->total_bytes += ioeta_file_size(&estim->links, path, NULL);
 	ioeta_add_item(estim, path);
 }
 
@@ -78,9 +125,20 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		return;
 	}
 
+	pthread_mutex_t *const lock = estim->lock;
+	if(lock != NULL)
+	{
+		pthread_mutex_lock(lock);
+	}
+
+	ioeta_sync(estim);
+
 	estim->current_byte += bytes;
-	estim->current_file_byte += bytes;
-	if(estim->current_byte > estim->total_bytes)
+	if(lock == NULL)
+	{
+		estim->current_file_byte += bytes;
+	}
+	if(!estim->estimating && estim->current_byte > estim->total_bytes)
 	{
 		/* Estimations are out of date, update them. */
 		estim->total_bytes = estim->current_byte;
@@ -89,7 +147,7 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	if(finished)
 	{
 		++estim->current_item;
-		if(estim->current_item > estim->total_items)
+		if(!estim->estimating && estim->current_item > estim->total_items)
 		{
 			/* Estimations are out of date, update them. */
 			estim->total_items = estim->current_item;
@@ -97,7 +155,7 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 		estim->current_file_byte = 0U;
 		estim->total_file_bytes = 0U;
 	}
-	else if(estim->inspected_items != estim->current_item + 1)
+	else if(lock == NULL && estim->inspected_items != estim->current_item + 1)
 	{
 		estim->inspected_items = estim->current_item + 1;
 		estim->total_file_bytes = get_file_size(path);
@@ -114,6 +172,11 @@ ioeta_update(ioeta_estim_t *estim, const char path[], const char target[],
 	}
 
 	ionotif_notify(IO_PS_IN_PROGRESS, estim);
+
+	if(lock != NULL)
+	{
+		pthread_mutex_unlock(lock);
+	}
 }
 
 int
@@ -164,9 +227,25 @@ ioeta_restore(ioeta_estim_t *estim, const ioeta_estim_t *save)
 	update_string(&item, save->item);
 	update_string(&target, save->target);
 
+	const size_t total_items = estim->total_items;
+	const uint64_t total_bytes = estim->total_bytes;
+	const int estimating = estim->estimating;
+	struct ioeta_bg_t *const bg = estim->bg;
+	struct trie_t *const links = estim->links;
+
 	*estim = *save;
 	estim->item = item;
 	estim->target = target;
+	estim->bg = bg;
+	estim->links = links;
+
+	if(bg != NULL)
+	{
+		/* Totals that come from background calculation can't be rolled back. */
+		estim->total_items = total_items;
+		estim->total_bytes = total_bytes;
+		estim->estimating = estimating;
+	}
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
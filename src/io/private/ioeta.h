@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__PRIVATE__IOETA_H__
 #define VIFM__IO__PRIVATE__IOETA_H__
 
+#include <sys/stat.h> /* stat */
+
 #include <stdint.h> /* uint64_t */
 
 #include "../ioeta.h"
@@ -29,6 +31,17 @@
  * NULL. */
 void ioeta_release(ioeta_estim_t *estim);
 
+/* Merges results of calculation in background into the estimation.  Updates
+ * estim->estimating flag. */
+void ioeta_sync(ioeta_estim_t *estim);
+
+/* Retrieves size of a file for the estimation.  Files with several hard links
+ * are counted only once as copying recreates links instead of duplicating
+ * data, *links is a set of such files that's created on first use.  st is
+ * result of lstat() on the path or NULL to query it.  Returns the size. */
+uint64_t ioeta_file_size(struct trie_t **links, const char path[],
+		const struct stat *st);
+
 /* Adds zero-size item to the estimation. */
 void ioeta_add_item(ioeta_estim_t *estim, const char path[]);
 
@@ -0,0 +1,324 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "iouring.h"
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h> /* IORING_* io_uring_* */
+#include <sys/mman.h> /* MAP_* PROT_* mmap() munmap() */
+#include <sys/syscall.h> /* __NR_io_uring_enter __NR_io_uring_setup */
+#include <unistd.h> /* close() syscall() */
+#endif
+
+#include <errno.h> /* EINTR ENOSYS errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
+#include <stdlib.h> /* calloc() free() */
+#include <string.h> /* memset() */
+
+#ifdef HAVE_LINUX_IO_URING_H
+
+/* Description of a ring shared with the kernel. */
+struct iouring_t
+{
+	int fd; /* File descriptor of the ring. */
+
+	void *sq_ptr;   /* Mapping of submission queue. */
+	size_t sq_size; /* Size of sq_ptr mapping. */
+	void *cq_ptr;   /* Mapping of completion queue (can be equal to sq_ptr). */
+	size_t cq_size; /* Size of cq_ptr mapping. */
+
+	struct io_uring_sqe *sqes; /* Array of submission queue entries. */
+	size_t sqes_size;          /* Size of sqes mapping. */
+
+	unsigned int *sq_head;  /* Head of submission queue (moved by the kernel). */
+	unsigned int *sq_tail;  /* Tail of submission queue (moved by us). */
+	unsigned int sq_mask;   /* Mask for submission queue indexes. */
+	unsigned int sq_len;    /* Number of entries in submission queue. */
+	unsigned int *sq_array; /* Indirection array of submission queue. */
+
+	unsigned int *cq_head;     /* Head of completion queue (moved by us). */
+	unsigned int *cq_tail;     /* Tail of completion queue (moved by kernel). */
+	unsigned int cq_mask;      /* Mask for completion queue indexes. */
+	struct io_uring_cqe *cqes; /* Array of completion queue entries. */
+
+	unsigned int to_submit; /* Number of queued, but not yet submitted entries. */
+};
+
+static struct io_uring_sqe * get_sqe(iouring_t *ring);
+static int enter(iouring_t *ring);
+
+iouring_t *
+iouring_create(unsigned int entries)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	const int fd = syscall(__NR_io_uring_setup, entries, &params);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	/* IORING_OP_READ and IORING_OP_WRITE appeared along with this feature. */
+	if(!(params.features & IORING_FEAT_RW_CUR_POS))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	iouring_t *const ring = calloc(1, sizeof(*ring));
+	if(ring == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	ring->fd = fd;
+	ring->sq_ptr = MAP_FAILED;
+	ring->cq_ptr = MAP_FAILED;
+	ring->sqes = MAP_FAILED;
+
+	ring->sq_size = params.sq_off.array + params.sq_entries*sizeof(unsigned int);
+	ring->cq_size = params.cq_off.cqes
+	              + params.cq_entries*sizeof(struct io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(ring->cq_size > ring->sq_size)
+		{
+			ring->sq_size = ring->cq_size;
+		}
+		ring->cq_size = ring->sq_size;
+	}
+
+	ring->sq_ptr = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(ring->sq_ptr == MAP_FAILED)
+	{
+		iouring_free(ring);
+		return NULL;
+	}
+
+	if(params.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		ring->cq_ptr = ring->sq_ptr;
+	}
+	else
+	{
+		ring->cq_ptr = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if(ring->cq_ptr == MAP_FAILED)
+		{
+			iouring_free(ring);
+			return NULL;
+		}
+	}
+
+	ring->sqes_size = params.sq_entries*sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(ring->sqes == MAP_FAILED)
+	{
+		iouring_free(ring);
+		return NULL;
+	}
+
+	char *const sq = ring->sq_ptr;
+	ring->sq_head = (unsigned int *)(sq + params.sq_off.head);
+	ring->sq_tail = (unsigned int *)(sq + params.sq_off.tail);
+	ring->sq_mask = *(unsigned int *)(sq + params.sq_off.ring_mask);
+	ring->sq_len = *(unsigned int *)(sq + params.sq_off.ring_entries);
+	ring->sq_array = (unsigned int *)(sq + params.sq_off.array);
+
+	char *const cq = ring->cq_ptr;
+	ring->cq_head = (unsigned int *)(cq + params.cq_off.head);
+	ring->cq_tail = (unsigned int *)(cq + params.cq_off.tail);
+	ring->cq_mask = *(unsigned int *)(cq + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	return ring;
+}
+
+void
+iouring_free(iouring_t *ring)
+{
+	if(ring == NULL)
+	{
+		return;
+	}
+
+	if(ring->sqes != MAP_FAILED)
+	{
+		(void)munmap(ring->sqes, ring->sqes_size);
+	}
+	if(ring->cq_ptr != MAP_FAILED && ring->cq_ptr != ring->sq_ptr)
+	{
+		(void)munmap(ring->cq_ptr, ring->cq_size);
+	}
+	if(ring->sq_ptr != MAP_FAILED)
+	{
+		(void)munmap(ring->sq_ptr, ring->sq_size);
+	}
+	close(ring->fd);
+	free(ring);
+}
+
+int
+iouring_read(iouring_t *ring, int fd, void *buf, unsigned int len,
+		uint64_t offset, uint64_t data)
+{
+	struct io_uring_sqe *const sqe = get_sqe(ring);
+	if(sqe == NULL)
+	{
+		return 1;
+	}
+
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = offset;
+	sqe->user_data = data;
+	return 0;
+}
+
+int
+iouring_write(iouring_t *ring, int fd, const void *buf, unsigned int len,
+		uint64_t offset, uint64_t data)
+{
+	struct io_uring_sqe *const sqe = get_sqe(ring);
+	if(sqe == NULL)
+	{
+		return 1;
+	}
+
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)buf;
+	sqe->len = len;
+	sqe->off = offset;
+	sqe->user_data = data;
+	return 0;
+}
+
+/* Puts new zeroed entry at the end of submission queue.  Returns pointer to
+ * the entry or NULL if the queue is full. */
+static struct io_uring_sqe *
+get_sqe(iouring_t *ring)
+{
+	const unsigned int tail = *ring->sq_tail;
+	const unsigned int head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+	if(tail - head >= ring->sq_len)
+	{
+		return NULL;
+	}
+
+	const unsigned int idx = tail & ring->sq_mask;
+	struct io_uring_sqe *const sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	ring->sq_array[idx] = idx;
+
+	/* The entry must be filled in before the kernel sees new tail, which happens
+	 * only on entering the kernel, so it's fine to publish it right away. */
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	++ring->to_submit;
+	return sqe;
+}
+
+int
+iouring_wait(iouring_t *ring, uint64_t *data, int *res)
+{
+	while(1)
+	{
+		const unsigned int head = *ring->cq_head;
+		const unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+		if(head != tail && ring->to_submit == 0U)
+		{
+			const struct io_uring_cqe *const cqe = &ring->cqes[head & ring->cq_mask];
+			*data = cqe->user_data;
+			*res = cqe->res;
+			__atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+			return 0;
+		}
+
+		if(enter(ring) != 0)
+		{
+			return 1;
+		}
+	}
+}
+
+/* Submits pending requests and waits for at least one completion.  Returns
+ * zero on success, otherwise non-zero is returned and errno is set. */
+static int
+enter(iouring_t *ring)
+{
+	const unsigned int head = *ring->cq_head;
+	const unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	/* Don't wait if there is something to process already. */
+	const unsigned int min_complete = (head == tail ? 1U : 0U);
+
+	const int n = syscall(__NR_io_uring_enter, ring->fd, ring->to_submit,
+			min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+	if(n < 0)
+	{
+		return (errno == EINTR ? 0 : 1);
+	}
+
+	ring->to_submit -= n;
+	return 0;
+}
+
+#else
+
+iouring_t *
+iouring_create(unsigned int entries)
+{
+	return NULL;
+}
+
+void
+iouring_free(iouring_t *ring)
+{
+}
+
+int
+iouring_read(iouring_t *ring, int fd, void *buf, unsigned int len,
+		uint64_t offset, uint64_t data)
+{
+	return 1;
+}
+
+int
+iouring_write(iouring_t *ring, int fd, const void *buf, unsigned int len,
+		uint64_t offset, uint64_t data)
+{
+	return 1;
+}
+
+int
+iouring_wait(iouring_t *ring, uint64_t *data, int *res)
+{
+	errno = ENOSYS;
+	return 1;
+}
+
+#endif
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
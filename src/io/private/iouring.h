@@ -0,0 +1,60 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__IO__PRIVATE__IOURING_H__
+#define VIFM__IO__PRIVATE__IOURING_H__
+
+#include <stdint.h> /* uint64_t */
+
+/* iouring - minimal wrapper around Linux io_uring interface for asynchronous
+ * reading and writing of files */
+
+/* Opaque declaration of structure describing a ring. */
+typedef struct iouring_t iouring_t;
+
+/* Creates a ring that can hold at least entries requests in flight.  Returns
+ * NULL if io_uring isn't available (not compiled in, not supported by the
+ * kernel or forbidden) or on error. */
+iouring_t * iouring_create(unsigned int entries);
+
+/* Frees resources of the ring.  The ring can be NULL.  Requests in flight must
+ * be waited for before calling this function. */
+void iouring_free(iouring_t *ring);
+
+/* Queues reading of len bytes at the offset into the buffer.  The data is
+ * returned on completion to identify the request.  Returns zero on success and
+ * non-zero if the queue is full. */
+int iouring_read(iouring_t *ring, int fd, void *buf, unsigned int len,
+		uint64_t offset, uint64_t data);
+
+/* Queues writing of len bytes from the buffer at the offset.  The data is
+ * returned on completion to identify the request.  Returns zero on success and
+ * non-zero if the queue is full. */
+int iouring_write(iouring_t *ring, int fd, const void *buf, unsigned int len,
+		uint64_t offset, uint64_t data);
+
+/* Submits queued requests and waits for completion of at least one request.
+ * *data receives data of completed request and *res its result (number of
+ * bytes or negated errno value).  Returns zero on success, otherwise non-zero
+ * is returned and errno is set. */
+int iouring_wait(iouring_t *ring, uint64_t *data, int *res);
+
+#endif /* VIFM__IO__PRIVATE__IOURING_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
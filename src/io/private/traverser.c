@@ -18,47 +18,373 @@
 
 #include "traverser.h"
 
-#include <stddef.h> /* NULL */
-#include <stdlib.h> /* free() */
+#ifndef _WIN32
+#include <dirent.h> /* DIR closedir() dirfd() fdopendir() readdir() */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW O_* fstatat() open() openat() */
+#include <unistd.h> /* close() */
+#endif
+#include <sys/stat.h> /* S_IF* stat */
 
+#include <stddef.h> /* NULL size_t */
+#include <stdlib.h> /* free() realloc() */
+#include <string.h> /* memcpy() strlen() */
+
+#include "../../compat/dtype.h"
 #include "../../compat/os.h"
 #include "../../utils/fs.h"
 #include "../../utils/path.h"
 #include "../../utils/str.h"
 
-static VisitResult traverse_subtree(const char path[], subtree_visitor visitor,
-		void *param);
+/* Visitor of traverse() along with its parameter. */
+typedef struct
+{
+	subtree_visitor visitor; /* Visitor that doesn't need entry information. */
+	void *param;             /* Parameter for the visitor. */
+}
+simple_visitor_t;
+
+#ifndef _WIN32
+
+/* Directory which is being read. */
+typedef struct
+{
+	DIR *dir;        /* Stream of entries of the directory. */
+	size_t path_len; /* Length of path to the directory. */
+	size_t name_pos; /* Offset of name of the directory within its path. */
+	int skip_leave;  /* Whether VA_DIR_LEAVE shouldn't be reported. */
+}
+trav_dir_t;
+
+/* State of traversal. */
+typedef struct
+{
+	TraverseFlags flags;        /* Flags of the traversal. */
+	subtree_visitor_ex visitor; /* Visitor of entries. */
+	void *param;                /* Parameter for the visitor. */
+
+	char *path;      /* Path to current entry. */
+	size_t path_cap; /* Capacity of the path buffer. */
+
+	trav_dir_t *stack; /* Stack of directories being read. */
+	size_t depth;      /* Number of elements of the stack. */
+	size_t stack_cap;  /* Capacity of the stack. */
+}
+trav_state_t;
+
+#endif
+
+static VisitResult simple_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param);
+static VisitResult traverse_root(const char path[], TraverseFlags flags,
+		subtree_visitor_ex visitor, void *param);
+#ifndef _WIN32
+static VisitResult traverse_step(trav_state_t *state);
+static VisitResult enter_dir(trav_state_t *state, int fd,
+		const visit_entry_t *entry);
+static int append_name(trav_state_t *state, size_t len, const char name[]);
+static unsigned char type_from_mode(mode_t mode);
+#else
+static VisitResult traverse_subtree(const char path[],
+		subtree_visitor_ex visitor, void *param);
+#endif
 
 IoRes
 traverse(const char path[], subtree_visitor visitor, void *param)
 {
-	/* Duplication with traverse_subtree(), but this way traverse_subtree() can
-	 * use information from dirent structure to save some operations. */
+	simple_visitor_t simple = { .visitor = visitor, .param = param };
+	return traverse_ex(path, TF_NONE, &simple_visitor, &simple);
+}
 
-	VisitResult visit_result;
+/* Adapter of subtree_visitor to subtree_visitor_ex.  Returns status of
+ * visitation. */
+static VisitResult
+simple_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
+{
+	const simple_visitor_t *const simple = param;
+	return simple->visitor(full_path, action, simple->param);
+}
+
+IoRes
+traverse_ex(const char path[], TraverseFlags flags, subtree_visitor_ex visitor,
+		void *param)
+{
+	switch(traverse_root(path, flags, visitor, param))
+	{
+		case VR_OK:        return IO_RES_SUCCEEDED;
+		case VR_CANCELLED: return IO_RES_ABORTED;
+
+		default:           return IO_RES_FAILED;
+	}
+}
+
+#ifndef _WIN32
+
+/* Visits the path and everything below it if it's a directory.  Returns status
+ * of visitation. */
+static VisitResult
+traverse_root(const char path[], TraverseFlags flags,
+		subtree_visitor_ex visitor, void *param)
+{
+	struct stat st;
+	const int have_st = (os_lstat(path, &st) == 0);
+
+	visit_entry_t entry = {
+		.dir_fd = -1,
+		.name = path,
+		.type = (have_st ? type_from_mode(st.st_mode) : DT_UNKNOWN),
+		.st = ((have_st && (flags & TF_STAT)) ? &st : NULL),
+	};
 
 	/* Treat symbolic links to directories as files as well. */
-	if(is_symlink(path) || !is_dir(path))
+	if(entry.type != DT_DIR)
+	{
+		return visitor(path, VA_FILE, &entry, param);
+	}
+
+	trav_state_t state = { .flags = flags, .visitor = visitor, .param = param };
+
+	VisitResult result = VR_ERROR;
+	if(append_name(&state, 0U, path) == 0)
+	{
+		entry.name = state.path;
+		result = enter_dir(&state, open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC),
+				&entry);
+	}
+
+	while(result == VR_OK && state.depth != 0U)
+	{
+		result = traverse_step(&state);
+	}
+
+	/* Traversal was stopped on error. */
+	while(state.depth != 0U)
+	{
+		(void)closedir(state.stack[--state.depth].dir);
+	}
+
+	free(state.stack);
+	free(state.path);
+	return result;
+}
+
+/* Processes next entry of the directory at the top of the stack or leaves the
+ * directory if there are no more entries.  Returns status of visitation. */
+static VisitResult
+traverse_step(trav_state_t *state)
+{
+	trav_dir_t *const top = &state->stack[state->depth - 1U];
+	const int dir_fd = dirfd(top->dir);
+
+	struct dirent *const d = readdir(top->dir);
+	if(d == NULL)
+	{
+		const trav_dir_t dir = *top;
+		(void)closedir(dir.dir);
+		--state->depth;
+
+		VisitResult result = VR_OK;
+		if(!dir.skip_leave)
+		{
+			const visit_entry_t entry = {
+				.dir_fd = (state->depth == 0U ? -1 : dirfd(top[-1].dir)),
+				.name = state->path + dir.name_pos,
+				.type = DT_DIR,
+			};
+			result = state->visitor(state->path, VA_DIR_LEAVE, &entry,
+					state->param);
+		}
+
+		if(state->depth != 0U)
+		{
+			state->path[state->stack[state->depth - 1U].path_len] = '\0';
+		}
+		return result;
+	}
+
+	if(is_builtin_dir(d->d_name))
+	{
+		return VR_OK;
+	}
+
+	const size_t len = top->path_len;
+	if(append_name(state, len, d->d_name) != 0)
 	{
-		visit_result = visitor(path, VA_FILE, param);
+		return VR_ERROR;
+	}
+
+	unsigned char type = DT_UNKNOWN;
+#if defined(HAVE_STRUCT_DIRENT_D_TYPE) && HAVE_STRUCT_DIRENT_D_TYPE
+	type = d->d_type;
+#endif
+
+	struct stat st;
+	int have_st = 0;
+	if(type == DT_UNKNOWN || (state->flags & TF_STAT))
+	{
+		have_st = (fstatat(dir_fd, d->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0);
+		if(have_st)
+		{
+			type = type_from_mode(st.st_mode);
+		}
+	}
+
+	const visit_entry_t entry = {
+		.dir_fd = dir_fd,
+		.name = state->path + (state->path[len] == '/' ? len + 1U : len),
+		.type = type,
+		.st = ((have_st && (state->flags & TF_STAT)) ? &st : NULL),
+	};
+
+	VisitResult result;
+	if(type == DT_DIR)
+	{
+		const int fd = openat(dir_fd, d->d_name,
+				O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+		result = enter_dir(state, fd, &entry);
+		if(result == VR_OK)
+		{
+			/* Path stays extended while the directory is being read. */
+			return VR_OK;
+		}
 	}
 	else
 	{
-		visit_result = traverse_subtree(path, visitor, param);
+		/* Symbolic links to directories are treated as files as well. */
+		result = state->visitor(state->path, VA_FILE, &entry, state->param);
+	}
+
+	state->path[len] = '\0';
+	return result;
+}
+
+/* Starts reading directory at current path, which is opened as fd (can be -1
+ * on failure to open it).  Takes ownership of fd.  Returns status of
+ * visitation. */
+static VisitResult
+enter_dir(trav_state_t *state, int fd, const visit_entry_t *entry)
+{
+	DIR *const dir = (fd == -1 ? NULL : fdopendir(fd));
+	if(dir == NULL)
+	{
+		if(fd != -1)
+		{
+			(void)close(fd);
+		}
+		return VR_ERROR;
 	}
 
-	switch(visit_result)
+	if(state->depth == state->stack_cap)
 	{
-		case VR_OK:        return IO_RES_SUCCEEDED;
-		case VR_CANCELLED: return IO_RES_ABORTED;
+		const size_t new_cap = (state->stack_cap == 0U ? 16U : state->stack_cap*2U);
+		trav_dir_t *const stack = realloc(state->stack,
+				new_cap*sizeof(*state->stack));
+		if(stack == NULL)
+		{
+			(void)closedir(dir);
+			return VR_ERROR;
+		}
+		state->stack = stack;
+		state->stack_cap = new_cap;
+	}
 
-		default:           return IO_RES_FAILED;
+	const VisitResult enter_result = state->visitor(state->path, VA_DIR_ENTER,
+			entry, state->param);
+	if(enter_result == VR_ERROR || enter_result == VR_CANCELLED)
+	{
+		(void)closedir(dir);
+		return VR_ERROR;
 	}
+
+	trav_dir_t *const top = &state->stack[state->depth++];
+	top->dir = dir;
+	top->path_len = strlen(state->path);
+	top->name_pos = entry->name - state->path;
+	top->skip_leave = (enter_result == VR_SKIP_DIR_LEAVE);
+	return VR_OK;
+}
+
+/* Replaces part of the path after its first len characters with the name
+ * (separated by a slash if len isn't zero).  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+append_name(trav_state_t *state, size_t len, const char name[])
+{
+	const int need_slash = (len != 0U && state->path[len - 1U] != '/');
+	const size_t name_len = strlen(name);
+	const size_t needed = len + need_slash + name_len + 1U;
+
+	if(needed > state->path_cap)
+	{
+		size_t new_cap = (state->path_cap == 0U ? 256U : state->path_cap);
+		while(new_cap < needed)
+		{
+			new_cap *= 2U;
+		}
+
+		char *const path = realloc(state->path, new_cap);
+		if(path == NULL)
+		{
+			return 1;
+		}
+		state->path = path;
+		state->path_cap = new_cap;
+	}
+
+	if(need_slash)
+	{
+		state->path[len++] = '/';
+	}
+	memcpy(state->path + len, name, name_len + 1U);
+	return 0;
+}
+
+/* Maps file mode onto type of directory entry.  Returns the type. */
+static unsigned char
+type_from_mode(mode_t mode)
+{
+	switch(mode & S_IFMT)
+	{
+		case S_IFBLK:  return DT_BLK;
+		case S_IFCHR:  return DT_CHR;
+		case S_IFDIR:  return DT_DIR;
+		case S_IFIFO:  return DT_FIFO;
+		case S_IFREG:  return DT_REG;
+		case S_IFLNK:  return DT_LNK;
+		case S_IFSOCK: return DT_SOCK;
+
+		default: return DT_UNKNOWN;
+	}
+}
+
+#else
+
+/* Visits the path and everything below it if it's a directory.  Returns status
+ * of visitation. */
+static VisitResult
+traverse_root(const char path[], TraverseFlags flags,
+		subtree_visitor_ex visitor, void *param)
+{
+	/* Duplication with traverse_subtree(), but this way traverse_subtree() can
+	 * use information from dirent structure to save some operations. */
+
+	/* Treat symbolic links to directories as files as well. */
+	if(is_symlink(path) || !is_dir(path))
+	{
+		const visit_entry_t entry = {
+			.dir_fd = -1,
+			.name = path,
+			.type = DT_UNKNOWN,
+		};
+		return visitor(path, VA_FILE, &entry, param);
+	}
+
+	return traverse_subtree(path, visitor, param);
 }
 
 /* A generic subtree traversing.  Returns status of visitation. */
 static VisitResult
-traverse_subtree(const char path[], subtree_visitor visitor, void *param)
+traverse_subtree(const char path[], subtree_visitor_ex visitor, void *param)
 {
 	DIR *dir;
 	struct dirent *d;
@@ -70,7 +396,13 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 		return 1;
 	}
 
-	enter_result = visitor(path, VA_DIR_ENTER, param);
+	const visit_entry_t dir_entry = {
+		.dir_fd = -1,
+		.name = path,
+		.type = DT_DIR,
+	};
+
+	enter_result = visitor(path, VA_DIR_ENTER, &dir_entry, param);
 	if(enter_result == VR_ERROR || enter_result == VR_CANCELLED)
 	{
 		(void)os_closedir(dir);
@@ -88,10 +420,15 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 		}
 
 		full_path = join_paths(path, d->d_name);
+		const visit_entry_t entry = {
+			.dir_fd = -1,
+			.name = full_path,
+			.type = DT_UNKNOWN,
+		};
 		if(entry_is_link(full_path, d))
 		{
 			/* Treat symbolic links to directories as files as well. */
-			result = visitor(full_path, VA_FILE, param);
+			result = visitor(full_path, VA_FILE, &entry, param);
 		}
 		else if(entry_is_dir(full_path, d))
 		{
@@ -99,7 +436,7 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 		}
 		else
 		{
-			result = visitor(full_path, VA_FILE, param);
+			result = visitor(full_path, VA_FILE, &entry, param);
 		}
 		free(full_path);
 
@@ -112,11 +449,13 @@ traverse_subtree(const char path[], subtree_visitor visitor, void *param)
 
 	if(result == VR_OK && enter_result != VR_SKIP_DIR_LEAVE)
 	{
-		result = visitor(path, VA_DIR_LEAVE, param);
+		result = visitor(path, VA_DIR_LEAVE, &dir_entry, param);
 	}
 
 	return result;
 }
 
+#endif
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -19,6 +19,8 @@
 #ifndef VIFM__IO__PRIVATE__TRAVERSER_H__
 #define VIFM__IO__PRIVATE__TRAVERSER_H__
 
+#include <sys/stat.h> /* stat */
+
 #include "../ioc.h"
 
 /* Reason why file system traverse visitor is called. */
@@ -40,15 +42,52 @@ typedef enum
 }
 VisitResult;
 
+/* Flags that control traverse_ex(). */
+typedef enum
+{
+	TF_NONE = 0,      /* No special behaviour. */
+	TF_STAT = 1 << 0, /* Provide lstat() information about entries to visitor. */
+}
+TraverseFlags;
+
+/* Information about currently visited entry. */
+typedef struct
+{
+	/* Descriptor of the parent directory, which is valid only during the call.
+	 * It's -1 for the root of traversal and on Windows. */
+	int dir_fd;
+	/* Name of the entry relative to dir_fd or full path if dir_fd is -1. */
+	const char *name;
+	/* Type of the entry as one of DT_* values, can be DT_UNKNOWN. */
+	unsigned char type;
+	/* Result of lstat() on the entry if TF_STAT was passed, otherwise NULL.  It
+	 * can be NULL even with TF_STAT on errors, on Windows and for
+	 * VA_DIR_LEAVE. */
+	const struct stat *st;
+}
+visit_entry_t;
+
 /* Generic handler for file system traversing algorithm.  Must return 0 on
  * success, otherwise directory traverse will be stopped. */
 typedef VisitResult (*subtree_visitor)(const char full_path[],
 		VisitAction action, void *param);
 
-/* A generic recursive file system traversing entry point.  Returns zero on
- * success, otherwise non-zero is returned. */
+/* Same as subtree_visitor, but also receives information about the entry. */
+typedef VisitResult (*subtree_visitor_ex)(const char full_path[],
+		VisitAction action, const visit_entry_t *entry, void *param);
+
+/* A generic file system traversing entry point.  Returns zero on success,
+ * otherwise non-zero is returned. */
 IoRes traverse(const char path[], subtree_visitor visitor, void *param);
 
+/* Same as traverse(), but passes information about entries to the visitor.
+ * Directories are read via their descriptors and paths are built in a reused
+ * buffer, so no memory allocation or path resolution is done per entry and
+ * depth of the tree doesn't affect stack usage.  Returns zero on success,
+ * otherwise non-zero is returned. */
+IoRes traverse_ex(const char path[], TraverseFlags flags,
+		subtree_visitor_ex visitor, void *param);
+
 #endif /* VIFM__IO__PRIVATE__TRAVERSER_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
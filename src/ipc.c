@@ -130,6 +130,12 @@ struct ipc_t
 	char pipe_path[PATH_MAX + 1];
 	/* Opened file of the pipe. */
 	read_pipe_t pipe_file;
+#ifndef WIN32_PIPE_READ
+	/* Write end of our own pipe or -1.  Keeping it open prevents the pipe from
+	 * getting into hang-up state after a client disconnects, which would make it
+	 * permanently ready for reading. */
+	int write_fd;
+#endif
 	/* Holds result of expression evaluation or NULL on evaluation error. */
 	char *eval_result;
 };
@@ -195,6 +201,10 @@ ipc_init(const char name[], ipc_args_cb args_cb, ipc_eval_cb eval_cb)
 		return NULL;
 	}
 
+#ifndef WIN32_PIPE_READ
+	ipc->write_fd = open(ipc->pipe_path, O_WRONLY | O_NONBLOCK);
+#endif
+
 	return ipc;
 }
 
@@ -207,6 +217,10 @@ ipc_free(ipc_t *ipc)
 	}
 
 #ifndef WIN32_PIPE_READ
+	if(ipc->write_fd != -1)
+	{
+		close(ipc->write_fd);
+	}
 	fclose(ipc->pipe_file);
 	unlink(ipc->pipe_path);
 #else
@@ -242,6 +256,16 @@ ipc_check(ipc_t *ipc)
 	return 0;
 }
 
+int
+ipc_get_fd(const ipc_t *ipc)
+{
+#ifndef WIN32_PIPE_READ
+	return (ipc->locked ? -1 : fileno(ipc->pipe_file));
+#else
+	return -1;
+#endif
+}
+
 /* Receives message addressed to this instance.  Returns NULL if there was no
  * message or on failure to read it, otherwise newly allocated string is
  * returned. */
@@ -255,7 +279,7 @@ receive_pkg(ipc_t *ipc, int *len)
 
 	fd_set ready;
 	int max_fd;
-	struct timeval ts = { .tv_sec = 0, .tv_usec = 10000 };
+	struct timeval ts;
 
 	/* At least on OS X pipe might get into EOF state, so reset it.  This will
 	 * also reset any errors, which is fine with us. */
@@ -275,23 +299,32 @@ receive_pkg(ipc_t *ipc, int *len)
 	}
 
 	max_fd = fileno(ipc->pipe_file);
-	FD_ZERO(&ready);
-	FD_SET(max_fd, &ready);
 
 	p = pkg;
-	while(size != 0U && select(max_fd + 1, &ready, NULL, NULL, &ts) > 0)
+	while(size != 0U)
 	{
+		/* The rest of the message might have been buffered already, so waiting
+		 * on the descriptor before reading could fail. */
 		const size_t nread = fread(p, 1U, size, ipc->pipe_file);
 		size -= nread;
 		p += nread;
 
-		if(nread == 0U)
+		if(size == 0U || (nread == 0U && feof(ipc->pipe_file)))
 		{
 			break;
 		}
 
+		/* Running out of data sets error flag, reset it. */
+		clearerr(ipc->pipe_file);
+
+		FD_ZERO(&ready);
+		FD_SET(max_fd, &ready);
 		ts.tv_sec = 0;
 		ts.tv_usec = 10000;
+		if(select(max_fd + 1, &ready, NULL, NULL, &ts) <= 0)
+		{
+			break;
+		}
 	}
 
 	if(size != 0U)
@@ -937,6 +970,12 @@ ipc_check(ipc_t *ipc)
 	return 0;
 }
 
+int
+ipc_get_fd(const ipc_t *ipc)
+{
+	return -1;
+}
+
 int
 ipc_send(ipc_t *ipc, const char whom[], char *data[])
 {
@@ -55,6 +55,11 @@ const char * ipc_get_name(const ipc_t *ipc);
  * non-zero if something was received, otherwise zero is returned. */
 int ipc_check(ipc_t *ipc);
 
+/* Retrieves file descriptor that becomes readable when there are incoming
+ * messages.  Returns the descriptor or -1 if it's unavailable or messages can't
+ * be received at the moment. */
+int ipc_get_fd(const ipc_t *ipc);
+
 /* Sends data to server.  If whom argument is NULL, target instance is
  * automatically determined.  The data array should end with NULL.  Returns zero
  * on successful send and non-zero otherwise. */
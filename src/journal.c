@@ -0,0 +1,589 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "journal.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h> /* kill() */
+#endif
+
+#include <sys/stat.h> /* S_IRWXU */
+
+#include <errno.h> /* EPERM errno */
+#include <limits.h> /* INT_MAX */
+#include <stddef.h> /* NULL size_t */
+#include <stdio.h> /* FILE fclose() fflush() fprintf() fputc() fputs()
+                      remove() */
+#include <stdlib.h> /* calloc() free() strtol() */
+#include <string.h> /* strcmp() strdup() strnlen() */
+
+#include "cfg/config.h"
+#include "compat/os.h"
+#include "compat/pthread.h"
+#include "utils/fs.h"
+#include "utils/macros.h"
+#include "utils/path.h"
+#include "utils/str.h"
+#include "utils/string_array.h"
+#include "utils/utils.h"
+
+/**
+ * Journal file consists of null-terminated fields.  It starts with a header:
+ *
+ *   vifm-journal 1 <pid> copy|move fail|skip|overwrite <descr> <count>
+ *
+ * followed by <count> pairs of source and destination paths.  The rest of the
+ * file is a sequence of records, which are appended as operation progresses:
+ *
+ *   started <index>
+ *   done <index>
+ *   pid <pid>
+ *
+ * The last "pid" record identifies process that's responsible for the
+ * operation (it's updated on resuming).
+ *
+ * Partially copied files aren't tracked here, their destination is the best
+ * source of information about how much data has already been copied (data is
+ * always written out in order, so there are no gaps before end of file).
+ */
+
+/* Magic string at the start of journal files. */
+#define MAGIC "vifm-journal"
+/* Version of journal format. */
+#define FORMAT_VERSION "1"
+
+/* Names of conflict handling strategies in journal files. */
+static const char *const conflict_names[] = {
+	[JC_FAIL]      = "fail",
+	[JC_SKIP]      = "skip",
+	[JC_OVERWRITE] = "overwrite",
+};
+
+static int write_header(journal_t *journal, unsigned int pid);
+static void append_record(journal_t *journal, const char name[], int value);
+static int parse_journal(journal_t *journal, char text[], size_t len,
+		unsigned int *pid);
+static char * next_field(char **pos, const char *end);
+static int parse_int(const char str[], int *value);
+static int is_running(const char path[], unsigned int pid);
+static int process_exists(unsigned int pid);
+static void register_journal(const char path[]);
+static void unregister_journal(const char path[]);
+static int is_registered(const char path[]);
+
+/* Paths of journals, which are being written by this instance. */
+static char **live_journals;
+/* Number of elements in live_journals. */
+static int nlive_journals;
+/* Protects live_journals and nlive_journals. */
+static pthread_mutex_t live_journals_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Counter for producing unique file names. */
+static unsigned int journal_counter;
+
+journal_t *
+journal_create(const char descr[], int move, JournalConflict conflict,
+		char *src[], char *dst[], int count)
+{
+	if(cfg.journal_dir[0] == '\0' || count <= 0)
+	{
+		return NULL;
+	}
+
+	if(create_path(cfg.journal_dir, S_IRWXU) != 0 && !is_dir(cfg.journal_dir))
+	{
+		return NULL;
+	}
+
+	journal_t *const journal = calloc(1, sizeof(*journal));
+	if(journal == NULL)
+	{
+		return NULL;
+	}
+
+	journal->descr = strdup(descr);
+	journal->move = move;
+	journal->conflict = conflict;
+	journal->count = count;
+	journal->src = copy_string_array(src, count);
+	journal->dst = copy_string_array(dst, count);
+	journal->state = calloc(count, sizeof(*journal->state));
+	if(journal->descr == NULL || journal->src == NULL || journal->dst == NULL ||
+			journal->state == NULL)
+	{
+		journal_free(journal);
+		return NULL;
+	}
+
+	const unsigned int pid = get_pid();
+	do
+	{
+		const unsigned int n = __atomic_add_fetch(&journal_counter, 1,
+				__ATOMIC_RELAXED);
+		free(journal->path);
+		journal->path = format_str("%s/%u-%u", cfg.journal_dir, pid, n);
+	}
+	while(journal->path != NULL && path_exists(journal->path, NODEREF));
+
+	if(journal->path == NULL)
+	{
+		journal_free(journal);
+		return NULL;
+	}
+
+	journal->fp = os_fopen(journal->path, "wb");
+	if(journal->fp == NULL)
+	{
+		journal_free(journal);
+		return NULL;
+	}
+
+	register_journal(journal->path);
+
+	if(write_header(journal, pid) != 0)
+	{
+		journal_finish(journal);
+		return NULL;
+	}
+
+	return journal;
+}
+
+/* Writes header of a new journal.  Returns zero on success. */
+static int
+write_header(journal_t *journal, unsigned int pid)
+{
+	FILE *const fp = journal->fp;
+
+	fprintf(fp, MAGIC "%c" FORMAT_VERSION "%c%u%c%s%c%s%c%s%c%d%c", '\0', '\0',
+			pid, '\0', journal->move ? "move" : "copy", '\0',
+			conflict_names[journal->conflict], '\0', journal->descr, '\0',
+			journal->count, '\0');
+
+	int i;
+	for(i = 0; i < journal->count; ++i)
+	{
+		fputs(journal->src[i], fp);
+		fputc('\0', fp);
+		fputs(journal->dst[i], fp);
+		fputc('\0', fp);
+	}
+
+	return (fflush(fp) != 0 || ferror(fp));
+}
+
+char **
+journal_list(int *count)
+{
+	char **list = NULL;
+	*count = 0;
+
+	int nfiles;
+	char **files = list_sorted_files(cfg.journal_dir, &nfiles);
+
+	int i;
+	for(i = 0; i < nfiles; ++i)
+	{
+		char *const path = join_paths(cfg.journal_dir, files[i]);
+		journal_t *const journal = journal_read(path);
+		if(journal != NULL)
+		{
+			*count = put_into_string_array(&list, *count, path);
+			journal_free(journal);
+		}
+		else
+		{
+			free(path);
+		}
+	}
+
+	free_string_array(files, nfiles);
+	return list;
+}
+
+journal_t *
+journal_read(const char path[])
+{
+	FILE *const fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return NULL;
+	}
+
+	size_t len;
+	char *const text = read_nonseekable_stream(fp, &len, NULL, NULL);
+	fclose(fp);
+	if(text == NULL)
+	{
+		return NULL;
+	}
+
+	journal_t *journal = calloc(1, sizeof(*journal));
+	if(journal == NULL)
+	{
+		free(text);
+		return NULL;
+	}
+
+	unsigned int pid;
+	if(parse_journal(journal, text, len, &pid) != 0 || is_running(path, pid))
+	{
+		free(text);
+		journal_free(journal);
+		return NULL;
+	}
+	free(text);
+
+	journal->path = strdup(path);
+	if(journal->path == NULL)
+	{
+		journal_free(journal);
+		return NULL;
+	}
+
+	return journal;
+}
+
+/* Parses contents of a journal file.  *pid is set to identifier of the last
+ * process that was responsible for the operation.  Returns zero on success. */
+static int
+parse_journal(journal_t *journal, char text[], size_t len, unsigned int *pid)
+{
+	char *pos = text;
+	const char *const end = text + len;
+
+	const char *const magic = next_field(&pos, end);
+	const char *const version = next_field(&pos, end);
+	const char *const pid_str = next_field(&pos, end);
+	const char *const op = next_field(&pos, end);
+	const char *const conflict = next_field(&pos, end);
+	const char *const descr = next_field(&pos, end);
+	const char *const count = next_field(&pos, end);
+	if(count == NULL || strcmp(magic, MAGIC) != 0 ||
+			strcmp(version, FORMAT_VERSION) != 0)
+	{
+		return 1;
+	}
+
+	int value;
+	if(!parse_int(pid_str, &value))
+	{
+		return 1;
+	}
+	*pid = value;
+
+	if(strcmp(op, "copy") != 0 && strcmp(op, "move") != 0)
+	{
+		return 1;
+	}
+	journal->move = (strcmp(op, "move") == 0);
+
+	journal->conflict = (JournalConflict)-1;
+	size_t i;
+	for(i = 0U; i < ARRAY_LEN(conflict_names); ++i)
+	{
+		if(strcmp(conflict, conflict_names[i]) == 0)
+		{
+			journal->conflict = i;
+		}
+	}
+	if(journal->conflict == (JournalConflict)-1)
+	{
+		return 1;
+	}
+
+	if(!parse_int(count, &journal->count) || journal->count <= 0)
+	{
+		return 1;
+	}
+
+	journal->descr = strdup(descr);
+	journal->src = calloc(journal->count, sizeof(*journal->src));
+	journal->dst = calloc(journal->count, sizeof(*journal->dst));
+	journal->state = calloc(journal->count, sizeof(*journal->state));
+	if(journal->descr == NULL || journal->src == NULL || journal->dst == NULL ||
+			journal->state == NULL)
+	{
+		return 1;
+	}
+
+	int j;
+	for(j = 0; j < journal->count; ++j)
+	{
+		const char *const src = next_field(&pos, end);
+		const char *const dst = next_field(&pos, end);
+		if(dst == NULL)
+		{
+			return 1;
+		}
+
+		journal->src[j] = strdup(src);
+		journal->dst[j] = strdup(dst);
+		if(journal->src[j] == NULL || journal->dst[j] == NULL)
+		{
+			return 1;
+		}
+	}
+
+	/* Incomplete trailing record is possible if vifm got killed while writing
+	 * it, so records are processed only while both of their fields are
+	 * there. */
+	const char *name;
+	while((name = next_field(&pos, end)) != NULL)
+	{
+		const char *const arg = next_field(&pos, end);
+		if(arg == NULL || !parse_int(arg, &value))
+		{
+			break;
+		}
+
+		if(strcmp(name, "pid") == 0)
+		{
+			*pid = value;
+		}
+		else if(value >= 0 && value < journal->count)
+		{
+			if(strcmp(name, "started") == 0 && journal->state[value] != JIS_DONE)
+			{
+				journal->state[value] = JIS_STARTED;
+			}
+			else if(strcmp(name, "done") == 0)
+			{
+				journal->state[value] = JIS_DONE;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Retrieves next null-terminated field advancing *pos past it.  Returns the
+ * field or NULL if there are no more complete fields. */
+static char *
+next_field(char **pos, const char *end)
+{
+	char *const field = *pos;
+	const size_t len = strnlen(field, end - field);
+	if(field + len == end)
+	{
+		return NULL;
+	}
+
+	*pos = field + len + 1;
+	return field;
+}
+
+/* Parses non-negative integer.  Returns non-zero on success. */
+static int
+parse_int(const char str[], int *value)
+{
+	char *endptr;
+	const long l = strtol(str, &endptr, 10);
+	if(str[0] == '\0' || *endptr != '\0' || l < 0 || l > INT_MAX)
+	{
+		return 0;
+	}
+
+	*value = l;
+	return 1;
+}
+
+/* Checks whether operation of the journal is still being performed.  Returns
+ * non-zero if so. */
+static int
+is_running(const char path[], unsigned int pid)
+{
+	if(is_registered(path))
+	{
+		return 1;
+	}
+	/* Journal of this process that isn't registered is left by some previous
+	 * process that had the same identifier. */
+	return (pid != get_pid() && process_exists(pid));
+}
+
+/* Checks whether process with specified identifier exists.  Returns non-zero if
+ * so. */
+static int
+process_exists(unsigned int pid)
+{
+#ifndef _WIN32
+	return (kill(pid, 0) == 0 || errno == EPERM);
+#else
+	HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+	if(process == NULL)
+	{
+		return 0;
+	}
+
+	const int exists = (WaitForSingleObject(process, 0) == WAIT_TIMEOUT);
+	CloseHandle(process);
+	return exists;
+#endif
+}
+
+int
+journal_claim(journal_t *journal)
+{
+	if(journal->fp != NULL)
+	{
+		return 0;
+	}
+
+	journal->fp = os_fopen(journal->path, "ab");
+	if(journal->fp == NULL)
+	{
+		return 1;
+	}
+
+	register_journal(journal->path);
+	append_record(journal, "pid", get_pid());
+	return 0;
+}
+
+void
+journal_item_started(journal_t *journal, int idx)
+{
+	if(journal != NULL && journal->state[idx] == JIS_PENDING)
+	{
+		journal->state[idx] = JIS_STARTED;
+		append_record(journal, "started", idx);
+	}
+}
+
+void
+journal_item_done(journal_t *journal, int idx)
+{
+	if(journal != NULL && journal->state[idx] != JIS_DONE)
+	{
+		journal->state[idx] = JIS_DONE;
+		append_record(journal, "done", idx);
+	}
+}
+
+/* Appends a record to the journal and flushes it, so that it survives
+ * termination of the process. */
+static void
+append_record(journal_t *journal, const char name[], int value)
+{
+	if(journal->fp != NULL)
+	{
+		fprintf(journal->fp, "%s%c%d%c", name, '\0', value, '\0');
+		(void)fflush(journal->fp);
+	}
+}
+
+void
+journal_finish(journal_t *journal)
+{
+	if(journal != NULL && journal->fp != NULL)
+	{
+		fclose(journal->fp);
+		journal->fp = NULL;
+		(void)remove(journal->path);
+		unregister_journal(journal->path);
+	}
+	journal_free(journal);
+}
+
+void
+journal_free(journal_t *journal)
+{
+	if(journal == NULL)
+	{
+		return;
+	}
+
+	if(journal->fp != NULL)
+	{
+		fclose(journal->fp);
+		unregister_journal(journal->path);
+	}
+
+	if(journal->src != NULL)
+	{
+		free_string_array(journal->src, journal->count);
+	}
+	if(journal->dst != NULL)
+	{
+		free_string_array(journal->dst, journal->count);
+	}
+	free(journal->state);
+	free(journal->descr);
+	free(journal->path);
+	free(journal);
+}
+
+int
+journal_discard(const char path[])
+{
+	journal_t *const journal = journal_read(path);
+	if(journal == NULL)
+	{
+		return 1;
+	}
+
+	journal_free(journal);
+	return (remove(path) != 0);
+}
+
+/* Adds journal to the list of journals of this instance. */
+static void
+register_journal(const char path[])
+{
+	if(pthread_mutex_lock(&live_journals_lock) == 0)
+	{
+		nlive_journals = add_to_string_array(&live_journals, nlive_journals, path);
+		(void)pthread_mutex_unlock(&live_journals_lock);
+	}
+}
+
+/* Removes journal from the list of journals of this instance. */
+static void
+unregister_journal(const char path[])
+{
+	if(pthread_mutex_lock(&live_journals_lock) == 0)
+	{
+		const int pos = string_array_pos(live_journals, nlive_journals, path);
+		if(pos >= 0)
+		{
+			remove_from_string_array(live_journals, nlive_journals, pos);
+			--nlive_journals;
+		}
+		(void)pthread_mutex_unlock(&live_journals_lock);
+	}
+}
+
+/* Checks whether journal is being written by this instance.  Returns non-zero
+ * if so. */
+static int
+is_registered(const char path[])
+{
+	int registered = 0;
+	if(pthread_mutex_lock(&live_journals_lock) == 0)
+	{
+		registered = (string_array_pos(live_journals, nlive_journals, path) >= 0);
+		(void)pthread_mutex_unlock(&live_journals_lock);
+	}
+	return registered;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -0,0 +1,97 @@
+/* vifm
+ * Copyright (C) 2026 xaizek.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#ifndef VIFM__JOURNAL_H__
+#define VIFM__JOURNAL_H__
+
+#include <stdio.h> /* FILE */
+
+/* journal - on-disk journals of background copy/move operations, which allow
+ * resuming operations that were interrupted by termination of vifm */
+
+/* How items whose destination exists before processing are handled. */
+typedef enum
+{
+	JC_FAIL,      /* Let the operation report an error. */
+	JC_SKIP,      /* Leave such items alone. */
+	JC_OVERWRITE, /* Replace destination. */
+}
+JournalConflict;
+
+/* State of a single item of an operation. */
+typedef enum
+{
+	JIS_PENDING, /* Processing hasn't started yet. */
+	JIS_STARTED, /* Processing has started, destination can be incomplete. */
+	JIS_DONE,    /* Item has been processed. */
+}
+JournalItemState;
+
+/* Journal of a single operation. */
+typedef struct journal_t
+{
+	char *path;               /* Path to the journal file. */
+	FILE *fp;                 /* Stream for appending records or NULL. */
+	char *descr;              /* Description of the operation. */
+	int move;                 /* Whether files are moved instead of copied. */
+	JournalConflict conflict; /* Handling of existing destination files. */
+	int count;                /* Number of items. */
+	char **src;               /* Source paths of items. */
+	char **dst;               /* Destination paths of items. */
+	JournalItemState *state;  /* States of items. */
+}
+journal_t;
+
+/* Starts journal of an operation in journal directory.  Paths must be
+ * absolute.  Returns journal or NULL if journaling isn't possible. */
+journal_t * journal_create(const char descr[], int move,
+		JournalConflict conflict, char *src[], char *dst[], int count);
+
+/* Lists journals of operations that were interrupted.  Returns list of paths
+ * to journal files, *count is set to its length. */
+char ** journal_list(int *count);
+
+/* Reads journal of interrupted operation without taking it over.  Returns
+ * journal or NULL if it's not a valid journal or its operation is still
+ * running. */
+journal_t * journal_read(const char path[]);
+
+/* Takes over journal of interrupted operation so that this instance continues
+ * recording to it.  Returns zero on success. */
+int journal_claim(journal_t *journal);
+
+/* Records that processing of an item has started.  journal can be NULL. */
+void journal_item_started(journal_t *journal, int idx);
+
+/* Records that an item has been processed.  journal can be NULL. */
+void journal_item_done(journal_t *journal, int idx);
+
+/* Finishes journal removing its file if it was created or claimed by this
+ * instance and frees the structure.  journal can be NULL. */
+void journal_finish(journal_t *journal);
+
+/* Frees the structure without touching the file.  journal can be NULL. */
+void journal_free(journal_t *journal);
+
+/* Removes journal of interrupted operation.  Returns zero on success. */
+int journal_discard(const char path[]);
+
+#endif /* VIFM__JOURNAL_H__ */
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
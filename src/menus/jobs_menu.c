@@ -21,6 +21,7 @@
 
 #include <stddef.h> /* NULL */
 #include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
 #include <string.h> /* strlen() strdup() */
 
 #include "../compat/reallocarray.h"
@@ -29,6 +30,8 @@
 #include "../utils/str.h"
 #include "../utils/string_array.h"
 #include "../background.h"
+#include "../fops_cpmv.h"
+#include "../journal.h"
 #include "menus.h"
 
 static int execute_jobs_cb(view_t *view, menu_data_t *m);
@@ -36,7 +39,9 @@ static KHandlerResponse jobs_khandler(view_t *view, menu_data_t *m,
 		const wchar_t keys[]);
 static int cancel_job(menu_data_t *m, bg_job_t *job);
 static void reload_jobs_list(menu_data_t *m);
+static void add_interrupted_ops(menu_data_t *m);
 static char * format_job_item(bg_job_t *job);
+static char * format_journal_item(const journal_t *journal);
 static void show_job_errors(view_t *view, menu_data_t *m, bg_job_t *job);
 static KHandlerResponse errs_khandler(view_t *view, menu_data_t *m,
 		const wchar_t keys[]);
@@ -62,7 +67,11 @@ show_jobs_menu(view_t *view)
 static int
 execute_jobs_cb(view_t *view, menu_data_t *m)
 {
-	/* TODO: write code for job control. */
+	/* Only interrupted operations have data associated with them. */
+	if(m->data != NULL && m->data[m->pos] != NULL)
+	{
+		(void)fops_resume(m->data[m->pos]);
+	}
 	return 0;
 }
 
@@ -71,7 +80,19 @@ execute_jobs_cb(view_t *view, menu_data_t *m)
 static KHandlerResponse
 jobs_khandler(view_t *view, menu_data_t *m, const wchar_t keys[])
 {
-	if(wcscmp(keys, L"dd") == 0)
+	if(wcscmp(keys, L"dd") == 0 && m->data != NULL && m->data[m->pos] != NULL)
+	{
+		if(journal_discard(m->data[m->pos]) != 0)
+		{
+			show_error_msg("Operation discarding", "Failed to remove journal");
+		}
+
+		reload_jobs_list(m);
+		menus_set_pos(m->state, m->pos);
+		menus_partial_redraw(m->state);
+		return KHR_REFRESH_WINDOW;
+	}
+	else if(wcscmp(keys, L"dd") == 0)
 	{
 		if(!cancel_job(m, m->void_data[m->pos]))
 		{
@@ -127,9 +148,11 @@ static void
 reload_jobs_list(menu_data_t *m)
 {
 	free(m->void_data);
+	free_string_array(m->data, m->len);
 	free_string_array(m->items, m->len);
 
 	m->void_data = NULL;
+	m->data = NULL;
 	m->items = NULL;
 	m->len = 0;
 
@@ -171,6 +194,66 @@ reload_jobs_list(menu_data_t *m)
 	}
 
 	m->len = len;
+
+	add_interrupted_ops(m);
+}
+
+/* Appends operations that were interrupted by termination of vifm to the menu.
+ * Such items have path to their journal in data field. */
+static void
+add_interrupted_ops(menu_data_t *m)
+{
+	int njournals;
+	char **journals = journal_list(&njournals);
+	if(njournals == 0)
+	{
+		return;
+	}
+
+	const int total = m->len + njournals;
+	void **void_data = reallocarray(m->void_data, total, sizeof(*void_data));
+	if(void_data == NULL)
+	{
+		free_string_array(journals, njournals);
+		return;
+	}
+	m->void_data = void_data;
+
+	char **data = reallocarray(NULL, total, sizeof(*data));
+	if(data == NULL)
+	{
+		free_string_array(journals, njournals);
+		return;
+	}
+
+	int i;
+	for(i = 0; i < m->len; ++i)
+	{
+		data[i] = NULL;
+	}
+
+	int len = m->len;
+	for(i = 0; i < njournals; ++i)
+	{
+		journal_t *const journal = journal_read(journals[i]);
+		char *item = (journal == NULL ? NULL : format_journal_item(journal));
+		journal_free(journal);
+
+		if(item == NULL || put_into_string_array(&m->items, len, item) != len + 1)
+		{
+			free(item);
+			continue;
+		}
+
+		m->void_data[len] = NULL;
+		data[len] = journals[i];
+		journals[i] = NULL;
+		++len;
+	}
+
+	free_string_array(journals, njournals);
+	m->data = data;
+	m->len = len;
 }
 
 /* Formats single menu line that describes state of the job.  Returns formatted
@@ -198,6 +281,23 @@ format_job_item(bg_job_t *job)
 	return format_str("%-8s  %s%s", info_buf, cancelled, job->cmd);
 }
 
+/* Formats single menu line that describes interrupted operation.  Returns
+ * formatted string or NULL on error. */
+static char *
+format_journal_item(const journal_t *journal)
+{
+	int i;
+	int done = 0;
+	for(i = 0; i < journal->count; ++i)
+	{
+		done += (journal->state[i] == JIS_DONE);
+	}
+
+	char info_buf[24];
+	snprintf(info_buf, sizeof(info_buf), "%d/%d", done, journal->count);
+	return format_str("%-8s  (interrupted) %s", info_buf, journal->descr);
+}
+
 /* Shows job errors if there is something and the job is still running.
  * Switches to separate menu description. */
 static void
@@ -199,6 +199,11 @@ ops_alloc(OPS main_op, int bg, const char descr[], const char base_dir[],
 	ops->use_system_calls = cfg.use_system_calls;
 	ops->fast_file_cloning = cfg.fast_file_cloning;
 	ops->data_sync = cfg.data_sync;
+	ops->sparse_files = cfg.sparse_files;
+	ops->io_uring = cfg.io_uring;
+	ops->bypass_cache = cfg.bypass_cache;
+	ops->verify_copies = cfg.verify_copies;
+	ops->copy_jobs = cfg.copy_jobs;
 	ops->shell_type = curr_stats.shell_type;
 
 	ops->choose = choose;
@@ -227,7 +232,7 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 	}
 
 	/* Check once and cache result, it should be the same for each invocation. */
-	if(ops->estim->total_items == 0)
+	if(ops->total == 1)
 	{
 		switch(ops->main_op)
 		{
@@ -263,7 +268,15 @@ ops_enqueue(ops_t *ops, const char src[], const char dst[])
 		}
 	}
 
-	ioeta_calculate(ops->estim, src, ops->shallow_eta);
+	if(ops->bg)
+	{
+		/* Let background operations start processing right away. */
+		ioeta_calculate_bg(ops->estim, src, ops->shallow_eta);
+	}
+	else
+	{
+		ioeta_calculate(ops->estim, src, ops->shallow_eta);
+	}
 }
 
 void
@@ -506,6 +519,14 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 	                             ? cfg.fast_file_cloning
 	                             : ops->fast_file_cloning;
 	const int data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync);
+	const int sparse_files = (ops == NULL ? cfg.sparse_files
+	                                      : ops->sparse_files);
+	const int io_uring = (ops == NULL ? cfg.io_uring : ops->io_uring);
+	const int bypass_cache = (ops == NULL ? cfg.bypass_cache
+	                                      : ops->bypass_cache);
+	const int verify_copies = (ops == NULL ? cfg.verify_copies
+	                                       : ops->verify_copies);
+	const int copy_jobs = (ops == NULL ? cfg.copy_jobs : ops->copy_jobs);
 
 	if(!ops_uses_syscalls(ops))
 	{
@@ -585,6 +606,11 @@ op_cp(ops_t *ops, void *data, const char src[], const char dst[],
 		.arg4 = {
 			.fast_file_cloning = fast_file_cloning,
 			.data_sync = data_sync,
+			.sparse_files = sparse_files,
+			.io_uring = io_uring,
+			.bypass_cache = bypass_cache,
+			.verify_data = verify_copies,
+			.parallel_jobs = copy_jobs,
 		},
 	};
 	return exec_io_op(ops, &ior_cp, &args, data == NULL);
@@ -684,6 +710,11 @@ op_mv(ops_t *ops, void *data, const char src[], const char dst[],
 				/* It's safe to always use fast file cloning on moving files. */
 				.fast_file_cloning = 1,
 				.data_sync = (ops == NULL ? cfg.data_sync : ops->data_sync),
+				.sparse_files = (ops == NULL ? cfg.sparse_files : ops->sparse_files),
+				.io_uring = (ops == NULL ? cfg.io_uring : ops->io_uring),
+				.bypass_cache = (ops == NULL ? cfg.bypass_cache : ops->bypass_cache),
+				.verify_data = (ops == NULL ? cfg.verify_copies : ops->verify_copies),
+				.parallel_jobs = (ops == NULL ? cfg.copy_jobs : ops->copy_jobs),
 			},
 		};
 
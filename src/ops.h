@@ -115,6 +115,11 @@ typedef struct ops_t
 	int use_system_calls;  /* Copy of 'syscalls' option value. */
 	int fast_file_cloning; /* Copy of part of 'iooptions' option value. */
 	int data_sync;         /* Copy of part of 'iooptions' option value. */
+	int sparse_files;      /* Copy of part of 'iooptions' option value. */
+	int io_uring;          /* Copy of part of 'iooptions' option value. */
+	int bypass_cache;      /* Copy of part of 'iooptions' option value. */
+	int verify_copies;     /* Copy of part of 'iooptions' option value. */
+	int copy_jobs;         /* Copy of 'copyjobs' option value. */
 	int shell_type;        /* Copy of curr_stats.shell_type */
 
 	/* Pointers to user-interaction functions. */
@@ -47,6 +47,7 @@
 #include "utils/str.h"
 #include "utils/string_array.h"
 #include "utils/utils.h"
+#include "dcache_watch.h"
 #include "filelist.h"
 #include "flist_hist.h"
 #include "registers.h"
@@ -114,6 +115,7 @@ static void load_sort_option_inner(view_t *view, signed char sort_keys[]);
 static void aproposprg_handler(OPT_OP op, optval_t val);
 static void autocd_handler(OPT_OP op, optval_t val);
 static void autochpos_handler(OPT_OP op, optval_t val);
+static void bgjobs_handler(OPT_OP op, optval_t val);
 static void caseoptions_handler(OPT_OP op, optval_t val);
 static void cdpath_handler(OPT_OP op, optval_t val);
 static void chaselinks_handler(OPT_OP op, optval_t val);
@@ -125,10 +127,13 @@ static int validate_decorations(const char prefix[], const char suffix[]);
 static void free_file_decs(file_dec_t *name_decs, int count);
 static void columns_handler(OPT_OP op, optval_t val);
 static void confirm_handler(OPT_OP op, optval_t val);
+static void copyjobs_handler(OPT_OP op, optval_t val);
 static void cpoptions_handler(OPT_OP op, optval_t val);
 static void cvoptions_handler(OPT_OP op, optval_t val);
 static void deleteprg_handler(OPT_OP op, optval_t val);
 static void dirsize_handler(OPT_OP op, optval_t val);
+static void dirsizecache_handler(OPT_OP op, optval_t val);
+static void dirsizewatch_handler(OPT_OP op, optval_t val);
 static void dotdirs_handler(OPT_OP op, optval_t val);
 static void fastrun_handler(OPT_OP op, optval_t val);
 static void fillchars_handler(OPT_OP op, optval_t val);
@@ -361,6 +366,10 @@ ARRAY_GUARD(suggestoptions_vals, NUM_SUGGESTION_FLAGS);
 static const char *iooptions_vals[][2] = {
 	{ "fastfilecloning", "use COW if FS supports it" },
 	{ "datasync",        "synchronize writes to storage" },
+	{ "sparsefiles",     "preserve holes of sparse files" },
+	{ "iouring",         "use io_uring for file data" },
+	{ "nocache",         "don't keep copied data in cache" },
+	{ "verify",          "check copied data by reading it" },
 };
 
 /* Possible flags of 'shortmess' and their count. */
@@ -593,6 +602,10 @@ options[] = {
 	  OPT_BOOL, 0, NULL, &autochpos_handler, NULL,
 	  { .ref.bool_val = &cfg.auto_ch_pos },
 	},
+	{ "bgjobs", "", "max number of background jobs run at once",
+	  OPT_INT, 0, NULL, &bgjobs_handler, NULL,
+	  { .ref.int_val = &cfg.bg_jobs },
+	},
 	{ "caseoptions", "", "case sensitivity overrides",
 	  OPT_CHARSET, ARRAY_LEN(caseoptions_vals), caseoptions_vals,
 		&caseoptions_handler, NULL,
@@ -618,6 +631,10 @@ options[] = {
 	  OPT_SET, ARRAY_LEN(confirm_vals), confirm_vals, &confirm_handler, NULL,
 	  { .ref.bool_val = &cfg.confirm },
 	},
+	{ "copyjobs", "", "max number of files copied at once",
+	  OPT_INT, 0, NULL, &copyjobs_handler, NULL,
+	  { .ref.int_val = &cfg.copy_jobs },
+	},
 	{ "cpoptions", "cpo", "compatibility options",
 	  OPT_CHARSET, ARRAY_LEN(cpoptions_vals), cpoptions_vals, &cpoptions_handler,
 		NULL,
@@ -636,6 +653,14 @@ options[] = {
 	  OPT_ENUM, ARRAY_LEN(dirsize_enum), dirsize_enum, &dirsize_handler, NULL,
 	  { .init = &init_dirsize },
 	},
+	{ "dirsizecache", "", "number of directory sizes kept between runs",
+	  OPT_INT, 0, NULL, &dirsizecache_handler, NULL,
+	  { .ref.int_val = &cfg.dir_size_cache },
+	},
+	{ "dirsizewatch", "", "number of directories watched for size changes",
+	  OPT_INT, 0, NULL, &dirsizewatch_handler, NULL,
+	  { .ref.int_val = &cfg.dir_size_watch },
+	},
 	{ "dotdirs", "", "which dot directories to show",
 	  OPT_SET, ARRAY_LEN(dotdirs_vals), dotdirs_vals, &dotdirs_handler, NULL,
 	  { .ref.set_items = &cfg.dot_dirs },
@@ -1312,7 +1337,11 @@ static void
 init_iooptions(optval_t *val)
 {
 	val->set_items = (cfg.fast_file_cloning != 0) << 0
-	               | (cfg.data_sync         != 0) << 1;
+	               | (cfg.data_sync         != 0) << 1
+	               | (cfg.sparse_files      != 0) << 2
+	               | (cfg.io_uring          != 0) << 3
+	               | (cfg.bypass_cache      != 0) << 4
+	               | (cfg.verify_copies     != 0) << 5;
 }
 
 /* Default-initializes whether to display file numbers. */
@@ -1749,6 +1778,20 @@ autochpos_handler(OPT_OP op, optval_t val)
 	}
 }
 
+static void
+bgjobs_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be positive: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("bgjobs", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.bg_jobs = val.int_val;
+}
+
 /* Handles changes of 'caseoptions' option.  Updates configuration and
  * normalizes option value. */
 static void
@@ -2053,6 +2096,20 @@ confirm_handler(OPT_OP op, optval_t val)
 	cfg.confirm = val.set_items;
 }
 
+static void
+copyjobs_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val <= 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be positive: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("copyjobs", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.copy_jobs = val.int_val;
+}
+
 /* Parses set of compatibility flags and changes configuration accordingly. */
 static void
 cpoptions_handler(OPT_OP op, optval_t val)
@@ -2110,6 +2167,42 @@ dirsize_handler(OPT_OP op, optval_t val)
 	update_screen(UT_REDRAW);
 }
 
+/* Handles changes of the number of directory sizes that are preserved between
+ * runs. */
+static void
+dirsizecache_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("dirsizecache", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.dir_size_cache = val.int_val;
+}
+
+/* Handles changes of the number of directories that are watched to keep their
+ * sizes up to date. */
+static void
+dirsizewatch_handler(OPT_OP op, optval_t val)
+{
+	if(val.int_val < 0)
+	{
+		vle_tb_append_linef(vle_err, "Argument must be >= 0: %d", val.int_val);
+		error = 1;
+		vle_opts_restore_default("dirsizewatch", OPT_GLOBAL);
+		return;
+	}
+
+	cfg.dir_size_watch = val.int_val;
+	if(cfg.dir_size_watch == 0)
+	{
+		dcache_watch_reset();
+	}
+}
+
 static void
 dotdirs_handler(OPT_OP op, optval_t val)
 {
@@ -2354,6 +2447,10 @@ iooptions_handler(OPT_OP op, optval_t val)
 {
 	cfg.fast_file_cloning = ((val.set_items & 1) != 0);
 	cfg.data_sync = ((val.set_items & 2) != 0);
+	cfg.sparse_files = ((val.set_items & 4) != 0);
+	cfg.io_uring = ((val.set_items & 8) != 0);
+	cfg.bypass_cache = ((val.set_items & 16) != 0);
+	cfg.verify_copies = ((val.set_items & 32) != 0);
 }
 
 static void
@@ -47,6 +47,7 @@ static void _gnuc_noreturn shutdown_nicely(int sig, const char descr[]);
 
 #include "utils/macros.h"
 #include "background.h"
+#include "event_loop.h"
 #include "status.h"
 
 /* Handle term resizing in X */
@@ -86,9 +87,11 @@ handle_signal(int sig)
 			break;
 		case SIGWINCH:
 			received_sigwinch();
+			event_loop_wake();
 			break;
 		case SIGCONT:
 			received_sigcont();
+			event_loop_wake();
 			break;
 		/* Shutdown nicely */
 		case SIGHUP:
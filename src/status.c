@@ -22,13 +22,18 @@
 #include <sys/types.h> /* ino_t */
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
 #include <limits.h> /* INT_MIN */
-#include <stddef.h> /* NULL */
-#include <string.h> /* memcpy() memmove() */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* int64_t uint32_t uint64_t */
+#include <stdio.h> /* FILE fclose() fread() fwrite() remove() snprintf() */
+#include <stdlib.h> /* free() malloc() */
+#include <string.h> /* memcmp() memcpy() memmove() strdup() strlen() */
 #include <time.h> /* time_t time() */
 
 #include "cfg/config.h"
 #include "compat/fs_limits.h"
+#include "compat/os.h"
 #include "compat/pthread.h"
 #include "compat/reallocarray.h"
 #include "lua/vlua.h"
@@ -59,6 +64,15 @@
 #define SCREEN_ENVVAR "STY"
 #define TMUX_ENVVAR "TMUX"
 
+/* Name of file in configuration directory that stores sizes of directories. */
+#define DCACHE_FILE "dirsizes"
+/* Signature and version of the format of DCACHE_FILE. */
+#define DCACHE_MAGIC "vifm-dirsizes-1\n"
+/* Number of independently locked parts of dcache. */
+#define DCACHE_SHARDS 16
+/* Initial value of path hash. */
+#define DCACHE_HASH_INIT 2166136261U
+
 /* dcache entry. */
 typedef struct
 {
@@ -70,6 +84,42 @@ typedef struct
 }
 dcache_data_t;
 
+/* Part of dcache that holds entries whose paths hash to it.  Each path is
+ * stored in a single shard, which is unrelated to shards of its parents. */
+typedef struct
+{
+	pthread_mutex_t lock; /* Thread-safety guard for the fields below. */
+	fsdata_t *size;       /* Cache for directory sizes. */
+	fsdata_t *nitems;     /* Cache for directory item count. */
+}
+dcache_shard_t;
+
+/* Type of callback for map_dcache_paths().  Invoked with lock of the shard
+ * held.  n is index of the path. */
+typedef void (*dcache_path_visitor)(dcache_shard_t *shard, const char path[],
+		int n, void *arg);
+
+/* Entry of dcache along with its path. */
+typedef struct
+{
+	char *path;         /* Full path to the directory. */
+	dcache_data_t data; /* Cached information. */
+}
+dcache_record_t;
+
+/* State of collecting dcache entries for storing them. */
+typedef struct
+{
+	dcache_record_t *records; /* Collected entries. */
+	size_t nrecords;          /* Number of elements in records. */
+	const void **nodes;       /* Data of nodes on the path to the current one. */
+	size_t *lens;             /* Lengths of paths of nodes in nodes. */
+	size_t depth;             /* Number of used elements in nodes and lens. */
+	size_t capacity;          /* Number of allocated elements in nodes and lens. */
+	char path[PATH_MAX + 1];  /* Path of the current node. */
+}
+dcache_collector_t;
+
 /* Saved view selection. */
 typedef struct
 {
@@ -86,7 +136,25 @@ static int reset_dircache(void);
 static void set_last_cmdline_command(const char cmd[]);
 static void dcache_get(const char path[], time_t mtime, uint64_t inode,
 		dcache_result_t *size, dcache_result_t *nitems);
-static void size_updater(void *data, void *arg);
+static void dcache_get_entry(fsdata_t *fsd, const char path[], time_t mtime,
+		uint64_t inode, dcache_result_t *result);
+static int resolve_dcache_path(const char path[], char real_path[]);
+static dcache_shard_t * get_dcache_shard(const char path[]);
+static uint32_t hash_dcache_path(uint32_t hash, const char path[], size_t len);
+static void size_updater(dcache_shard_t *shard, const char path[], int n,
+		void *arg);
+static void size_invalidator(dcache_shard_t *shard, const char path[], int n,
+		void *arg);
+static int map_dcache_paths(char real_path[], int include_self,
+		dcache_path_visitor visitor, void *arg);
+static void dcache_load(void);
+static void load_dcache_file(void);
+static int read_dcache_record(FILE *fp, dcache_record_t *record);
+static int collect_dcache_record(const char name[], int valid,
+		const void *parent_data, void *data, void *arg);
+static int dcache_record_cmp(const void *a, const void *b);
+static int write_dcache_file(const char path[], const dcache_record_t records[],
+		size_t count);
 TSTATIC time_t dcache_get_size_timestamp(const char path[]);
 TSTATIC void dcache_set_size_timestamp(const char path[], time_t ts);
 
@@ -100,14 +168,15 @@ static int pending_refresh;
 static int inside_screen;
 static int inside_tmux;
 
-/* Thread-safety guard for dcache_size variable. */
-static pthread_mutex_t dcache_size_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Thread-safety guard for dcache_nitems variable. */
-static pthread_mutex_t dcache_nitems_mutex = PTHREAD_MUTEX_INITIALIZER;
-/* Cache for directory sizes. */
-static fsdata_t *dcache_size;
-/* Cache for directory item count. */
-static fsdata_t *dcache_nitems;
+/* Cache of directory sizes and item counts split into shards to let threads
+ * work with different paths in parallel. */
+static dcache_shard_t dcache[DCACHE_SHARDS] = {
+	[0 ... DCACHE_SHARDS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+/* Serializes loading of DCACHE_FILE. */
+static pthread_mutex_t dcache_load_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Whether dcache has been populated from DCACHE_FILE. */
+static int dcache_loaded;
 
 /* Whether UI updates should be "paused" (a counter, not a flag). */
 static int silent_ui;
@@ -271,13 +340,27 @@ stats_reset(const config_t *config)
 static int
 reset_dircache(void)
 {
-	fsdata_free(dcache_size);
-	dcache_size = fsdata_create(0, 1);
+	int error = 0;
+
+	int i;
+	for(i = 0; i < DCACHE_SHARDS; ++i)
+	{
+		dcache_shard_t *const shard = &dcache[i];
+		pthread_mutex_lock(&shard->lock);
+
+		/* Paths are resolved before taking the lock. */
+		fsdata_free(shard->size);
+		shard->size = fsdata_create(0, 0);
 
-	fsdata_free(dcache_nitems);
-	dcache_nitems = fsdata_create(0, 1);
+		fsdata_free(shard->nitems);
+		shard->nitems = fsdata_create(0, 0);
 
-	return (dcache_size == NULL || dcache_nitems == NULL);
+		error |= (shard->size == NULL || shard->nitems == NULL);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	__atomic_store_n(&dcache_loaded, 0, __ATOMIC_RELEASE);
+	return error;
 }
 
 void
@@ -620,115 +703,614 @@ dcache_get(const char path[], time_t mtime, uint64_t inode,
 	{
 		size->value = DCACHE_UNKNOWN;
 		size->is_valid = 0;
-
-		pthread_mutex_lock(&dcache_size_mutex);
-		dcache_data_t size_data;
-		if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
-		{
-			size->value = size_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			size->is_valid = (mtime < size_data.timestamp);
-#ifndef _WIN32
-			size->is_valid &= (inode == size_data.inode);
-#endif
-		}
-		pthread_mutex_unlock(&dcache_size_mutex);
 	}
-
 	if(nitems != NULL)
 	{
 		nitems->value = DCACHE_UNKNOWN;
 		nitems->is_valid = 0;
+	}
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		dcache_data_t nitems_data;
-		if(fsdata_get(dcache_nitems, path, &nitems_data, sizeof(nitems_data)) == 0)
-		{
-			nitems->value = nitems_data.value;
-			/* We check strictly for less than to handle scenario when multiple
-			 * changes occurred during the same second. */
-			nitems->is_valid = (mtime < nitems_data.timestamp);
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) != 0)
+	{
+		return;
+	}
+
+	dcache_load();
+
+	dcache_shard_t *const shard = get_dcache_shard(real_path);
+	pthread_mutex_lock(&shard->lock);
+	if(size != NULL)
+	{
+		dcache_get_entry(shard->size, real_path, mtime, inode, size);
+	}
+	if(nitems != NULL)
+	{
+		dcache_get_entry(shard->nitems, real_path, mtime, inode, nitems);
+	}
+	pthread_mutex_unlock(&shard->lock);
+}
+
+/* Retrieves single entry of a shard checking whether it's outdated.  Must be
+ * called with lock of the shard held. */
+static void
+dcache_get_entry(fsdata_t *fsd, const char path[], time_t mtime,
+		uint64_t inode, dcache_result_t *result)
+{
+	dcache_data_t data;
+	if(fsdata_get(fsd, path, &data, sizeof(data)) == 0)
+	{
+		result->value = data.value;
+		/* We check strictly for less than to handle scenario when multiple
+		 * changes occurred during the same second. */
+		result->is_valid = (mtime < data.timestamp);
 #ifndef _WIN32
-			nitems->is_valid &= (inode == nitems_data.inode);
+		result->is_valid &= (inode == data.inode);
 #endif
-		}
-		pthread_mutex_unlock(&dcache_nitems_mutex);
 	}
 }
 
 void
 dcache_update_parent_sizes(const char path[], uint64_t by)
 {
-	pthread_mutex_lock(&dcache_size_mutex);
-	(void)fsdata_map_parents(dcache_size, path, &size_updater, &by);
-	pthread_mutex_unlock(&dcache_size_mutex);
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) == 0)
+	{
+		(void)map_dcache_paths(real_path, /*include_self=*/0, &size_updater, &by);
+	}
 }
 
-/* Updates cached value by a fixed amount. */
+/* Updates cached size by a fixed amount. */
 static void
-size_updater(void *data, void *arg)
+size_updater(dcache_shard_t *shard, const char path[], int n, void *arg)
 {
 	const uint64_t *const by = arg;
-	dcache_data_t *const what = data;
 
-	what->value += *by;
+	dcache_data_t data;
+	if(fsdata_get(shard->size, path, &data, sizeof(data)) == 0)
+	{
+		data.value += *by;
+		(void)fsdata_set(shard->size, path, &data, sizeof(data));
+	}
+}
+
+int
+dcache_invalidate(const char path[], char top[], size_t top_len)
+{
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) != 0)
+	{
+		return 1;
+	}
+
+	/* Lengths of cached paths or zeroes for paths that aren't cached. */
+	size_t lens[PATH_MAX/2 + 2] = { 0 };
+	const int n = map_dcache_paths(real_path, /*include_self=*/1, &size_invalidator,
+			lens);
+
+	/* Find the outermost directory of a chain of cached ones ending at path. */
+	int i = n - 1;
+	if(lens[i] == 0U)
+	{
+		return 1;
+	}
+	while(i > 0 && lens[i - 1] != 0U)
+	{
+		--i;
+	}
+
+	copy_str(top, MIN(top_len, lens[i] + 1U), real_path);
+	return 0;
+}
+
+/* Marks cached size as outdated and records length of the path. */
+static void
+size_invalidator(dcache_shard_t *shard, const char path[], int n, void *arg)
+{
+	size_t *const lens = arg;
+
+	dcache_data_t data;
+	if(fsdata_get(shard->size, path, &data, sizeof(data)) == 0)
+	{
+		/* Timestamp that precedes any modification time. */
+		data.timestamp = 0;
+		(void)fsdata_set(shard->size, path, &data, sizeof(data));
+
+		lens[n] = strlen(path);
+	}
+}
+
+/* Invokes visitor for each parent of the resolved path ordered from the root
+ * and then for the path itself if include_self is set.  Calls are grouped by
+ * shards to take lock of every shard at most once.  Visitor gets index of the
+ * path in that order.  Returns number of visited paths. */
+static int
+map_dcache_paths(char real_path[], int include_self,
+		dcache_path_visitor visitor, void *arg)
+{
+	/* Lengths of paths and indexes of their shards. */
+	unsigned short lens[PATH_MAX/2 + 2];
+	unsigned char shards[PATH_MAX/2 + 2];
+	int npaths = 0;
+	/* Bit set of shards that contain at least one of the paths. */
+	unsigned int shards_mask = 0U;
+
+#ifndef _WIN32
+	/* Root directory is a parent of everything. */
+	if(real_path[1] != '\0' || include_self)
+	{
+		lens[npaths] = 1U;
+		shards[npaths] = hash_dcache_path(DCACHE_HASH_INIT, "/", 1U)%DCACHE_SHARDS;
+		shards_mask |= 1U << shards[npaths];
+		++npaths;
+	}
+#endif
+
+	uint32_t hash = DCACHE_HASH_INIT;
+	size_t hashed = 0U;
+	size_t i;
+	for(i = 1U; real_path[i - 1U] != '\0'; ++i)
+	{
+		const int end = (real_path[i] == '\0');
+		if(real_path[i] != '/' && !(end && include_self))
+		{
+			continue;
+		}
+		if(end && i == 1U)
+		{
+			/* Root is already processed. */
+			break;
+		}
+
+		hash = hash_dcache_path(hash, real_path + hashed, i - hashed);
+		hashed = i;
+
+		lens[npaths] = i;
+		shards[npaths] = hash%DCACHE_SHARDS;
+		shards_mask |= 1U << shards[npaths];
+		++npaths;
+	}
+
+	unsigned int s;
+	for(s = 0U; s < DCACHE_SHARDS; ++s)
+	{
+		if(!(shards_mask & (1U << s)))
+		{
+			continue;
+		}
+
+		dcache_shard_t *const shard = &dcache[s];
+		pthread_mutex_lock(&shard->lock);
+
+		int j;
+		for(j = 0; j < npaths; ++j)
+		{
+			if(shards[j] != s)
+			{
+				continue;
+			}
+
+			const char c = real_path[lens[j]];
+			real_path[lens[j]] = '\0';
+			visitor(shard, real_path, j, arg);
+			real_path[lens[j]] = c;
+		}
+
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	return npaths;
 }
 
 int
 dcache_set_at(const char path[], uint64_t inode, uint64_t size, uint64_t nitems)
 {
+	if(size == DCACHE_UNKNOWN && nitems == DCACHE_UNKNOWN)
+	{
+		return 0;
+	}
+
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) != 0)
+	{
+		return 1;
+	}
+
+	dcache_data_t data = { .timestamp = time(NULL) };
+#ifndef _WIN32
+	data.inode = (ino_t)inode;
+#endif
+
 	int ret = 0;
-	const time_t ts = time(NULL);
 
+	dcache_shard_t *const shard = get_dcache_shard(real_path);
+	pthread_mutex_lock(&shard->lock);
 	if(size != DCACHE_UNKNOWN)
 	{
-		dcache_data_t data = { .value = size, .timestamp = ts };
+		data.value = size;
+		ret |= fsdata_set(shard->size, real_path, &data, sizeof(data));
+	}
+	if(nitems != DCACHE_UNKNOWN)
+	{
+		data.value = nitems;
+		ret |= fsdata_set(shard->nitems, real_path, &data, sizeof(data));
+	}
+	pthread_mutex_unlock(&shard->lock);
+
+	return ret;
+}
+
+/* Resolves path to the form used as a key in dcache.  This is done outside of
+ * locks as it involves system calls.  real_path should be at least PATH_MAX
+ * characters long.  Returns zero on success, otherwise non-zero is
+ * returned. */
+static int
+resolve_dcache_path(const char path[], char real_path[])
+{
+	return (os_realpath(path, real_path) != real_path);
+}
+
+/* Picks shard that contains entry of the resolved path.  Returns the shard. */
+static dcache_shard_t *
+get_dcache_shard(const char path[])
+{
+	const uint32_t hash = hash_dcache_path(DCACHE_HASH_INIT, path, strlen(path));
+	return &dcache[hash%DCACHE_SHARDS];
+}
+
+/* Continues computing FNV-1a hash of a path, which allows hashing a path piece
+ * by piece.  Returns updated hash. */
+static uint32_t
+hash_dcache_path(uint32_t hash, const char path[], size_t len)
+{
+	size_t i;
+	for(i = 0U; i < len; ++i)
+	{
 #ifndef _WIN32
-		data.inode = (ino_t)inode;
+		hash ^= (unsigned char)path[i];
+#else
+		/* File systems are case insensitive. */
+		hash ^= (unsigned char)tolower((unsigned char)path[i]);
 #endif
+		hash *= 16777619U;
+	}
+	return hash;
+}
 
-		pthread_mutex_lock(&dcache_size_mutex);
-		ret |= fsdata_set(dcache_size, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_size_mutex);
+void
+dcache_store(void)
+{
+	if(cfg.dir_size_cache <= 0)
+	{
+		return;
 	}
 
-	if(nitems != DCACHE_UNKNOWN)
+	dcache_collector_t collector = { .depth = 0 };
+
+	/* Merge entries stored by other instances (possibly after the file was read
+	 * by this one), so that they aren't dropped. */
+	if(cfg.config_dir[0] != '\0')
+	{
+		pthread_mutex_lock(&dcache_load_mutex);
+		load_dcache_file();
+		__atomic_store_n(&dcache_loaded, 1, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&dcache_load_mutex);
+	}
+
+	int s;
+	for(s = 0; s < DCACHE_SHARDS; ++s)
+	{
+		dcache_shard_t *const shard = &dcache[s];
+		pthread_mutex_lock(&shard->lock);
+		(void)fsdata_traverse(shard->size, &collect_dcache_record, &collector);
+		pthread_mutex_unlock(&shard->lock);
+	}
+
+	free(collector.nodes);
+	free(collector.lens);
+
+	/* The newest entries are the first ones to be kept. */
+	safe_qsort(collector.records, collector.nrecords,
+			sizeof(*collector.records), &dcache_record_cmp);
+
+	size_t count = MIN(collector.nrecords, (size_t)cfg.dir_size_cache);
+
+	char path[PATH_MAX + 16];
+	snprintf(path, sizeof(path), "%s/%s", cfg.config_dir, DCACHE_FILE);
+	char tmp_path[PATH_MAX + 64];
+	snprintf(tmp_path, sizeof(tmp_path), "%s_%u", path, get_pid());
+
+	if(write_dcache_file(tmp_path, collector.records, count) != 0 ||
+			rename_file(tmp_path, path) != 0)
+	{
+		LOG_ERROR_MSG("Failed to store sizes of directories to %s", path);
+		(void)remove(tmp_path);
+	}
+
+	size_t i;
+	for(i = 0; i < collector.nrecords; ++i)
+	{
+		free(collector.records[i].path);
+	}
+	free(collector.records);
+}
+
+/* Merges entries of DCACHE_FILE into dcache once after dcache is reset. */
+static void
+dcache_load(void)
+{
+	if(__atomic_load_n(&dcache_loaded, __ATOMIC_ACQUIRE) ||
+			cfg.dir_size_cache <= 0 || cfg.config_dir[0] == '\0')
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&dcache_load_mutex);
+	if(!__atomic_load_n(&dcache_loaded, __ATOMIC_RELAXED))
+	{
+		load_dcache_file();
+		__atomic_store_n(&dcache_loaded, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&dcache_load_mutex);
+}
+
+/* Reads entries of DCACHE_FILE into dcache.  Paths are stored in resolved form,
+ * so they are used as is without touching file system and entries are
+ * validated on lookup. */
+static void
+load_dcache_file(void)
+{
+	char path[PATH_MAX + 16];
+	snprintf(path, sizeof(path), "%s/%s", cfg.config_dir, DCACHE_FILE);
+	FILE *fp = os_fopen(path, "rb");
+	if(fp == NULL)
+	{
+		return;
+	}
+
+	char magic[sizeof(DCACHE_MAGIC) - 1U];
+	if(fread(magic, sizeof(magic), 1U, fp) != 1U ||
+			memcmp(magic, DCACHE_MAGIC, sizeof(magic)) != 0)
 	{
-		dcache_data_t data = { .value = nitems, .timestamp = ts };
+		fclose(fp);
+		return;
+	}
+
+	int left = cfg.dir_size_cache;
+	dcache_record_t record;
+	while(left-- > 0 && read_dcache_record(fp, &record) == 0)
+	{
+		dcache_shard_t *const shard = get_dcache_shard(record.path);
+		pthread_mutex_lock(&shard->lock);
+
+		/* Don't overwrite newer information or invalidation (zero timestamp) done
+		 * by this instance. */
+		dcache_data_t current;
+		if(fsdata_get(shard->size, record.path, &current, sizeof(current)) != 0 ||
+				(current.timestamp != 0 && current.timestamp < record.data.timestamp))
+		{
+			(void)fsdata_set(shard->size, record.path, &record.data,
+					sizeof(record.data));
+		}
+
+		pthread_mutex_unlock(&shard->lock);
+		free(record.path);
+	}
+
+	fclose(fp);
+}
+
+/* Reads single entry of DCACHE_FILE.  Returns zero on success, otherwise
+ * non-zero is returned. */
+static int
+read_dcache_record(FILE *fp, dcache_record_t *record)
+{
+	uint64_t value, inode;
+	int64_t timestamp;
+	uint32_t len;
+	if(fread(&value, sizeof(value), 1U, fp) != 1U ||
+			fread(&inode, sizeof(inode), 1U, fp) != 1U ||
+			fread(&timestamp, sizeof(timestamp), 1U, fp) != 1U ||
+			fread(&len, sizeof(len), 1U, fp) != 1U)
+	{
+		return 1;
+	}
+
+	if(len == 0U || len > PATH_MAX)
+	{
+		return 1;
+	}
+
+	record->path = malloc(len + 1U);
+	if(record->path == NULL)
+	{
+		return 1;
+	}
+
+	if(fread(record->path, len, 1U, fp) != 1U)
+	{
+		free(record->path);
+		return 1;
+	}
+	record->path[len] = '\0';
+
+	record->data.value = value;
+	record->data.timestamp = timestamp;
 #ifndef _WIN32
-		data.inode = (ino_t)inode;
+	record->data.inode = (ino_t)inode;
 #endif
+	return 0;
+}
 
-		pthread_mutex_lock(&dcache_nitems_mutex);
-		ret |= fsdata_set(dcache_nitems, path, &data, sizeof(data));
-		pthread_mutex_unlock(&dcache_nitems_mutex);
+/* fsdata_traverse() callback that builds paths of nodes and collects valid
+ * ones.  Returns non-zero on error to stop traversal. */
+static int
+collect_dcache_record(const char name[], int valid, const void *parent_data,
+		void *data, void *arg)
+{
+	dcache_collector_t *const collector = arg;
+
+	/* Nodes are visited in pre-order, so parent is somewhere on the stack. */
+	while(collector->depth != 0 &&
+			collector->nodes[collector->depth - 1U] != parent_data)
+	{
+		--collector->depth;
 	}
 
-	return ret;
+	size_t len = (collector->depth == 0U)
+	           ? 0U
+	           : collector->lens[collector->depth - 1U];
+#ifdef _WIN32
+	const char *const sep = (collector->depth == 0 ? "" : "/");
+#else
+	const char *const sep = "/";
+#endif
+	len += snprintf(collector->path + len, sizeof(collector->path) - len, "%s%s",
+			sep, name);
+	if(len >= sizeof(collector->path))
+	{
+		return 1;
+	}
+
+	if(collector->depth == collector->capacity)
+	{
+		size_t capacity = collector->capacity*2U + 16U;
+		const void **nodes = reallocarray(collector->nodes, capacity,
+				sizeof(*nodes));
+		if(nodes == NULL)
+		{
+			return 1;
+		}
+		collector->nodes = nodes;
+
+		size_t *lens = reallocarray(collector->lens, capacity, sizeof(*lens));
+		if(lens == NULL)
+		{
+			return 1;
+		}
+		collector->lens = lens;
+
+		collector->capacity = capacity;
+	}
+
+	collector->nodes[collector->depth] = data;
+	collector->lens[collector->depth] = len;
+	++collector->depth;
+
+	if(!valid)
+	{
+		return 0;
+	}
+
+	dcache_record_t *records = reallocarray(collector->records,
+			collector->nrecords + 1U, sizeof(*records));
+	if(records == NULL)
+	{
+		return 1;
+	}
+	collector->records = records;
+
+	dcache_record_t *const record = &records[collector->nrecords];
+	record->path = strdup(collector->path);
+	if(record->path == NULL)
+	{
+		return 1;
+	}
+	memcpy(&record->data, data, sizeof(record->data));
+	++collector->nrecords;
+	return 0;
+}
+
+/* qsort() comparer that puts newer entries first.  Returns standard -1, 0, 1
+ * for comparisons. */
+static int
+dcache_record_cmp(const void *a, const void *b)
+{
+	const dcache_record_t *const lhs = a;
+	const dcache_record_t *const rhs = b;
+	return (lhs->data.timestamp < rhs->data.timestamp)
+	     - (lhs->data.timestamp > rhs->data.timestamp);
+}
+
+/* Writes entries to a file in format of DCACHE_FILE.  Returns zero on success,
+ * otherwise non-zero is returned. */
+static int
+write_dcache_file(const char path[], const dcache_record_t records[],
+		size_t count)
+{
+	FILE *fp = os_fopen(path, "wb");
+	if(fp == NULL)
+	{
+		return 1;
+	}
+
+	int failed = (fwrite(DCACHE_MAGIC, sizeof(DCACHE_MAGIC) - 1U, 1U, fp) != 1U);
+
+	size_t i;
+	for(i = 0U; i < count && !failed; ++i)
+	{
+		const dcache_data_t *const data = &records[i].data;
+		const uint64_t value = data->value;
+#ifndef _WIN32
+		const uint64_t inode = data->inode;
+#else
+		const uint64_t inode = 0U;
+#endif
+		const int64_t timestamp = data->timestamp;
+		const uint32_t len = strlen(records[i].path);
+
+		failed = fwrite(&value, sizeof(value), 1U, fp) != 1U
+		      || fwrite(&inode, sizeof(inode), 1U, fp) != 1U
+		      || fwrite(&timestamp, sizeof(timestamp), 1U, fp) != 1U
+		      || fwrite(&len, sizeof(len), 1U, fp) != 1U
+		      || fwrite(records[i].path, len, 1U, fp) != 1U;
+	}
+
+	failed |= (fclose(fp) != 0);
+	return failed;
 }
 
 TSTATIC time_t
 dcache_get_size_timestamp(const char path[])
 {
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) != 0)
+	{
+		return -1;
+	}
+
+	time_t ts = -1;
+
+	dcache_shard_t *const shard = get_dcache_shard(real_path);
+	pthread_mutex_lock(&shard->lock);
 	dcache_data_t size_data;
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
+	if(fsdata_get(shard->size, real_path, &size_data, sizeof(size_data)) == 0)
 	{
-		return size_data.timestamp;
+		ts = size_data.timestamp;
 	}
+	pthread_mutex_unlock(&shard->lock);
 
-	return -1;
+	return ts;
 }
 
 TSTATIC void
 dcache_set_size_timestamp(const char path[], time_t ts)
 {
+	char real_path[PATH_MAX + 1];
+	if(resolve_dcache_path(path, real_path) != 0)
+	{
+		return;
+	}
+
+	dcache_shard_t *const shard = get_dcache_shard(real_path);
+	pthread_mutex_lock(&shard->lock);
 	dcache_data_t size_data;
-	if(fsdata_get(dcache_size, path, &size_data, sizeof(size_data)) == 0)
+	if(fsdata_get(shard->size, real_path, &size_data, sizeof(size_data)) == 0)
 	{
 		size_data.timestamp = ts;
-		(void)fsdata_set(dcache_size, path, &size_data, sizeof(size_data));
+		(void)fsdata_set(shard->size, real_path, &size_data, sizeof(size_data));
 	}
+	pthread_mutex_unlock(&shard->lock);
 }
 
 void
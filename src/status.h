@@ -20,6 +20,7 @@
 #ifndef VIFM__STATUS_H__
 #define VIFM__STATUS_H__
 
+#include <stddef.h> /* size_t */
 #include <stdint.h> /* uint64_t */
 #include <stdio.h> /* FILE */
 #include <time.h> /* time_t */
@@ -345,11 +346,22 @@ void dcache_get_of(const struct dir_entry_t *entry, dcache_result_t *size,
 /* Updates cached sizes of parents by specified amount. */
 void dcache_update_parent_sizes(const char path[], uint64_t by);
 
+/* Marks cached sizes of the path and of all its parents as outdated.  top
+ * receives path of the outermost directory of the chain of directories with
+ * cached sizes that ends at the path.  Returns zero on success and non-zero if
+ * size of the path isn't cached. */
+int dcache_invalidate(const char path[], char top[], size_t top_len);
+
 /* Updates information about the path.  Returns zero on success, otherwise
  * non-zero is returned. */
 int dcache_set_at(const char path[], uint64_t inode, uint64_t size,
 		uint64_t nitems);
 
+/* Writes up to 'dirsizecache' most recently calculated sizes of directories to
+ * a file in configuration directory merging them with the ones already stored
+ * there.  Stored sizes are read back on first lookup in dcache. */
+void dcache_store(void);
+
 /* Selection history. */
 
 /* Adds/updates saved selection of files for a particular directory.  Takes
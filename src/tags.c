@@ -43,6 +43,7 @@ const char *tags[] = {
 	"vifm-'aproposprg'",
 	"vifm-'autocd'",
 	"vifm-'autochpos'",
+	"vifm-'bgjobs'",
 	"vifm-'caseoptions'",
 	"vifm-'cd'",
 	"vifm-'cdpath'",
@@ -52,11 +53,14 @@ const char *tags[] = {
 	"vifm-'co'",
 	"vifm-'columns'",
 	"vifm-'confirm'",
+	"vifm-'copyjobs'",
 	"vifm-'cpo'",
 	"vifm-'cpoptions'",
 	"vifm-'cvoptions'",
 	"vifm-'deleteprg'",
 	"vifm-'dirsize'",
+	"vifm-'dirsizecache'",
+	"vifm-'dirsizewatch'",
 	"vifm-'dotdirs'",
 	"vifm-'dotfiles'",
 	"vifm-'fastrun'",
@@ -931,6 +935,7 @@ const char *tags[] = {
 	"vifm-regexp",
 	"vifm-registers",
 	"vifm-reserved",
+	"vifm-resuming-operations",
 	"vifm-rl",
 	"vifm-scripts",
 	"vifm-see-also",
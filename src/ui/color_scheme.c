@@ -23,12 +23,14 @@
 #include <regex.h> /* regexec() */
 
 #include <assert.h> /* assert() */
+#include <ctype.h> /* tolower() */
 #include <limits.h> /* INT_MAX */
 #include <math.h> /* abs() */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* intptr_t */
 #include <stdio.h> /* snprintf() */
 #include <stdlib.h> /* free() */
-#include <string.h> /* memcpy() memset() strcpy() strlen() */
+#include <string.h> /* memcpy() memset() strchr() strcpy() strdup() strlen() */
 
 #include "../cfg/config.h"
 #include "../compat/dtype.h"
@@ -41,8 +43,10 @@
 #include "../utils/fsddata.h"
 #include "../utils/macros.h"
 #include "../utils/matchers.h"
+#include "../utils/path.h"
 #include "../utils/str.h"
 #include "../utils/string_array.h"
+#include "../utils/trie.h"
 #include "../utils/utils.h"
 #include "../status.h"
 #include "color_manager.h"
@@ -532,6 +536,12 @@ static void restore_primary_cs(const col_scheme_t *cs);
 static void reset_to_default_cs(col_scheme_t *cs);
 static void free_cs_highlights(col_scheme_t *cs);
 static file_hi_t * clone_file_highlights(const col_scheme_t *from);
+static void build_file_hi_index(col_scheme_t *cs);
+static void index_file_hi(col_scheme_t *cs, int i);
+static int add_file_hi_key(struct trie_t **trie, const char key[], int i);
+static void free_file_hi_index(file_hi_index_t *index);
+static int find_file_hi(const col_scheme_t *cs, const char fname[]);
+static void lower_bytes(char str[]);
 static col_attr_t * clone_column_highlights(const col_scheme_t *from);
 static void reset_cs_colors(col_scheme_t *cs);
 static int source_cs(const char name[]);
@@ -938,6 +948,9 @@ cs_assign(col_scheme_t *to, const col_scheme_t *from)
 	*to = *from;
 	to->file_hi = clone_file_highlights(from);
 	to->column_hi = clone_column_highlights(from);
+
+	to->file_hi_index = (file_hi_index_t){ };
+	build_file_hi_index(to);
 }
 
 /* Resets color scheme to default builtin values. */
@@ -967,6 +980,8 @@ free_cs_highlights(col_scheme_t *cs)
 	cs->file_hi = NULL;
 	cs->file_hi_count = 0;
 
+	free_file_hi_index(&cs->file_hi_index);
+
 	free(cs->column_hi);
 	cs->column_hi = NULL;
 	cs->column_hi_count = 0;
@@ -991,6 +1006,109 @@ clone_file_highlights(const col_scheme_t *from)
 	return file_hi;
 }
 
+/* Builds index of file highlights from scratch. */
+static void
+build_file_hi_index(col_scheme_t *cs)
+{
+	free_file_hi_index(&cs->file_hi_index);
+
+	int i;
+	for(i = 0; i < cs->file_hi_count; ++i)
+	{
+		index_file_hi(cs, i);
+	}
+}
+
+/* Adds file highlight with the specified index to index of file highlights.
+ * Highlights must be added in order. */
+static void
+index_file_hi(col_scheme_t *cs, int i)
+{
+	file_hi_index_t *const index = &cs->file_hi_index;
+	if(index->count != i)
+	{
+		/* The index is out of sync and won't be used. */
+		return;
+	}
+
+	int nglobs;
+	char **const globs = matchers_get_simple_globs(cs->file_hi[i].matchers,
+			&nglobs);
+	if(globs == NULL)
+	{
+		int *const rest = reallocarray(index->rest, index->rest_count + 1,
+				sizeof(*rest));
+		if(rest == NULL)
+		{
+			return;
+		}
+
+		index->rest = rest;
+		index->rest[index->rest_count++] = i;
+		++index->count;
+		return;
+	}
+
+	int j;
+	for(j = 0; j < nglobs; ++j)
+	{
+		/* Globs are either `*.suffix` or literal names. */
+		const int is_suffix = (globs[j][0] == '*');
+		struct trie_t **const trie = is_suffix ? &index->exts : &index->names;
+		if(add_file_hi_key(trie, globs[j] + is_suffix, i) != 0)
+		{
+			break;
+		}
+	}
+
+	if(j == nglobs)
+	{
+		++index->count;
+	}
+
+	free_string_array(globs, nglobs);
+}
+
+/* Maps lowercased version of the key to file highlight index unless key is
+ * already present (earlier highlights take precedence).  Creates trie on
+ * demand.  Returns zero on success, otherwise non-zero is returned. */
+static int
+add_file_hi_key(struct trie_t **trie, const char key[], int i)
+{
+	if(*trie == NULL)
+	{
+		*trie = trie_create(/*free_func=*/NULL);
+		if(*trie == NULL)
+		{
+			return 1;
+		}
+	}
+
+	char *const lower = strdup(key);
+	if(lower == NULL)
+	{
+		return 1;
+	}
+	lower_bytes(lower);
+
+	void *data;
+	const int result = (trie_get(*trie, lower, &data) == 0)
+	                 ? 0
+	                 : (trie_set(*trie, lower, (void *)(intptr_t)i) < 0);
+	free(lower);
+	return result;
+}
+
+/* Frees index of file highlights and resets it to an empty state. */
+static void
+free_file_hi_index(file_hi_index_t *index)
+{
+	trie_free(index->names);
+	trie_free(index->exts);
+	free(index->rest);
+	*index = (file_hi_index_t){ };
+}
+
 /* Clones column highlight array of the *from color scheme and returns it. */
 static col_attr_t *
 clone_column_highlights(const col_scheme_t *from)
@@ -1349,6 +1467,7 @@ cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi)
 	file_hi->hi = *hi;
 
 	++cs->file_hi_count;
+	index_file_hi(cs, cs->file_hi_count - 1);
 }
 
 const col_attr_t *
@@ -1365,19 +1484,89 @@ cs_get_file_hi(const col_scheme_t *cs, const char fname[], int *hi_hint)
 		return &cs->file_hi[*hi_hint].hi;
 	}
 
+	const int i = find_file_hi(cs, fname);
+	if(i == -1)
+	{
+		*hi_hint = INT_MAX;
+		return NULL;
+	}
+
+	*hi_hint = i;
+	return &cs->file_hi[i].hi;
+}
+
+/* Looks up the first file highlight that matches the path.  Returns its index
+ * or -1 if there is no match. */
+static int
+find_file_hi(const col_scheme_t *cs, const char fname[])
+{
+	const file_hi_index_t *const index = &cs->file_hi_index;
+	const char *const name = get_last_path_component(fname);
+
+	char lower[NAME_MAX + 2];
+	if(index->count != cs->file_hi_count || strlen(name) >= sizeof(lower))
+	{
+		/* Fallback to trying every highlight. */
+		int i;
+		for(i = 0; i < cs->file_hi_count; ++i)
+		{
+			if(matchers_match(cs->file_hi[i].matchers, fname))
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	copy_str(lower, sizeof(lower), name);
+	lower_bytes(lower);
+
+	int first = INT_MAX;
+	void *data;
+
+	if(trie_get(index->names, lower, &data) == 0)
+	{
+		first = (intptr_t)data;
+	}
+
+	/* Suffix patterns don't match dot files and the suffix can't include the
+	 * first character. */
+	if(lower[0] != '.')
+	{
+		const char *suffix = lower + 1;
+		while((suffix = strchr(suffix, '.')) != NULL)
+		{
+			if(trie_get(index->exts, suffix, &data) == 0 && (intptr_t)data < first)
+			{
+				first = (intptr_t)data;
+			}
+			++suffix;
+		}
+	}
+
+	/* Only highlights that precede the one that was found can override it. */
 	int i;
-	for(i = 0; i < cs->file_hi_count; ++i)
+	for(i = 0; i < index->rest_count && index->rest[i] < first; ++i)
 	{
-		const file_hi_t *const file_hi = &cs->file_hi[i];
-		if(matchers_match(file_hi->matchers, fname))
+		if(matchers_match(cs->file_hi[index->rest[i]].matchers, fname))
 		{
-			*hi_hint = i;
-			return &file_hi->hi;
+			return index->rest[i];
 		}
 	}
 
-	*hi_hint = INT_MAX;
-	return NULL;
+	return (first == INT_MAX ? -1 : first);
+}
+
+/* Converts string to lower case in place byte by byte, which is how globs are
+ * compared. */
+static void
+lower_bytes(char str[])
+{
+	while(*str != '\0')
+	{
+		*str = tolower((unsigned char)*str);
+		++str;
+	}
 }
 
 int
@@ -1394,6 +1583,7 @@ cs_del_file_hi(const char matchers_expr[])
 			memmove(&cs->file_hi[i], &cs->file_hi[i + 1],
 					sizeof(*cs->file_hi)*((cs->file_hi_count - 1) - i));
 			--cs->file_hi_count;
+			build_file_hi_index(cs);
 			return 1;
 		}
 	}
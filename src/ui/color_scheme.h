@@ -42,6 +42,7 @@ typedef enum
 ColorSchemeState;
 
 struct matchers_t;
+struct trie_t;
 
 /* Single file highlight description. */
 typedef struct
@@ -51,6 +52,18 @@ typedef struct
 }
 file_hi_t;
 
+/* Lookup structure for file highlights that avoids trying every matcher. */
+typedef struct
+{
+	struct trie_t *names; /* Lowercased literal names -> first highlight index. */
+	struct trie_t *exts;  /* Lowercased `.suffix` -> first highlight index. */
+	int *rest;            /* Indexes of highlights that need to be matched. */
+	int rest_count;       /* Number of elements in rest array. */
+	int count;            /* Number of indexed highlights, out of sync if it
+	                         doesn't match number of file highlights. */
+}
+file_hi_index_t;
+
 /* Color scheme description. */
 typedef struct
 {
@@ -59,8 +72,9 @@ typedef struct
 	col_attr_t color[MAXNUM_COLOR]; /* Colors with their attributes. */
 	int pair[MAXNUM_COLOR];         /* Pairs for corresponding color. */
 
-	file_hi_t *file_hi; /* List of file highlight preferences. */
-	int file_hi_count;  /* Number of file highlight definitions. */
+	file_hi_t *file_hi;            /* List of file highlight preferences. */
+	int file_hi_count;             /* Number of file highlight definitions. */
+	file_hi_index_t file_hi_index; /* Index for file_hi field. */
 
 	col_attr_t *column_hi; /* List of column highlight preferences.
 	                          Unused entries are filled with 0xff. */
@@ -151,8 +165,9 @@ void cs_overlap_colors(col_attr_t *color, const col_attr_t *admixture);
 void cs_add_file_hi(struct matchers_t *matchers, const col_attr_t *hi);
 
 /* Gets filename-specific highlight.  hi_hint can't be NULL and should be equal
- * to -1 initially.  Returns NULL if nothing is found, otherwise returns pointer
- * to one of color scheme's highlights. */
+ * to -1 initially, fname isn't used once result is cached in *hi_hint.  Returns
+ * NULL if nothing is found, otherwise returns pointer to one of color scheme's
+ * highlights. */
 const col_attr_t * cs_get_file_hi(const col_scheme_t *cs, const char fname[],
 		int *hi_hint);
 
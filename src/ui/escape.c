@@ -26,8 +26,8 @@
 #include <ctype.h> /* iscntrl() isdigit() */
 #include <stddef.h> /* NULL size_t */
 #include <stdlib.h> /* free() malloc() realloc() strtol() */
-#include <string.h> /* memcpy() memset() strchr() strcpy() strdup() strlen()
-                       strncpy() */
+#include <string.h> /* memcpy() memset() strchr() strcpy() strcspn() strdup()
+                       strlen() strncpy() */
 
 #include "../cfg/config.h"
 #include "../compat/reallocarray.h"
@@ -69,16 +69,20 @@ esc_remove(const char str[])
 	char *no_esc = strdup(str);
 	if(no_esc != NULL)
 	{
+		/* Escape byte never occurs inside of a multibyte character, so it's enough
+		 * to look for it to skip plain text. */
 		char *p = no_esc;
 		while(*str != '\0')
 		{
-			const size_t char_width_esc = get_char_width_esc(str);
-			if(*str != '\033')
+			const size_t text_len = strcspn(str, "\033");
+			memcpy(p, str, text_len);
+			p += text_len;
+			str += text_len;
+
+			if(*str == '\033')
 			{
-				memcpy(p, str, char_width_esc);
-				p += char_width_esc;
+				str += get_char_width_esc(str);
 			}
-			str += char_width_esc;
 		}
 		*p = '\0';
 	}
@@ -89,13 +93,10 @@ size_t
 esc_str_overhead(const char str[])
 {
 	size_t overhead = 0U;
-	while(*str != '\0')
+	while((str = strchr(str, '\033')) != NULL)
 	{
 		const size_t char_width_esc = get_char_width_esc(str);
-		if(*str == '\033')
-		{
-			overhead += char_width_esc;
-		}
+		overhead += char_width_esc;
 		str += char_width_esc;
 	}
 	return overhead;
@@ -30,11 +30,13 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* UINT64_C uint64_t uintptr_t */
 #include <stdlib.h> /* abs() malloc() */
-#include <string.h> /* memset() strcpy() strlen() */
+#include <string.h> /* memmove() memset() strcat() strcpy() strlen() */
 
 #include "../cfg/config.h"
 #include "../compat/pthread.h"
+#include "../compat/reallocarray.h"
 #include "../lua/vlua.h"
 #include "../utils/fs.h"
 #include "../utils/macros.h"
@@ -58,6 +60,10 @@
 /* Mark for a cursor position of inactive pane. */
 #define INACTIVE_CURSOR_MARK "*"
 
+/* Signature of an empty row of a file list.  Zero signature corresponds to a
+ * row with unknown contents. */
+#define BLANK_CELL 1U
+
 /**
  * View layouts
  * ------------
@@ -94,6 +100,14 @@
  * separately.
  */
 
+static void draw_scrolled_dir_list(view_t *view);
+static void draw_list(view_t *view, int reuse);
+static uint64_t get_layout_signature(const view_t *view, size_t col_width);
+static uint64_t get_cell_signature(const view_t *view, int pos,
+		int current_pos);
+static uint64_t mix_signature(uint64_t signature, uint64_t value);
+static void reset_drawn_cells(view_t *view, uint64_t layout);
+static int scroll_drawn_cells(view_t *view);
 static void draw_left_column(view_t *view);
 static void draw_right_column(view_t *view);
 static void draw_miller_separator(view_t *view, int column);
@@ -181,6 +195,9 @@ static void position_hardware_cursor(view_t *view);
 static int move_curr_line(view_t *view);
 static void reset_view_columns(view_t *view);
 
+/* Whether file lists are drawn when running tests. */
+TSTATIC int fview_draw_in_tests;
+
 void
 fview_setup(void)
 {
@@ -308,12 +325,34 @@ draw_dir_list(view_t *view)
 
 void
 draw_dir_list_only(view_t *view)
+{
+	draw_list(view, 0);
+}
+
+/* Redraws file list after it was scrolled reusing parts of the window that are
+ * still up to date. */
+static void
+draw_scrolled_dir_list(view_t *view)
+{
+	draw_list(view, 1);
+
+	if(view != curr_view)
+	{
+		fview_draw_inactive_cursor(view);
+	}
+}
+
+/* Draws file list of the view.  If reuse is non-zero and the window is known
+ * to be in sync with the list, only cells that have changed since the last
+ * drawing are drawn. */
+static void
+draw_list(view_t *view, int reuse)
 {
 	int x, cell;
 	size_t col_width, col_count;
 	int visible_cells;
 
-	if(curr_stats.load_stage < 2 || vifm_testing())
+	if(curr_stats.load_stage < 2 || (vifm_testing() && !fview_draw_in_tests))
 	{
 		return;
 	}
@@ -331,7 +370,13 @@ draw_dir_list_only(view_t *view)
 
 	view->top_line = calculate_top_position(view, view->top_line);
 
-	ui_view_erase(view, 0);
+	const uint64_t layout = get_layout_signature(view, col_width);
+	if(!reuse || layout == 0 || layout != view->drawn_layout ||
+			!scroll_drawn_cells(view))
+	{
+		ui_view_erase(view, 0);
+		reset_drawn_cells(view, layout);
+	}
 
 	draw_left_column(view);
 
@@ -345,6 +390,12 @@ draw_dir_list_only(view_t *view)
 			x < view->list_rows && cell < visible_cells;
 			++x, ++cell)
 	{
+		if(view->drawn_layout != 0 &&
+				view->drawn_cells[cell] == get_cell_signature(view, x, view->list_pos))
+		{
+			continue;
+		}
+
 		column_data_t cdt = {
 			.view = view,
 			.entry = &view->dir_entry[x],
@@ -353,6 +404,24 @@ draw_dir_list_only(view_t *view)
 		};
 
 		compute_and_draw_cell(&cdt, cell, col_count, col_width);
+
+		if(view->drawn_layout != 0)
+		{
+			/* Drawing caches highlight of the entry, so the signature is taken
+			 * afterwards to not count it as a change next time. */
+			view->drawn_cells[cell] = get_cell_signature(view, x, view->list_pos);
+		}
+	}
+
+	/* Clear rows below the end of the list which weren't empty. */
+	for(; view->drawn_layout != 0 && cell < view->ndrawn_cells; ++cell)
+	{
+		if(view->drawn_cells[cell] != BLANK_CELL)
+		{
+			wmove(view->win, cell, 0);
+			wclrtoeol(view->win);
+			view->drawn_cells[cell] = BLANK_CELL;
+		}
 	}
 
 	draw_right_column(view);
@@ -370,6 +439,159 @@ draw_dir_list_only(view_t *view)
 	ui_view_redrawn(view);
 }
 
+/* Computes signature of parameters that affect drawing of all cells of a file
+ * list.  Returns the signature or 0 if drawing of the list isn't tracked. */
+static uint64_t
+get_layout_signature(const view_t *view, size_t col_width)
+{
+	/* Multi-column layouts and miller view aren't tracked. */
+	if(!ui_view_displays_columns(view) || view->miller_view ||
+			view->displays_graphics)
+	{
+		return 0;
+	}
+
+	uint64_t signature = 0;
+	signature = mix_signature(signature, view->window_rows);
+	signature = mix_signature(signature, view->window_cols);
+	signature = mix_signature(signature, col_width);
+	signature = mix_signature(signature, view->real_num_width);
+	signature = mix_signature(signature, view->num_type);
+	signature = mix_signature(signature, view->list_rows);
+	signature = mix_signature(signature, (uintptr_t)view->dir_entry);
+	signature = mix_signature(signature, (uintptr_t)ui_view_get_cs(view));
+	signature = mix_signature(signature, (uintptr_t)get_view_columns(view, 0));
+	signature = mix_signature(signature, view->custom.type);
+	signature = mix_signature(signature, cfg.extra_padding);
+	signature = mix_signature(signature, view == curr_view);
+	return (signature == 0 ? 1 : signature);
+}
+
+/* Computes signature of a cell of file list that represents everything that
+ * affects how it's drawn.  Returns the signature. */
+static uint64_t
+get_cell_signature(const view_t *view, int pos, int current_pos)
+{
+	const dir_entry_t *entry = &view->dir_entry[pos];
+
+	uint64_t signature = 0;
+	signature = mix_signature(signature, (uintptr_t)entry);
+	signature = mix_signature(signature, (uintptr_t)entry->name);
+	signature = mix_signature(signature, entry->size);
+	signature = mix_signature(signature, entry->mtime);
+	signature = mix_signature(signature, entry->mode);
+	signature = mix_signature(signature, entry->uid);
+	signature = mix_signature(signature, entry->gid);
+	signature = mix_signature(signature, entry->nlinks);
+	signature = mix_signature(signature, entry->type);
+	signature = mix_signature(signature, entry->hi_num);
+	signature = mix_signature(signature, entry->search_match);
+	signature = mix_signature(signature, entry->selected);
+	signature = mix_signature(signature, entry->marked);
+	signature = mix_signature(signature, pos);
+	signature = mix_signature(signature, pos == current_pos);
+	if(view->num_type & NT_REL)
+	{
+		signature = mix_signature(signature, abs(pos - view->list_pos));
+	}
+
+	const char *c;
+	for(c = entry->name; *c != '\0'; ++c)
+	{
+		signature = mix_signature(signature, (unsigned char)*c);
+	}
+
+	/* Keep clear of special values. */
+	return (signature <= BLANK_CELL ? signature + BLANK_CELL + 1 : signature);
+}
+
+/* Mixes a value into a signature.  Returns new signature. */
+static uint64_t
+mix_signature(uint64_t signature, uint64_t value)
+{
+	/* FNV-1a-like step that processes the whole value at once. */
+	return (signature ^ value)*UINT64_C(0x100000001b3);
+}
+
+/* Forgets signatures of drawn cells assuming that the window is empty.  layout
+ * is a signature of the layout or 0 to disable tracking. */
+static void
+reset_drawn_cells(view_t *view, uint64_t layout)
+{
+	view->drawn_layout = 0;
+
+	if(layout == 0)
+	{
+		return;
+	}
+
+	if(view->ndrawn_cells != view->window_rows)
+	{
+		uint64_t *cells = reallocarray(view->drawn_cells, view->window_rows,
+				sizeof(*cells));
+		if(cells == NULL)
+		{
+			return;
+		}
+
+		view->drawn_cells = cells;
+		view->ndrawn_cells = view->window_rows;
+	}
+
+	int i;
+	for(i = 0; i < view->ndrawn_cells; ++i)
+	{
+		view->drawn_cells[i] = BLANK_CELL;
+	}
+
+	view->drawn_layout = layout;
+	view->drawn_top = view->top_line;
+}
+
+/* Scrolls contents of the window and signatures of its cells to match current
+ * top line of the view.  Returns non-zero on success. */
+static int
+scroll_drawn_cells(view_t *view)
+{
+	const int by = view->top_line - view->drawn_top;
+	const int n = view->ndrawn_cells;
+	view->drawn_top = view->top_line;
+
+	if(by == 0)
+	{
+		return 1;
+	}
+
+	if(abs(by) >= n)
+	{
+		/* Nothing can be reused, but all cells will be overwritten anyway. */
+		memset(view->drawn_cells, 0, sizeof(*view->drawn_cells)*n);
+		return 1;
+	}
+
+	scrollok(view->win, TRUE);
+	const int result = wscrl(view->win, by);
+	scrollok(view->win, FALSE);
+	if(result == ERR)
+	{
+		return 0;
+	}
+
+	if(by > 0)
+	{
+		memmove(&view->drawn_cells[0], &view->drawn_cells[by],
+				sizeof(*view->drawn_cells)*(n - by));
+		memset(&view->drawn_cells[n - by], 0, sizeof(*view->drawn_cells)*by);
+	}
+	else
+	{
+		memmove(&view->drawn_cells[-by], &view->drawn_cells[0],
+				sizeof(*view->drawn_cells)*(n + by));
+		memset(&view->drawn_cells[0], 0, sizeof(*view->drawn_cells)*-by);
+	}
+	return 1;
+}
+
 /* Draws a column to the left of the main part of the view. */
 static void
 draw_left_column(view_t *view)
@@ -871,7 +1093,7 @@ consider_scroll_bind(view_t *view)
 
 		if(window_shows_dirlist(other))
 		{
-			draw_dir_list(other);
+			draw_scrolled_dir_list(other);
 			refresh_view_win(other);
 		}
 	}
@@ -1032,6 +1254,19 @@ redraw_cell(view_t *view, int top, int cursor, int is_current)
 		.current_pos = is_current ? view->list_pos : -1,
 	};
 	compute_and_draw_cell(&cdt, cursor, col_count, col_width);
+
+	if(view->drawn_layout != 0)
+	{
+		if(top == view->drawn_top && cursor < view->ndrawn_cells)
+		{
+			view->drawn_cells[cursor] = get_cell_signature(view, pos,
+					cdt.current_pos);
+		}
+		else
+		{
+			view->drawn_layout = 0;
+		}
+	}
 }
 
 /* Fills in fields of cdt based on passed in arguments and
@@ -1465,9 +1700,20 @@ static void
 mix_in_file_name_hi(const view_t *view, dir_entry_t *entry, col_attr_t *col)
 {
 	const col_scheme_t *const cs = ui_view_get_cs(view);
-	char *const typed_fname = get_typed_entry_fpath(entry);
+
+	/* Path is needed only until the result is cached. */
+	char typed_fname[PATH_MAX + 2];
+	typed_fname[0] = '\0';
+	if(entry->hi_num == -1)
+	{
+		get_full_path_of(entry, sizeof(typed_fname) - 1U, typed_fname);
+		if(fentry_is_dir(entry))
+		{
+			strcat(typed_fname, "/");
+		}
+	}
+
 	const col_attr_t *color = cs_get_file_hi(cs, typed_fname, &entry->hi_num);
-	free(typed_fname);
 	if(color != NULL)
 	{
 		cs_mix_colors(col, color);
@@ -2044,7 +2290,7 @@ fview_position_updated(view_t *view)
 		invalidate_cursor_pos_cache(view);
 		if(move_curr_line(view))
 		{
-			draw_dir_list(view);
+			draw_scrolled_dir_list(view);
 		}
 		else
 		{
@@ -2068,7 +2314,7 @@ fview_position_updated(view_t *view)
 
 	if(redraw)
 	{
-		draw_dir_list(view);
+		draw_scrolled_dir_list(view);
 	}
 	else
 	{
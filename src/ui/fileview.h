@@ -171,6 +171,7 @@ void fview_position_updated(struct view_t *view);
 void fview_sorting_updated(struct view_t *view);
 
 TSTATIC_DEFS(
+	extern int fview_draw_in_tests;
 	struct format_info_t;
 	void format_name(void *data, size_t buf_len, char buf[],
 		const struct format_info_t *info);
@@ -343,6 +343,7 @@ view_file(const char path[], const preview_area_t *parea,
 	if(kind != VK_TEXTUAL)
 	{
 		qv_cleanup_area(parea, curr_stats.preview.cleanup_cmd);
+		ui_frame_flush();
 		usleep(cfg.graphics_delay);
 	}
 	else
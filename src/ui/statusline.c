@@ -1015,6 +1015,10 @@ format_job_bar(void)
 		{
 			snprintf(item_text, sizeof(item_text), "[%s]", ellipsed);
 		}
+		else if(progress == -2)
+		{
+			snprintf(item_text, sizeof(item_text), "[%s est.]", ellipsed);
+		}
 		else
 		{
 			snprintf(item_text, sizeof(item_text), "[%s %3d%%]", ellipsed, progress);
@@ -23,7 +23,7 @@
 
 #include "ui.h"
 
-#include <curses.h> /* mvwin() werase() */
+#include <curses.h> /* doupdate() mvwin() tigetstr() tparm() werase() */
 
 #ifndef _WIN32
 #include <sys/ioctl.h>
@@ -37,8 +37,9 @@
 #include <stddef.h> /* NULL size_t wchar_t */
 #include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* abs() free() */
-#include <stdio.h> /* snprintf() vsnprintf() */
+#include <stdio.h> /* fflush() fputs() snprintf() stdout vsnprintf() */
 #include <string.h> /* memset() strcat() strcmp() strcpy() strdup() strlen() */
+#include <time.h> /* CLOCK_MONOTONIC clock_gettime() */
 #include <wchar.h> /* wint_t wcslen() */
 
 #include "../cfg/config.h"
@@ -83,6 +84,10 @@
 #include "statusline.h"
 #include "tabs.h"
 
+/* Minimal time between two updates of the terminal made by flushing a frame in
+ * milliseconds. */
+#define FRAME_INTERVAL_MS 16
+
 /* List of formatted tab labels with some extra information. */
 typedef struct
 {
@@ -149,11 +154,25 @@ static WINDOW *lborder;
 static WINDOW *mborder;
 static WINDOW *rborder;
 
+/* Number of frames in progress. */
+static int frame_depth;
+/* Whether some refreshes were queued, but haven't reached the terminal yet. */
+static int frame_pending;
+/* When terminal was last updated by flushing a frame. */
+static long long frame_flushed_at;
+/* Sequences that start and finish synchronized update of the terminal or NULL
+ * if it's not known to support them. */
+static char *sync_begin;
+static char *sync_end;
+
 static int init_pair_wrapper(int pair, int fg, int bg);
 static int pair_content_wrapper(int pair, int *fg, int *bg);
 static int pair_in_use(int pair);
 static void move_pair(int from, int to);
 static void create_windows(void);
+static void init_sync_output(void);
+static void write_sync_seq(const char seq[]);
+static long long get_monotonic_ms(void);
 static void update_geometry(void);
 static int update_start(UpdateType update_kind);
 static void update_finish(void);
@@ -275,6 +294,7 @@ setup_ncurses_interface(void)
 	cs_load_defaults();
 
 	create_windows();
+	init_sync_output();
 
 	cfg.tab_stop = TABSIZE;
 
@@ -1387,12 +1407,131 @@ update_attributes(void)
 void
 ui_refresh_win(WINDOW *win)
 {
-	if(!stats_silenced_ui())
+	if(stats_silenced_ui())
+	{
+		return;
+	}
+
+	if(frame_depth > 0)
+	{
+		wnoutrefresh(win);
+		frame_pending = 1;
+		return;
+	}
+
+	use_wrefresh(win);
+}
+
+void
+ui_frame_begin(void)
+{
+	++frame_depth;
+}
+
+void
+ui_frame_end(void)
+{
+	assert(frame_depth > 0 && "Unbalanced frame end.");
+
+	if(--frame_depth == 0 && ui_frame_time_left() == 0)
+	{
+		ui_frame_flush();
+	}
+}
+
+int
+ui_frame_pending(void)
+{
+	return frame_pending;
+}
+
+int
+ui_frame_time_left(void)
+{
+	const long long elapsed = get_monotonic_ms() - frame_flushed_at;
+	return (elapsed >= FRAME_INTERVAL_MS || elapsed < 0)
+	     ? 0
+	     : FRAME_INTERVAL_MS - elapsed;
+}
+
+void
+ui_frame_flush(void)
+{
+	if(!frame_pending)
+	{
+		return;
+	}
+
+	frame_pending = 0;
+	frame_flushed_at = get_monotonic_ms();
+
+	write_sync_seq(sync_begin);
+	doupdate();
+	write_sync_seq(sync_end);
+}
+
+/* Determines how to ask the terminal to display updates atomically (DEC private
+ * mode 2026), which avoids tearing when updates are split into several
+ * writes. */
+static void
+init_sync_output(void)
+{
+#ifndef _WIN32
+	char *const sync = tigetstr("Sync");
+	if(sync != NULL && sync != (char *)-1)
+	{
+		/* The capability is parametrized: 1 starts an update and 2 finishes it. */
+		update_string(&sync_begin, tparm(sync, 1L, 0L, 0L, 0L, 0L, 0L, 0L, 0L, 0L));
+		update_string(&sync_end, tparm(sync, 2L, 0L, 0L, 0L, 0L, 0L, 0L, 0L, 0L));
+	}
+	else
+	{
+		/* Descriptions of these terminals might lack the capability. */
+		const char *const term = (curr_stats.term_name == NULL)
+		                       ? ""
+		                       : curr_stats.term_name;
+		if(strcmp(term, "foot") == 0 || starts_with_lit(term, "foot-") ||
+				strcmp(term, "xterm-kitty") == 0 || strcmp(term, "wezterm") == 0 ||
+				strcmp(term, "alacritty") == 0 || strcmp(term, "contour") == 0)
+		{
+			update_string(&sync_begin, "\033[?2026h");
+			update_string(&sync_end, "\033[?2026l");
+		}
+	}
+
+	if(sync_begin == NULL || sync_end == NULL)
+	{
+		update_string(&sync_begin, NULL);
+		update_string(&sync_end, NULL);
+	}
+#endif
+}
+
+/* Writes sequence related to synchronized output to the terminal.  Does
+ * nothing if seq is NULL. */
+static void
+write_sync_seq(const char seq[])
+{
+	if(seq != NULL)
 	{
-		use_wrefresh(win);
+		fputs(seq, stdout);
+		fflush(stdout);
 	}
 }
 
+/* Retrieves current time of a monotonic clock.  Returns the time in
+ * milliseconds. */
+static long long
+get_monotonic_ms(void)
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+	{
+		return 0;
+	}
+	return ts.tv_sec*1000LL + ts.tv_nsec/1000000;
+}
+
 void
 wprint(WINDOW *win, const char str[])
 {
@@ -2858,6 +2997,9 @@ ui_view_erase(view_t *view, int use_global_cs)
 	col_attr_t col = ui_get_win_color(view, cs);
 	ui_set_bg(view->win, &col, -1);
 	werase(view->win);
+
+	/* Whatever is drawn next, the list has to be drawn from scratch. */
+	view->drawn_layout = 0;
 }
 
 col_attr_t
@@ -2882,6 +3024,9 @@ ui_shutdown(void)
 {
 	if(curr_stats.load_stage >= 0 && !vifm_testing() && !isendwin())
 	{
+		/* Make sure that the screen matches what curses thinks is on it. */
+		ui_frame_flush();
+
 		ui_hide_graphics();
 		def_prog_mode();
 		endwin();
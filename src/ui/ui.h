@@ -420,6 +420,13 @@ struct view_t
 	int last_seen_pos;    /* To account for movement. */
 	int last_curr_line;   /* To account for scrolling. */
 
+	/* State of the window as of the last drawing of the list, which allows
+	 * redrawing only cells that have changed on scrolling. */
+	uint64_t drawn_layout; /* Signature of common parameters, 0 if invalid. */
+	uint64_t *drawn_cells; /* Signatures of rows of the window. */
+	int ndrawn_cells;      /* Number of elements in drawn_cells. */
+	int drawn_top;         /* Value of top_line at the time of drawing. */
+
 	int nsaved_selection;   /* Number of items in saved_selection. */
 	char **saved_selection; /* Names of selected files. */
 
@@ -604,10 +611,31 @@ void redraw_lists(void);
 /* Forces immediate update of attributes for most of windows. */
 void update_attributes(void);
 
-/* Refreshes the window, should be used instead of wrefresh(). */
+/* Refreshes the window, should be used instead of wrefresh().  Within a frame
+ * the refresh is only queued. */
 #pragma GCC poison wrefresh
 void ui_refresh_win(WINDOW *win);
 
+/* Starts a frame.  Refreshes of windows made within a frame are merged and
+ * sent to the terminal by ui_frame_flush().  Frames can nest. */
+void ui_frame_begin(void);
+
+/* Finishes a frame started by ui_frame_begin().  Finishing the outermost frame
+ * flushes queued refreshes if it can be done right away. */
+void ui_frame_end(void);
+
+/* Checks whether there are queued refreshes that haven't reached the terminal
+ * yet.  Returns non-zero if so, otherwise zero is returned. */
+int ui_frame_pending(void);
+
+/* Computes time that has to pass before the terminal can be updated again
+ * without exceeding the rate of one update per frame interval.  Returns the
+ * time in milliseconds. */
+int ui_frame_time_left(void);
+
+/* Sends queued refreshes to the terminal, if there are any. */
+void ui_frame_flush(void);
+
 /* Prints str in current window position. */
 void wprint(WINDOW *win, const char str[]);
 
@@ -19,7 +19,9 @@
 #ifndef VIFM__UTILS__FSWATCH_H__
 #define VIFM__UTILS__FSWATCH_H__
 
-/* Implementation of file system changes checks via polling. */
+/* Implementation of file system changes checks via polling.  Where inotify is
+ * available, all watchers share a single instance of it and polling any of
+ * them dispatches pending events to all of them. */
 
 /* Kinds of state reports. */
 typedef enum
@@ -45,6 +47,11 @@ void fswatch_free(fswatch_t *w);
  * query.  Returns latest state. */
 FSWatchState fswatch_poll(fswatch_t *w);
 
+/* Retrieves file descriptor that becomes readable when watchers might have
+ * something to report.  Returns the descriptor or -1 if there is no such
+ * descriptor and watchers need to be polled periodically. */
+int fswatch_get_fd(void);
+
 #endif /* VIFM__UTILS__FSWATCH_H__ */
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -35,25 +35,26 @@
 
 #include "../compat/fs_limits.h"
 #include "../compat/os.h"
+#include "../compat/reallocarray.h"
 #include "trie.h"
 
-/* TODO: consider implementation that could reuse already available descriptor
- *       by just removing old watch and then adding a new one. */
-
 /* Watcher data. */
 struct fswatch_t
 {
 	/* Path that's being watched. */
 	char *path;
-	/* File descriptor for inotify. */
-	int fd;
-	/* Watch descriptor. */
+	/* Watch descriptor or -1 if it was removed by the kernel. */
 	int wd;
 	/* Trie to keep track of per file frequency of notifications. */
 	trie_t *stats;
 	/* To monitor mount events, which aren't reported by inotify. */
 	dev_t dev;
 	ino_t inode;
+	/* Whether interesting events were dispatched since the last poll. */
+	int changed;
+	/* Whether the watch descriptor was removed by the kernel since the last
+	 * poll. */
+	int ignored;
 };
 
 /* Per file statistics information. */
@@ -67,6 +68,11 @@ typedef struct
 }
 notif_stat_t;
 
+static int subscribe(fswatch_t *w, int wd);
+static void unsubscribe(fswatch_t *w);
+static int find_subscribers(int wd);
+static int dispatch_events(void);
+static void dispatch_event(const struct inotify_event *e, time_t now);
 static FSWatchState poll_for_replacement(fswatch_t *w);
 static int update_file_stats(fswatch_t *w, const struct inotify_event *e,
 		time_t now);
@@ -76,6 +82,17 @@ static const uint32_t EVENTS_MASK = IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE
                                   | IN_CREATE | IN_DELETE | IN_EXCL_UNLINK
                                   | IN_MOVED_FROM | IN_MOVED_TO;
 
+/* inotify instance shared by all watchers or -1.  Kernel limits the number of
+ * instances per user, hence watches are multiplexed over a single one. */
+static int inotify_fd = -1;
+/* Watchers sorted by their watch descriptors.  Several watchers share the same
+ * descriptor when they watch the same directory. */
+static fswatch_t **subscribers;
+/* Number of elements in subscribers. */
+static int nsubscribers;
+/* Number of existing watchers, which can be larger than nsubscribers. */
+static int nwatchers;
+
 fswatch_t *
 fswatch_create(const char path[])
 {
@@ -93,37 +110,37 @@ fswatch_create(const char path[])
 
 	w->dev = st.st_dev;
 	w->inode = st.st_ino;
+	w->wd = -1;
+	w->changed = 0;
+	w->ignored = 0;
 
 	/* Create tree to collect update frequency statistics. */
 	w->stats = trie_create(&free);
 	if(w->stats == NULL)
 	{
-		trie_free(w->stats);
 		free(w);
 		return NULL;
 	}
 
-	/* Create inotify instance. */
-	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
-	if(w->fd == -1)
+	w->path = strdup(path);
+	if(w->path == NULL)
 	{
 		trie_free(w->stats);
 		free(w);
 		return NULL;
 	}
 
-	/* Add directory to watch. */
-	w->wd = inotify_add_watch(w->fd, path, EVENTS_MASK);
-	if(w->wd == -1)
+	++nwatchers;
+
+	/* Create inotify instance on first use. */
+	if(inotify_fd == -1)
 	{
-		close(w->fd);
-		trie_free(w->stats);
-		free(w);
-		return NULL;
+		inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
 	}
 
-	w->path = strdup(path);
-	if(w->path == NULL)
+	/* Add directory to watch. */
+	if(inotify_fd == -1 ||
+			subscribe(w, inotify_add_watch(inotify_fd, path, EVENTS_MASK)) != 0)
 	{
 		fswatch_free(w);
 		return NULL;
@@ -137,22 +154,141 @@ fswatch_free(fswatch_t *w)
 {
 	if(w != NULL)
 	{
+		unsubscribe(w);
 		free(w->path);
 		trie_free(w->stats);
-		close(w->fd);
 		free(w);
+
+		/* Don't keep inotify instance around when it's not needed. */
+		if(--nwatchers == 0 && inotify_fd != -1)
+		{
+			close(inotify_fd);
+			inotify_fd = -1;
+			free(subscribers);
+			subscribers = NULL;
+		}
 	}
 }
 
 FSWatchState
 fswatch_poll(fswatch_t *w)
+{
+	/* Events are read for all watchers at once and are queued per watcher. */
+	if(dispatch_events() != 0)
+	{
+		return FSWS_ERRORED;
+	}
+
+	const int changed = (w->changed && !w->ignored);
+	w->changed = 0;
+	w->ignored = 0;
+
+	return (changed ? FSWS_UPDATED : poll_for_replacement(w));
+}
+
+int
+fswatch_get_fd(void)
+{
+	return inotify_fd;
+}
+
+/* Adds watcher to the list of receivers of events for the watch descriptor.
+ * Returns zero on success, otherwise non-zero is returned. */
+static int
+subscribe(fswatch_t *w, int wd)
+{
+	if(wd == -1)
+	{
+		return 1;
+	}
+
+	fswatch_t **const new_subscribers = reallocarray(subscribers,
+			nsubscribers + 1, sizeof(*subscribers));
+	if(new_subscribers == NULL)
+	{
+		const int pos = find_subscribers(wd);
+		if(pos == nsubscribers || subscribers[pos]->wd != wd)
+		{
+			(void)inotify_rm_watch(inotify_fd, wd);
+		}
+		return 1;
+	}
+	subscribers = new_subscribers;
+
+	const int pos = find_subscribers(wd);
+	memmove(&subscribers[pos + 1], &subscribers[pos],
+			sizeof(*subscribers)*(nsubscribers - pos));
+	subscribers[pos] = w;
+	++nsubscribers;
+
+	w->wd = wd;
+	return 0;
+}
+
+/* Removes watcher from the list of receivers of events and removes the watch
+ * if nobody else uses it. */
+static void
+unsubscribe(fswatch_t *w)
+{
+	if(w->wd == -1)
+	{
+		return;
+	}
+
+	int pos = find_subscribers(w->wd);
+	while(subscribers[pos] != w)
+	{
+		++pos;
+	}
+
+	memmove(&subscribers[pos], &subscribers[pos + 1],
+			sizeof(*subscribers)*(nsubscribers - pos - 1));
+	--nsubscribers;
+
+	pos = find_subscribers(w->wd);
+	if(pos == nsubscribers || subscribers[pos]->wd != w->wd)
+	{
+		/* We ignore error from this call because input should always be correct
+		 * from our side, yet watch descriptor might have been killed by the
+		 * kernel.  So checking for an error causes false positives. */
+		(void)inotify_rm_watch(inotify_fd, w->wd);
+	}
+
+	w->wd = -1;
+}
+
+/* Looks up the first watcher with the specified watch descriptor.  Returns its
+ * index or index at which such a watcher should be inserted. */
+static int
+find_subscribers(int wd)
+{
+	int l = 0, u = nsubscribers;
+	while(l < u)
+	{
+		const int i = l + (u - l)/2;
+		if(subscribers[i]->wd < wd)
+		{
+			l = i + 1;
+		}
+		else
+		{
+			u = i;
+		}
+	}
+	return l;
+}
+
+/* Reads pending events of the shared inotify instance and dispatches them to
+ * watchers.  Returns zero on success, otherwise non-zero is returned. */
+static int
+dispatch_events(void)
 {
 	enum { MAX_READS = 100 };
 	enum { BUF_LEN = (10 * (sizeof(struct inotify_event) + NAME_MAX + 1)) };
 
-	char buf[BUF_LEN];
+	char buf[BUF_LEN]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
 	int nread;
-	int changed = 0;
 	int nreads = 0;
 	const time_t now = time(NULL);
 
@@ -162,29 +298,17 @@ fswatch_poll(fswatch_t *w)
 		struct inotify_event *e;
 
 		/* Receive a package of events. */
-		nread = read(w->fd, buf, BUF_LEN);
+		nread = read(inotify_fd, buf, BUF_LEN);
 		if(nread < 0)
 		{
-			if(errno != EAGAIN)
-			{
-				return FSWS_ERRORED;
-			}
-			break;
+			return (errno != EAGAIN);
 		}
 
 		/* And process each of them separately. */
 		for(p = buf; p < buf + nread; p += sizeof(struct inotify_event) + e->len)
 		{
 			e = (struct inotify_event *)p;
-			if((e->mask & IN_IGNORED) != 0 && e->wd == w->wd)
-			{
-				return poll_for_replacement(w);
-			}
-
-			if((e->mask & EVENTS_MASK) != 0 && update_file_stats(w, e, now))
-			{
-				changed = 1;
-			}
+			dispatch_event(e, now);
 		}
 
 		/* Limit maximum number of reads to ensure that we won't spend all our time
@@ -196,7 +320,59 @@ fswatch_poll(fswatch_t *w)
 	}
 	while(nread != 0);
 
-	return (changed ? FSWS_UPDATED : poll_for_replacement(w));
+	return 0;
+}
+
+/* Delivers single event to all of its receivers. */
+static void
+dispatch_event(const struct inotify_event *e, time_t now)
+{
+	int i;
+
+	if(e->mask & IN_Q_OVERFLOW)
+	{
+		/* Some events were lost, anything could have changed. */
+		for(i = 0; i < nsubscribers; ++i)
+		{
+			subscribers[i]->changed = 1;
+		}
+		return;
+	}
+
+	const int first = find_subscribers(e->wd);
+	int last = first;
+	while(last < nsubscribers && subscribers[last]->wd == e->wd)
+	{
+		++last;
+	}
+
+	if(e->mask & IN_IGNORED)
+	{
+		/* The watch doesn't exist anymore, so its descriptor is forgotten to not
+		 * confuse it with a new watch which can get the same number. */
+		for(i = first; i < last; ++i)
+		{
+			subscribers[i]->ignored = 1;
+			subscribers[i]->wd = -1;
+		}
+		memmove(&subscribers[first], &subscribers[last],
+				sizeof(*subscribers)*(nsubscribers - last));
+		nsubscribers -= last - first;
+		return;
+	}
+
+	if((e->mask & EVENTS_MASK) == 0)
+	{
+		return;
+	}
+
+	for(i = first; i < last; ++i)
+	{
+		if(update_file_stats(subscribers[i], e, now))
+		{
+			subscribers[i]->changed = 1;
+		}
+	}
 }
 
 /* Detects replacement of path's target.  Returns watcher's state. */
@@ -209,7 +385,7 @@ poll_for_replacement(fswatch_t *w)
 		return FSWS_ERRORED;
 	}
 
-	if(w->dev == st.st_dev && w->inode == st.st_ino)
+	if(w->dev == st.st_dev && w->inode == st.st_ino && w->wd != -1)
 	{
 		return FSWS_UNCHANGED;
 	}
@@ -217,18 +393,23 @@ poll_for_replacement(fswatch_t *w)
 	w->dev = st.st_dev;
 	w->inode = st.st_ino;
 
-	int wd = inotify_add_watch(w->fd, w->path, EVENTS_MASK);
+	/* New watch is added before removing the old one to not close inotify
+	 * instance in between. */
+	const int wd = inotify_add_watch(inotify_fd, w->path, EVENTS_MASK);
 	if(wd == -1)
 	{
 		return FSWS_ERRORED;
 	}
 
-	/* We ignore error from this call because input should always be correct from
-	 * our side, yet watch descriptor might have been killed by the kernel.  So
-	 * checking for an error causes false positives. */
-	(void)inotify_rm_watch(w->fd, w->wd);
+	if(wd != w->wd)
+	{
+		unsubscribe(w);
+		if(subscribe(w, wd) != 0)
+		{
+			return FSWS_ERRORED;
+		}
+	}
 
-	w->wd = wd;
 	return FSWS_REPLACED;
 }
 
@@ -362,6 +543,12 @@ fswatch_poll(fswatch_t *w)
 	return (changed ? FSWS_UPDATED : FSWS_UNCHANGED);
 }
 
+int
+fswatch_get_fd(void)
+{
+	return -1;
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
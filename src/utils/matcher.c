@@ -22,13 +22,15 @@
 
 #include <stddef.h> /* NULL */
 #include <stdlib.h> /* free() malloc() */
-#include <string.h> /* strcspn() strdup() strlen() strrchr() */
+#include <string.h> /* strchr() strcpy() strcspn() strdup() strlen()
+                              strrchr() */
 
 #include "../int/file_magic.h"
 #include "globs.h"
 #include "path.h"
 #include "regexp.h"
 #include "str.h"
+#include "string_array.h"
 #include "test_helpers.h"
 
 /* Type of a matcher. */
@@ -422,7 +424,9 @@ matcher_matches(const matcher_t *matcher, const char path[])
 static int
 fglobs_matches(const matcher_t *matcher, const char path[])
 {
-	char *globs = strdup(matcher->raw);
+	char globs[strlen(matcher->raw) + 1];
+	strcpy(globs, matcher->raw);
+
 	char *glob = globs, *state = NULL;
 	while((glob = split_and_get_dc(glob, &state)) != NULL)
 	{
@@ -470,7 +474,6 @@ fglobs_matches(const matcher_t *matcher, const char path[])
 			break;
 		}
 	}
-	free(globs);
 	return (glob != NULL)^matcher->negated;
 }
 
@@ -593,6 +596,44 @@ matcher_is_full_path(const matcher_t *matcher)
 	return matcher->full_path;
 }
 
+char **
+matcher_get_simple_globs(const matcher_t *matcher, int *count)
+{
+	*count = 0;
+
+	if(matcher->type != MT_GLOBS || !matcher->fglobs || matcher->negated ||
+			matcher->full_path)
+	{
+		return NULL;
+	}
+
+	char globs[strlen(matcher->raw) + 1];
+	strcpy(globs, matcher->raw);
+
+	char **list = NULL;
+	int len = 0;
+
+	char *glob = globs, *state = NULL;
+	while((glob = split_and_get_dc(glob, &state)) != NULL)
+	{
+		const char *const asterisk = until_first(glob, '*');
+		const int literal = (*asterisk == '\0');
+		const int suffix = (asterisk == glob && glob[1] == '.' &&
+				strchr(glob + 1, '*') == NULL);
+
+		if((!literal && !suffix) ||
+				add_to_string_array(&list, len, glob) != len + 1)
+		{
+			free_string_array(list, len);
+			return NULL;
+		}
+		++len;
+	}
+
+	*count = len;
+	return list;
+}
+
 TSTATIC int
 matcher_is_fast(const matcher_t *matcher)
 {
@@ -66,6 +66,12 @@ int matcher_includes(const matcher_t *matcher, const matcher_t *like);
  * otherwise zero is returned. */
 int matcher_is_full_path(const matcher_t *matcher);
 
+/* Retrieves patterns of a matcher that consists only of literal names and
+ * patterns of the form `*.suffix`, which can be matched by lookups instead of
+ * calling matcher_matches().  Returns list of *count patterns or NULL if the
+ * matcher is of a different kind or on error. */
+char ** matcher_get_simple_globs(const matcher_t *matcher, int *count);
+
 TSTATIC_DEFS(
 	int matcher_is_fast(const matcher_t *matcher);
 )
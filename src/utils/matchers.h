@@ -50,6 +50,11 @@ const char * matchers_get_expr(const matchers_t *matchers);
  * Returns non-zero if so, otherwise zero is returned. */
 int matchers_includes(const matchers_t *matchers, const matchers_t *like);
 
+/* Same as matcher_get_simple_globs(), but for a list of matchers, which must
+ * consist of a single matcher to qualify.  Returns list of *count patterns or
+ * NULL. */
+char ** matchers_get_simple_globs(const matchers_t *matchers, int *count);
+
 /* Checks whether given string is a list of match expressions.  Returns non-zero
  * if so, otherwise zero is returned. */
 int matchers_is_expr(const char str[]);
@@ -49,11 +49,16 @@ void selector_add(selector_t *selector, selector_item_t item);
 void selector_remove(selector_t *selector, selector_item_t item);
 
 /* Waits for at least one of watched objects to become available for reading
- * from during the period of time specified by the delay in milliseconds.
+ * from or for selector_wake() call during the period of time specified by the
+ * delay in milliseconds.  Negative delay means waiting without a timeout.
  * Returns zero on error or if timeout was reached without any of the objects
  * becoming available for read, otherwise non-zero is returned. */
 int selector_wait(selector_t *selector, int delay);
 
+/* Makes current or next invocation of selector_wait() return.  Can be called
+ * from any thread. */
+void selector_wake(selector_t *selector);
+
 /* Checks whether specified element is ready for read.  Use this function after
  * selector_wait().  Returns non-zero if so, otherwise zero is returned. */
 int selector_is_ready(selector_t *selector, selector_item_t item);
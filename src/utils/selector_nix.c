@@ -18,88 +18,344 @@
 
 #include "selector.h"
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h> /* EPOLL* epoll_* */
+#else
 #include <sys/select.h> /* FD_* fd_set select() */
+#endif
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h> /* EFD_* eventfd() */
+#endif
+#include <fcntl.h> /* FD_CLOEXEC F_* O_NONBLOCK fcntl() */
+#include <unistd.h> /* close() pipe() read() write() */
 
+#include <errno.h> /* EEXIST errno */
+#include <stddef.h> /* NULL size_t */
+#include <stdint.h> /* uint64_t */
 #include <stdlib.h> /* free() malloc() */
 #include <string.h> /* memcpy() */
 
+#include "darray.h"
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Maximum number of events retrieved by a single wait. */
+#define MAX_EVENTS 64
+
+/* Descriptor registered in epoll set. */
+typedef struct
+{
+	int fd;     /* The descriptor. */
+	int wanted; /* Whether it was added after the last reset. */
+}
+watched_fd_t;
+#endif
+
 /* Selector object. */
 struct selector_t
 {
+#ifdef HAVE_SYS_EPOLL_H
+	int epoll_fd;                         /* epoll instance or -1. */
+	struct epoll_event ready[MAX_EVENTS]; /* Events of the last wait. */
+	int nready;                           /* Number of elements in ready. */
+	watched_fd_t *watched;                /* Descriptors in the epoll set. */
+	DA_INSTANCE_FIELD(watched);           /* Enables use of DA_* on watched. */
+#else
 	fd_set set;   /* Set of selectors to check. */
 	fd_set ready; /* Set of ready selectors after successful check. */
 	int max_fd;   /* Maximal value among descriptors in the set. */
+#endif
+	int wake_rfd; /* Read end of wake up channel. */
+	int wake_wfd; /* Write end of wake up channel (can be equal to wake_rfd). */
 };
 
+static int open_wake_channel(selector_t *selector);
+#ifdef HAVE_SYS_EPOLL_H
+static watched_fd_t * find_watched(selector_t *selector, int fd);
+static void drop_unwanted(selector_t *selector);
+#endif
+static void drain_wake_channel(selector_t *selector);
+
 selector_t *
 selector_alloc(void)
 {
 	selector_t *selector = malloc(sizeof(*selector));
-	if(selector != NULL)
+	if(selector == NULL)
 	{
-		selector_reset(selector);
+		return NULL;
 	}
+
+	if(open_wake_channel(selector) != 0)
+	{
+		free(selector);
+		return NULL;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	/* The set is created once and then updated incrementally.  Failure to create
+	 * it is reported to the caller, which is better than returning from every
+	 * wait immediately. */
+	selector->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	selector->nready = 0;
+	selector->watched = NULL;
+	DA_SIZE(selector->watched) = 0U;
+
+	const int wake_fd = selector->wake_rfd;
+	struct epoll_event event = { .events = EPOLLIN, .data.fd = wake_fd };
+	if(selector->epoll_fd == -1 ||
+			epoll_ctl(selector->epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0)
+	{
+		selector_free(selector);
+		return NULL;
+	}
+#else
+	selector_reset(selector);
+#endif
 	return selector;
 }
 
+/* Creates objects for selector_wake().  Returns zero on success. */
+static int
+open_wake_channel(selector_t *selector)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+	selector->wake_rfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	selector->wake_wfd = selector->wake_rfd;
+	return (selector->wake_rfd == -1);
+#else
+	int fds[2];
+	if(pipe(fds) != 0)
+	{
+		return 1;
+	}
+
+	int i;
+	for(i = 0; i < 2; ++i)
+	{
+		(void)fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+		(void)fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+	}
+
+	selector->wake_rfd = fds[0];
+	selector->wake_wfd = fds[1];
+	return 0;
+#endif
+}
+
 void
 selector_free(selector_t *selector)
 {
+	if(selector == NULL)
+	{
+		return;
+	}
+
+#ifdef HAVE_SYS_EPOLL_H
+	if(selector->epoll_fd != -1)
+	{
+		close(selector->epoll_fd);
+	}
+	free(selector->watched);
+#endif
+	if(selector->wake_wfd != selector->wake_rfd)
+	{
+		close(selector->wake_wfd);
+	}
+	close(selector->wake_rfd);
 	free(selector);
 }
 
 void
 selector_reset(selector_t *selector)
 {
+#ifdef HAVE_SYS_EPOLL_H
+	/* Descriptors are removed from the set only if they aren't added back
+	 * before the next wait, which saves recreating the set on every use. */
+	size_t i;
+	for(i = 0U; i < DA_SIZE(selector->watched); ++i)
+	{
+		selector->watched[i].wanted = 0;
+	}
+	selector->nready = 0;
+#else
 	FD_ZERO(&selector->set);
 	FD_ZERO(&selector->ready);
 	selector->max_fd = -1;
+
+	selector_add(selector, selector->wake_rfd);
+#endif
 }
 
 void
 selector_add(selector_t *selector, selector_item_t item)
 {
+#ifdef HAVE_SYS_EPOLL_H
+	if(item == selector->wake_rfd)
+	{
+		return;
+	}
+
+	/* Adding is attempted even for known descriptors because a descriptor could
+	 * have been closed (which drops it from the set) and its number reused.
+	 * EEXIST means that the registration is still in place. */
+	struct epoll_event event = { .events = EPOLLIN, .data.fd = item };
+	if(epoll_ctl(selector->epoll_fd, EPOLL_CTL_ADD, item, &event) != 0 &&
+			errno != EEXIST)
+	{
+		return;
+	}
+
+	watched_fd_t *watched = find_watched(selector, item);
+	if(watched == NULL)
+	{
+		watched = DA_EXTEND(selector->watched);
+		if(watched == NULL)
+		{
+			(void)epoll_ctl(selector->epoll_fd, EPOLL_CTL_DEL, item, NULL);
+			return;
+		}
+
+		watched->fd = item;
+		DA_COMMIT(selector->watched);
+	}
+	watched->wanted = 1;
+#else
 	FD_SET(item, &selector->set);
 	if(item > selector->max_fd)
 	{
 		selector->max_fd = item;
 	}
+#endif
 }
 
 void
 selector_remove(selector_t *selector, selector_item_t item)
 {
+#ifdef HAVE_SYS_EPOLL_H
+	watched_fd_t *const watched = find_watched(selector, item);
+	if(watched != NULL)
+	{
+		(void)epoll_ctl(selector->epoll_fd, EPOLL_CTL_DEL, item, NULL);
+		DA_REMOVE(selector->watched, watched);
+	}
+#else
 	FD_CLR(item, &selector->set);
 	if(item == selector->max_fd)
 	{
 		/* Could do more here. */
 		--selector->max_fd;
 	}
+#endif
 }
 
 int
 selector_wait(selector_t *selector, int delay)
 {
-	if(delay < 0)
+#ifdef HAVE_SYS_EPOLL_H
+	drop_unwanted(selector);
+
+	int n = epoll_wait(selector->epoll_fd, selector->ready, MAX_EVENTS,
+			delay < 0 ? -1 : delay);
+	selector->nready = (n > 0 ? n : 0);
+	if(selector_is_ready(selector, selector->wake_rfd))
 	{
-		delay = 0;
+		drain_wake_channel(selector);
 	}
-
+	return (n > 0);
+#else
 	memcpy(&selector->ready, &selector->set, sizeof(selector->ready));
 
 	struct timeval ts = { .tv_sec = delay/1000, .tv_usec = (delay%1000)*1000 };
-	int r = (select(selector->max_fd + 1, &selector->ready, NULL, NULL, &ts) > 0);
+	int r = (select(selector->max_fd + 1, &selector->ready, NULL, NULL,
+				delay < 0 ? NULL : &ts) > 0);
 	if(!r)
 	{
 		FD_ZERO(&selector->ready);
 	}
+	else if(FD_ISSET(selector->wake_rfd, &selector->ready))
+	{
+		drain_wake_channel(selector);
+	}
 	return r;
+#endif
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* Looks up registered descriptor.  Returns pointer to its entry or NULL. */
+static watched_fd_t *
+find_watched(selector_t *selector, int fd)
+{
+	size_t i;
+	for(i = 0U; i < DA_SIZE(selector->watched); ++i)
+	{
+		if(selector->watched[i].fd == fd)
+		{
+			return &selector->watched[i];
+		}
+	}
+	return NULL;
+}
+
+/* Removes descriptors that weren't added since the last reset from the epoll
+ * set. */
+static void
+drop_unwanted(selector_t *selector)
+{
+	size_t i = 0U;
+	while(i < DA_SIZE(selector->watched))
+	{
+		watched_fd_t *const watched = &selector->watched[i];
+		if(watched->wanted)
+		{
+			++i;
+			continue;
+		}
+
+		/* This fails harmlessly if the descriptor was closed. */
+		(void)epoll_ctl(selector->epoll_fd, EPOLL_CTL_DEL, watched->fd, NULL);
+		DA_REMOVE(selector->watched, watched);
+	}
+}
+
+#endif
+
+/* Consumes pending wake up requests. */
+static void
+drain_wake_channel(selector_t *selector)
+{
+	uint64_t buf[8];
+	while(read(selector->wake_rfd, buf, sizeof(buf)) > 0)
+	{
+		/* Do nothing. */
+	}
+}
+
+void
+selector_wake(selector_t *selector)
+{
+	const uint64_t one = 1;
+	if(write(selector->wake_wfd, &one, sizeof(one)) != sizeof(one))
+	{
+		/* Failure means that there are enough pending requests already. */
+	}
 }
 
 int
 selector_is_ready(selector_t *selector, selector_item_t item)
 {
+#ifdef HAVE_SYS_EPOLL_H
+	int i;
+	for(i = 0; i < selector->nready; ++i)
+	{
+		if(selector->ready[i].data.fd == item)
+		{
+			return 1;
+		}
+	}
+	return 0;
+#else
 	return FD_ISSET(item, &selector->ready);
+#endif
 }
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
@@ -32,26 +32,40 @@ struct selector_t
 	int size;               /* Used amount of items. */
 	int capacity;           /* Reserved amount of items. */
 	selector_item_t ready;  /* Item that is ready to be read from or invalid. */
+	HANDLE wake_event;      /* Event for selector_wake(), first of items. */
 };
 
 selector_t *
 selector_alloc(void)
 {
 	selector_t *selector = malloc(sizeof(*selector));
-	if(selector != NULL)
+	if(selector == NULL)
 	{
-		selector->items = NULL;
-		selector->capacity = 0;
-		selector_reset(selector);
+		return NULL;
 	}
+
+	selector->wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	if(selector->wake_event == NULL)
+	{
+		free(selector);
+		return NULL;
+	}
+
+	selector->items = NULL;
+	selector->capacity = 0;
+	selector_reset(selector);
 	return selector;
 }
 
 void
 selector_free(selector_t *selector)
 {
-	free(selector->items);
-	free(selector);
+	if(selector != NULL)
+	{
+		CloseHandle(selector->wake_event);
+		free(selector->items);
+		free(selector);
+	}
 }
 
 void
@@ -59,6 +73,7 @@ selector_reset(selector_t *selector)
 {
 	selector->size = 0;
 	selector->ready = INVALID_HANDLE_VALUE;
+	selector_add(selector, selector->wake_event);
 }
 
 void
@@ -107,22 +122,29 @@ selector_remove(selector_t *selector, selector_item_t item)
 int
 selector_wait(selector_t *selector, int delay)
 {
-	if(delay < 0)
-	{
-		delay = 0;
-	}
-
-	DWORD res = WaitForMultipleObjects(selector->size, selector->items, 0, delay);
+	DWORD res = WaitForMultipleObjects(selector->size, selector->items, 0,
+			delay < 0 ? INFINITE : (DWORD)delay);
 	if(res < WAIT_OBJECT_0 || res >= WAIT_OBJECT_0 + selector->size)
 	{
 		selector->ready = INVALID_HANDLE_VALUE;
 		return 0;
 	}
 
+	/* The event resets itself after a successful wait. */
 	selector->ready = selector->items[res - WAIT_OBJECT_0];
+	if(selector->ready == selector->wake_event)
+	{
+		selector->ready = INVALID_HANDLE_VALUE;
+	}
 	return 1;
 }
 
+void
+selector_wake(selector_t *selector)
+{
+	(void)SetEvent(selector->wake_event);
+}
+
 int
 selector_is_ready(selector_t *selector, selector_item_t item)
 {
@@ -24,14 +24,16 @@
 
 #include <assert.h> /* assert() */
 #include <stddef.h> /* size_t wchar_t */
+#include <stdint.h> /* UINT64_C uint64_t */
 #include <stdlib.h> /* malloc() */
-#include <string.h> /* strlen() */
+#include <string.h> /* memcpy() strlen() strnlen() */
 
 #include "../compat/reallocarray.h"
 #include "macros.h"
 #include "utils.h"
 
 static size_t guess_char_width(char c);
+static size_t ascii_prefix_len(const char str[], size_t len);
 static wchar_t utf8_char_to_wchar(const char str[], size_t char_width);
 static size_t chrsw(const char str[], size_t char_width);
 
@@ -64,13 +66,57 @@ guess_char_width(char c)
 	return 1;
 }
 
+/* Computes length of the longest prefix of a string that consists of ASCII
+ * characters occupying single byte and single screen cell each (that's
+ * [0x20; 0x7f] range).  len is length of the string.  Returns the length. */
+static size_t
+ascii_prefix_len(const char str[], size_t len)
+{
+	const uint64_t spaces = UINT64_C(0x2020202020202020);
+	const uint64_t high_bits = UINT64_C(0x8080808080808080);
+
+	/* Check eight bytes at a time.  A high bit is set in the result of
+	 * subtraction for bytes less than 0x20 and in the word itself for bytes
+	 * starting with 0x80. */
+	size_t i = 0;
+	while(i + sizeof(uint64_t) <= len)
+	{
+		uint64_t word;
+		memcpy(&word, str + i, sizeof(word));
+		if(((word | (word - spaces)) & high_bits) != 0)
+		{
+			break;
+		}
+		i += sizeof(word);
+	}
+
+	while(i < len && (unsigned char)str[i] >= 0x20 &&
+			(unsigned char)str[i] < 0x80)
+	{
+		++i;
+	}
+
+	return i;
+}
+
 size_t
 utf8_strsnlen(const char str[], size_t max_screen_width)
 {
+	const char *const end = str + strlen(str);
 	size_t width = 0;
 
 	while(*str != '\0' && max_screen_width != 0)
 	{
+		const size_t ascii = MIN(ascii_prefix_len(str, end - str),
+				max_screen_width);
+		if(ascii != 0)
+		{
+			max_screen_width -= ascii;
+			width += ascii;
+			str += ascii;
+			continue;
+		}
+
 		size_t char_width = utf8_chrw(str);
 		size_t char_screen_width = chrsw(str, char_width);
 		if(char_screen_width > max_screen_width)
@@ -122,6 +168,17 @@ utf8_nstrsnlen(const char str[], size_t max_screen_width)
 	/* The loop includes composite characters. */
 	while(length_left != 0)
 	{
+		const size_t ascii = MIN(ascii_prefix_len(str, length_left),
+				max_screen_width);
+		if(ascii != 0)
+		{
+			length += ascii;
+			max_screen_width -= ascii;
+			str += ascii;
+			length_left -= ascii;
+			continue;
+		}
+
 		size_t char_screen_width;
 		const size_t char_width = utf8_chrw(str);
 		if(char_width > length_left)
@@ -168,9 +225,18 @@ utf8_char_to_wchar(const char str[], size_t char_width)
 size_t
 utf8_strsw(const char str[])
 {
+	const char *const end = str + strlen(str);
 	size_t length = 0;
 	while(*str != '\0')
 	{
+		const size_t ascii = ascii_prefix_len(str, end - str);
+		length += ascii;
+		str += ascii;
+		if(*str == '\0')
+		{
+			break;
+		}
+
 		const size_t char_width = utf8_chrw(str);
 		const size_t char_screen_width = chrsw(str, char_width);
 		str += char_width;
@@ -182,10 +248,19 @@ utf8_strsw(const char str[])
 size_t
 utf8_nstrsw(const char str[], int len)
 {
+	const char *const end = str + strnlen(str, MAX(len, 0));
 	size_t sw = 0;
 	const char *p = str;
 	while(*p != '\0' && p - str < len)
 	{
+		const size_t ascii = ascii_prefix_len(p, end - p);
+		if(ascii != 0)
+		{
+			sw += ascii;
+			p += ascii;
+			continue;
+		}
+
 		const size_t char_width = utf8_chrw(p);
 		const size_t char_screen_width = chrsw(p, char_width);
 		p += char_width;
@@ -201,8 +276,17 @@ utf8_strsw_with_tabs(const char str[], int tab_stops)
 
 	assert(tab_stops > 0 && "Non-positive number of tab stops.");
 
+	const char *const end = str + strlen(str);
 	while(*str != '\0')
 	{
+		const size_t ascii = ascii_prefix_len(str, end - str);
+		if(ascii != 0)
+		{
+			length += ascii;
+			str += ascii;
+			continue;
+		}
+
 		size_t char_screen_width;
 		const size_t char_width = utf8_chrw(str);
 
@@ -239,9 +323,17 @@ chrsw(const char str[], size_t char_width)
 size_t
 utf8_stro(const char str[])
 {
+	const char *const end = str + strlen(str);
 	size_t overhead = 0;
 	while(*str != '\0')
 	{
+		/* ASCII characters have no overhead. */
+		str += ascii_prefix_len(str, end - str);
+		if(*str == '\0')
+		{
+			break;
+		}
+
 		size_t char_width = utf8_chrw(str);
 		str += char_width;
 		overhead += char_width - 1;
@@ -252,9 +344,17 @@ utf8_stro(const char str[])
 size_t
 utf8_strso(const char str[])
 {
+	const char *const end = str + strlen(str);
 	size_t overhead = 0;
 	while(*str != '\0')
 	{
+		/* ASCII characters have no overhead. */
+		str += ascii_prefix_len(str, end - str);
+		if(*str == '\0')
+		{
+			break;
+		}
+
 		const size_t char_width = utf8_chrw(str);
 		const size_t char_screen_width = chrsw(str, char_width);
 		str += char_width;
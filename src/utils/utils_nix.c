@@ -57,7 +57,6 @@
 #include "../compat/mntent.h" /* mntent setmntent() getmntent() endmntent() */
 #include "../compat/os.h"
 #include "../compat/reallocarray.h"
-#include "../ui/tabs.h"
 #include "../ui/ui.h"
 #include "../filelist.h"
 #include "../running.h"
@@ -66,7 +65,6 @@
 #include "env.h"
 #include "filemon.h"
 #include "fs.h"
-#include "fswatch.h"
 #include "log.h"
 #include "macros.h"
 #include "path.h"
@@ -317,17 +315,9 @@ prepare_for_exec(void)
 		(void)fclose(curr_stats.original_stdout);
 	}
 
-	/* More generic cleanup functions aren't called here to do not waste time on
-	 * freeing resources which will be replaced by exec(). */
-	tab_info_t tab_info;
-	int i;
-	for(i = 0; tabs_enum_all(i, &tab_info); ++i)
-	{
-		view_t *view = tab_info.view;
-		fswatch_free(view->watch);
-		fswatch_free(view->left_column.watch);
-		fswatch_free(view->right_column.watch);
-	}
+	/* File-system watchers aren't freed here because they share inotify instance
+	 * with the parent process and freeing them would remove parent's watches.
+	 * The instance is closed on exec() anyway. */
 }
 
 char *
@@ -159,6 +159,20 @@ vcache_check(vcache_is_previewed_cb is_previewed)
 	return changed;
 }
 
+int
+vcache_has_jobs(void)
+{
+	size_t i;
+	for(i = 0U; i < DA_SIZE(cache); ++i)
+	{
+		if(cache[i]->job != NULL)
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
 strlist_t
 vcache_lookup(const char full_path[], const char viewer[], MacroFlags flags,
 		ViewerKind kind, int max_lines, int sync, const char **error)
@@ -53,6 +53,10 @@ size_t vcache_size(void);
  * be updated, otherwise zero is returned. */
 int vcache_check(vcache_is_previewed_cb is_previewed);
 
+/* Checks whether there are asynchronous viewers whose output is still being
+ * collected.  Returns non-zero if so, otherwise zero is returned. */
+int vcache_has_jobs(void);
+
 /* Looks up cached output of a viewer command (no macro expansion is performed)
  * or produces and caches it.  *error is set either to NULL or an error code on
  * failure.  Returns list of strings owned and managed by the unit, don't store
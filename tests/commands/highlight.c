@@ -15,6 +15,8 @@
 #include "../../src/filelist.h"
 #include "../../src/status.h"
 
+static int get_file_hi(const char path[]);
+
 SETUP_ONCE()
 {
 	cmds_init();
@@ -516,6 +518,63 @@ TEST(can_color_uncolored_file)
 	curr_stats.load_stage = 0;
 }
 
+TEST(file_highlights_are_tried_in_order)
+{
+	assert_success(cmds_dispatch("highlight /^a/ cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.jpg,*.png} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight /jpg/ cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.tar.gz,README} cterm=bold",
+				&lwin, CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.gz} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	assert_int_equal(0, get_file_hi("/path/a.jpg"));
+	assert_int_equal(1, get_file_hi("/path/b.jpg"));
+	assert_int_equal(1, get_file_hi("/path/b.PNG"));
+	assert_int_equal(2, get_file_hi("/path/jpg"));
+	assert_int_equal(2, get_file_hi("/path/.jpg"));
+	assert_int_equal(3, get_file_hi("/path/b.tar.gz"));
+	assert_int_equal(3, get_file_hi("/path/readme"));
+	assert_int_equal(4, get_file_hi("/path/b.gz"));
+	assert_int_equal(INT_MAX, get_file_hi("/path/.gz"));
+	assert_int_equal(INT_MAX, get_file_hi("/path/.b.gz"));
+	assert_int_equal(INT_MAX, get_file_hi("/path/b.gz/"));
+	assert_int_equal(INT_MAX, get_file_hi("/path/README/"));
+}
+
+TEST(file_highlights_lookup_is_updated_on_removal)
+{
+	assert_success(cmds_dispatch("highlight {*.jpg} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_success(cmds_dispatch("highlight {*.jpg,*.png} cterm=bold", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(0, get_file_hi("/path/b.jpg"));
+
+	assert_success(cmds_dispatch("highlight clear {*.jpg}", &lwin,
+				CIT_COMMAND));
+	assert_int_equal(0, get_file_hi("/path/b.jpg"));
+	assert_int_equal(0, get_file_hi("/path/b.png"));
+}
+
+TEST(file_highlights_lookup_is_copied)
+{
+	assert_success(cmds_dispatch("highlight {*.jpg} cterm=bold", &lwin,
+				CIT_COMMAND));
+
+	col_scheme_t cs = { };
+	cs_assign(&cs, &cfg.cs);
+	cs_reset(&cfg.cs);
+
+	int hi_hint = -1;
+	assert_non_null(cs_get_file_hi(&cs, "/path/b.jpg", &hi_hint));
+	assert_int_equal(0, hi_hint);
+
+	cs_reset(&cs);
+}
+
 TEST(tabs_are_allowed)
 {
 	const char *const COMMANDS1 = "highlight\t{*.jpg} ctermfg=red\tctermbg=blue";
@@ -546,5 +605,14 @@ TEST(tabs_are_allowed)
 	}
 }
 
+/* Looks up file highlight for the path.  Returns its index or INT_MAX. */
+static int
+get_file_hi(const char path[])
+{
+	int hi_hint = -1;
+	(void)cs_get_file_hi(&cfg.cs, path, &hi_hint);
+	return hi_hint;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -32,5 +32,11 @@ TEST(many_esc_overhead_correct)
 	assert_int_equal(21, esc_str_overhead(input));
 }
 
+TEST(long_text_between_esc_overhead_correct)
+{
+	const char *const input = "abcdefghijk\033[1mмнопрстуфх\033[0m";
+	assert_int_equal(8, esc_str_overhead(input));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
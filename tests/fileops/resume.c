@@ -0,0 +1,275 @@
+#include <stic.h>
+
+#include <unistd.h> /* chdir() */
+
+#include <stddef.h> /* NULL */
+#include <stdio.h> /* snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
+#include "../../src/utils/path.h"
+#include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
+#include "../../src/filelist.h"
+#include "../../src/fops_cpmv.h"
+#include "../../src/journal.h"
+
+static journal_t * make_journal(int move, JournalConflict conflict,
+		const char *src[], const char *dst[], int count);
+static char * resume_single(void);
+static int count_journals(void);
+
+static char *saved_cwd;
+static char sandbox[PATH_MAX + 1];
+
+SETUP()
+{
+	saved_cwd = save_cwd();
+	assert_success(chdir(SANDBOX_PATH));
+	make_abs_path(sandbox, sizeof(sandbox), SANDBOX_PATH, "", saved_cwd);
+	make_abs_path(cfg.journal_dir, sizeof(cfg.journal_dir), SANDBOX_PATH,
+			"journal", saved_cwd);
+}
+
+TEARDOWN()
+{
+	remove_dir("journal");
+	cfg.journal_dir[0] = '\0';
+	restore_cwd(saved_cwd);
+}
+
+TEST(journal_of_running_operation_is_not_listed)
+{
+	const char *src[] = { "/src" };
+	const char *dst[] = { "/dst" };
+	journal_t *journal = make_journal(/*move=*/0, JC_FAIL, src, dst, 1);
+	assert_non_null(journal);
+
+	assert_int_equal(0, count_journals());
+	assert_null(journal_read(journal->path));
+
+	journal_finish(journal);
+	assert_int_equal(0, count_journals());
+}
+
+TEST(journal_of_interrupted_operation_is_read_back)
+{
+	const char *src[] = { "/src1", "/src2", "/src3" };
+	const char *dst[] = { "/dst1", "/dst2", "/dst3" };
+	journal_t *journal = make_journal(/*move=*/1, JC_SKIP, src, dst, 3);
+	assert_non_null(journal);
+	journal_item_started(journal, 0);
+	journal_item_done(journal, 0);
+	journal_item_started(journal, 1);
+
+	char *path = strdup(journal->path);
+	journal_free(journal);
+
+	journal = journal_read(path);
+	assert_non_null(journal);
+	if(journal != NULL)
+	{
+		assert_string_equal("descr", journal->descr);
+		assert_true(journal->move);
+		assert_int_equal(JC_SKIP, journal->conflict);
+		assert_int_equal(3, journal->count);
+		assert_string_equal("/src2", journal->src[1]);
+		assert_string_equal("/dst3", journal->dst[2]);
+		assert_int_equal(JIS_DONE, journal->state[0]);
+		assert_int_equal(JIS_STARTED, journal->state[1]);
+		assert_int_equal(JIS_PENDING, journal->state[2]);
+		journal_free(journal);
+	}
+
+	assert_int_equal(1, count_journals());
+	assert_success(journal_discard(path));
+	assert_int_equal(0, count_journals());
+
+	free(path);
+}
+
+TEST(partially_copied_file_is_completed)
+{
+	char src[PATH_MAX + 1], dst[PATH_MAX + 1];
+	snprintf(src, sizeof(src), "%s/src", sandbox);
+	snprintf(dst, sizeof(dst), "%s/dst", sandbox);
+	make_file(src, "first line\nsecond line\n");
+	make_file(dst, "first line\n");
+
+	const char *srcs[] = { src };
+	const char *dsts[] = { dst };
+	journal_t *journal = make_journal(/*move=*/0, JC_FAIL, srcs, dsts, 1);
+	assert_non_null(journal);
+	journal_item_started(journal, 0);
+	journal_free(journal);
+
+	char *path = resume_single();
+	assert_false(path_exists(path, NODEREF));
+	free(path);
+
+	const char *lines[] = { "first line", "second line" };
+	file_is(dst, lines, ARRAY_LEN(lines));
+
+	remove_file(src);
+	remove_file(dst);
+}
+
+TEST(processed_and_conflicting_items_are_skipped)
+{
+	char src[3][PATH_MAX + 1], dst[3][PATH_MAX + 1];
+	const char *srcs[3], *dsts[3];
+	int i;
+	for(i = 0; i < 3; ++i)
+	{
+		snprintf(src[i], sizeof(src[i]), "%s/src%d", sandbox, i);
+		snprintf(dst[i], sizeof(dst[i]), "%s/dst%d", sandbox, i);
+		make_file(src[i], "source\n");
+		srcs[i] = src[i];
+		dsts[i] = dst[i];
+	}
+	make_file(dst[1], "destination\n");
+
+	journal_t *journal = make_journal(/*move=*/0, JC_SKIP, srcs, dsts, 3);
+	assert_non_null(journal);
+	journal_item_started(journal, 0);
+	journal_item_done(journal, 0);
+	journal_free(journal);
+
+	free(resume_single());
+
+	const char *src_lines[] = { "source" };
+	const char *dst_lines[] = { "destination" };
+	assert_false(path_exists(dst[0], NODEREF));
+	file_is(dst[1], dst_lines, ARRAY_LEN(dst_lines));
+	file_is(dst[2], src_lines, ARRAY_LEN(src_lines));
+
+	for(i = 0; i < 3; ++i)
+	{
+		remove_file(src[i]);
+	}
+	remove_file(dst[1]);
+	remove_file(dst[2]);
+}
+
+TEST(partially_moved_directory_is_completed)
+{
+	char src[PATH_MAX + 1], dst[PATH_MAX + 1];
+	snprintf(src, sizeof(src), "%s/src", sandbox);
+	snprintf(dst, sizeof(dst), "%s/dst", sandbox);
+
+	create_dir("src");
+	create_dir("src/sub");
+	make_file("src/done", "done\n");
+	make_file("src/sub/partial", "a\nb\n");
+	make_file("src/sub/missing", "missing\n");
+	create_dir("dst");
+	create_dir("dst/sub");
+	make_file("dst/done", "done\n");
+	make_file("dst/sub/partial", "a\n");
+
+	const char *srcs[] = { src };
+	const char *dsts[] = { dst };
+	journal_t *journal = make_journal(/*move=*/1, JC_FAIL, srcs, dsts, 1);
+	assert_non_null(journal);
+	journal_item_started(journal, 0);
+	journal_free(journal);
+
+	free(resume_single());
+
+	const char *done_lines[] = { "done" };
+	const char *partial_lines[] = { "a", "b" };
+	const char *missing_lines[] = { "missing" };
+	assert_false(path_exists("src", NODEREF));
+	file_is("dst/done", done_lines, ARRAY_LEN(done_lines));
+	file_is("dst/sub/partial", partial_lines, ARRAY_LEN(partial_lines));
+	file_is("dst/sub/missing", missing_lines, ARRAY_LEN(missing_lines));
+
+	remove_file("dst/done");
+	remove_file("dst/sub/partial");
+	remove_file("dst/sub/missing");
+	remove_dir("dst/sub");
+	remove_dir("dst");
+}
+
+TEST(finished_operation_leaves_no_journal)
+{
+	view_setup(&lwin);
+	copy_str(lwin.curr_dir, sizeof(lwin.curr_dir), sandbox);
+	lwin.list_rows = 1;
+	lwin.list_pos = 0;
+	lwin.dir_entry = dynarray_cextend(NULL,
+			lwin.list_rows*sizeof(*lwin.dir_entry));
+	lwin.dir_entry[0].name = strdup("file");
+	lwin.dir_entry[0].origin = &lwin.curr_dir[0];
+	lwin.dir_entry[0].marked = 1;
+
+	view_setup(&rwin);
+	snprintf(rwin.curr_dir, sizeof(rwin.curr_dir), "%s/dst", sandbox);
+
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	create_file("file");
+	create_dir("dst");
+
+	(void)fops_cpmv_bg(&lwin, NULL, 0, /*move=*/0, CMLF_NONE);
+	wait_for_bg();
+
+	assert_true(path_exists("dst/file", NODEREF));
+	assert_true(is_dir_empty("journal"));
+
+	remove_file("file");
+	remove_file("dst/file");
+	remove_dir("dst");
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+/* Creates journal with a fixed description. */
+static journal_t *
+make_journal(int move, JournalConflict conflict, const char *src[],
+		const char *dst[], int count)
+{
+	return journal_create("descr", move, conflict, (char **)src, (char **)dst,
+			count);
+}
+
+/* Resumes the only interrupted operation and waits for it to finish.  Returns
+ * path to its journal. */
+static char *
+resume_single(void)
+{
+	int njournals;
+	char **journals = journal_list(&njournals);
+	assert_int_equal(1, njournals);
+
+	char *path = strdup(journals[0]);
+	free_string_array(journals, njournals);
+
+	assert_success(fops_resume(path));
+	wait_for_bg();
+
+	assert_int_equal(0, count_journals());
+	return path;
+}
+
+/* Counts journals of interrupted operations.  Returns the number. */
+static int
+count_journals(void)
+{
+	int njournals;
+	char **journals = journal_list(&njournals);
+	free_string_array(journals, njournals);
+	return njournals;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
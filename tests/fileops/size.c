@@ -11,14 +11,18 @@
 #include "../../src/cfg/config.h"
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/utils/cancellation.h"
 #include "../../src/utils/dynarray.h"
 #include "../../src/utils/fs.h"
+#include "../../src/dcache_watch.h"
 #include "../../src/filelist.h"
 #include "../../src/fops_misc.h"
 #include "../../src/status.h"
 
 static void setup_single_entry(view_t *view, const char name[]);
 static uint64_t wait_for_size(const char path[]);
+static uint64_t cached_size(const char path[]);
+static int cancel_hook(void *arg);
 
 SETUP()
 {
@@ -129,6 +133,116 @@ TEST(symlinks_to_dirs, IF(not_windows))
 	assert_success(rmdir(SANDBOX_PATH "/dir"));
 }
 
+TEST(sizes_of_all_subdirectories_are_cached, IF(not_windows))
+{
+	char path[PATH_MAX + 1];
+	int i, j;
+
+	create_dir(SANDBOX_PATH "/dir");
+	for(i = 0; i < 10; ++i)
+	{
+		snprintf(path, sizeof(path), "%s/dir/%d", SANDBOX_PATH, i);
+		create_dir(path);
+		for(j = 0; j < 3; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/dir/%d/%d", SANDBOX_PATH, i, j);
+			create_dir(path);
+			snprintf(path, sizeof(path), "%s/dir/%d/%d/file", SANDBOX_PATH, i, j);
+			make_file(path, "12345");
+		}
+	}
+
+	assert_ulong_equal(10*3*5,
+			fops_dir_size(SANDBOX_PATH "/dir", 0, &no_cancellation));
+	assert_ulong_equal(10*3*5, cached_size(SANDBOX_PATH "/dir"));
+	assert_ulong_equal(3*5, cached_size(SANDBOX_PATH "/dir/7"));
+	assert_ulong_equal(5, cached_size(SANDBOX_PATH "/dir/7/2"));
+
+	/* Cached values of subdirectories are used. */
+	struct stat st;
+	assert_success(os_stat(SANDBOX_PATH "/dir/7", &st));
+	stats_reset(&cfg);
+	dcache_set_at(SANDBOX_PATH "/dir/7", st.st_ino, 1000, DCACHE_UNKNOWN);
+	dcache_set_size_timestamp(SANDBOX_PATH "/dir/7", time(NULL) + 10);
+	assert_ulong_equal(9*3*5 + 1000,
+			fops_dir_size(SANDBOX_PATH "/dir", 0, &no_cancellation));
+
+	for(i = 0; i < 10; ++i)
+	{
+		for(j = 0; j < 3; ++j)
+		{
+			snprintf(path, sizeof(path), "%s/dir/%d/%d/file", SANDBOX_PATH, i, j);
+			remove_file(path);
+			snprintf(path, sizeof(path), "%s/dir/%d/%d", SANDBOX_PATH, i, j);
+			remove_dir(path);
+		}
+		snprintf(path, sizeof(path), "%s/dir/%d", SANDBOX_PATH, i);
+		remove_dir(path);
+	}
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(cancelled_calculation_is_not_cached, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	make_file(SANDBOX_PATH "/dir/sub/file", "12345");
+
+	const cancellation_t cancellation = { .hook = &cancel_hook };
+	assert_ulong_equal(0, fops_dir_size(SANDBOX_PATH "/dir", 0, &cancellation));
+	assert_ulong_equal(DCACHE_UNKNOWN, cached_size(SANDBOX_PATH "/dir"));
+
+	remove_file(SANDBOX_PATH "/dir/sub/file");
+	remove_dir(SANDBOX_PATH "/dir/sub");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+#ifdef HAVE_INOTIFY
+
+TEST(change_of_watched_directory_updates_sizes)
+{
+	cfg.dir_size_watch = 10;
+
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	make_file(SANDBOX_PATH "/dir/sub/file", "12345");
+
+	assert_ulong_equal(5,
+			fops_dir_size(SANDBOX_PATH "/dir", 0, &no_cancellation));
+
+	make_file(SANDBOX_PATH "/dir/sub/file2", "12");
+	dcache_watch_check();
+	assert_ulong_equal(7, wait_for_size(SANDBOX_PATH "/dir"));
+	assert_ulong_equal(7, cached_size(SANDBOX_PATH "/dir/sub"));
+
+	dcache_watch_reset();
+	cfg.dir_size_watch = 0;
+
+	remove_file(SANDBOX_PATH "/dir/sub/file2");
+	remove_file(SANDBOX_PATH "/dir/sub/file");
+	remove_dir(SANDBOX_PATH "/dir/sub");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(directories_are_not_watched_by_default)
+{
+	create_dir(SANDBOX_PATH "/dir");
+	make_file(SANDBOX_PATH "/dir/file", "12345");
+
+	assert_ulong_equal(5,
+			fops_dir_size(SANDBOX_PATH "/dir", 0, &no_cancellation));
+
+	make_file(SANDBOX_PATH "/dir/file2", "12");
+	dcache_watch_check();
+	assert_ulong_equal(5, wait_for_size(SANDBOX_PATH "/dir"));
+
+	remove_file(SANDBOX_PATH "/dir/file2");
+	remove_file(SANDBOX_PATH "/dir/file");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
+#endif
+
 static void
 setup_single_entry(view_t *view, const char name[])
 {
@@ -145,7 +259,13 @@ static uint64_t
 wait_for_size(const char path[])
 {
 	wait_for_bg();
+	return cached_size(path);
+}
 
+/* Retrieves cached size of a directory.  Returns the size or DCACHE_UNKNOWN. */
+static uint64_t
+cached_size(const char path[])
+{
 	time_t mtime = 10;
 	uint64_t inode = DCACHE_UNKNOWN;
 #ifndef _WIN32
@@ -161,5 +281,11 @@ wait_for_size(const char path[])
 	return size;
 }
 
+static int
+cancel_hook(void *arg)
+{
+	return 1;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -1,11 +1,17 @@
 #include <stic.h>
 
+#include <unistd.h> /* link() */
+
 #include <stddef.h> /* NULL */
 
+#include <test-utils.h>
+
 #include "../../src/io/private/ioeta.h"
 #include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 
+static void wait_for_estimation(ioeta_estim_t *estim);
+
 static const io_cancellation_t no_cancellation;
 
 TEST(non_existent_path_yields_zero_size)
@@ -64,6 +70,61 @@ TEST(shallow_estimation_does_not_recur)
 	ioeta_free(estim);
 }
 
+TEST(background_estimation_yields_same_results)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/various-sizes", 0);
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/existing-files", 0);
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/various-sizes", 1);
+	wait_for_estimation(estim);
+
+	assert_int_equal(7 + 3 + 1, estim->total_items);
+	assert_int_equal(0, estim->current_item);
+	assert_int_equal(73728, estim->total_bytes);
+	assert_int_equal(0, estim->current_byte);
+
+	ioeta_free(estim);
+}
+
+TEST(background_estimation_can_be_restarted)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/various-sizes", 0);
+	wait_for_estimation(estim);
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/various-sizes", 0);
+	wait_for_estimation(estim);
+
+	assert_int_equal(14, estim->total_items);
+	assert_int_equal(2*73728, estim->total_bytes);
+
+	ioeta_free(estim);
+}
+
+TEST(restoring_state_keeps_totals_of_background_estimation)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_estim_t save = ioeta_save(estim);
+	ioeta_calculate_bg(estim, TEST_DATA_PATH "/various-sizes", 0);
+	wait_for_estimation(estim);
+	ioeta_restore(estim, &save);
+	ioeta_release(&save);
+
+	assert_int_equal(7, estim->total_items);
+	assert_int_equal(73728, estim->total_bytes);
+
+	ioeta_free(estim);
+}
+
+TEST(unfinished_estimation_can_be_freed)
+{
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+	ioeta_calculate_bg(estim, TEST_DATA_PATH, 0);
+	ioeta_free(estim);
+}
+
 #ifndef _WIN32
 
 TEST(symlink_calculated_as_zero_bytes)
@@ -95,7 +156,42 @@ TEST(symlink_calculated_as_zero_bytes)
 	ioeta_free(estim);
 }
 
+TEST(hard_links_are_counted_once)
+{
+	create_dir(SANDBOX_PATH "/dir");
+	make_file(SANDBOX_PATH "/dir/a", "12345");
+	assert_success(link(SANDBOX_PATH "/dir/a", SANDBOX_PATH "/dir/b"));
+
+	ioeta_estim_t *const estim = ioeta_alloc(NULL, no_cancellation);
+
+	ioeta_calculate(estim, SANDBOX_PATH "/dir", 0);
+	assert_int_equal(2, estim->total_items);
+	assert_int_equal(5, estim->total_bytes);
+
+	ioeta_calculate_bg(estim, SANDBOX_PATH "/dir", 0);
+	wait_for_estimation(estim);
+	assert_int_equal(4, estim->total_items);
+	assert_int_equal(10, estim->total_bytes);
+
+	ioeta_free(estim);
+
+	remove_file(SANDBOX_PATH "/dir/a");
+	remove_file(SANDBOX_PATH "/dir/b");
+	remove_dir(SANDBOX_PATH "/dir");
+}
+
 #endif
 
+/* Waits until background estimation is over. */
+static void
+wait_for_estimation(ioeta_estim_t *estim)
+{
+	do
+	{
+		ioeta_sync(estim);
+	}
+	while(estim->estimating);
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
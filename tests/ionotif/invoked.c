@@ -3,6 +3,10 @@
 #include <sys/stat.h> /* chmod() */
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* FILE fclose() fopen() fwrite() */
+#include <string.h> /* memset() */
+
+#include <test-utils.h>
 
 #include "../../src/io/ioeta.h"
 #include "../../src/io/ionotif.h"
@@ -13,6 +17,7 @@ static void progress_changed(const io_progress_t *progress);
 
 static int invoked_eta;
 static int invoked_progress;
+static int invoked_within_file;
 
 static ioeta_estim_t *estim;
 
@@ -23,6 +28,7 @@ SETUP()
 
 	invoked_eta = 0;
 	invoked_progress = 0;
+	invoked_within_file = 0;
 
 	ionotif_register(&progress_changed);
 }
@@ -44,6 +50,11 @@ progress_changed(const io_progress_t *progress)
 			break;
 		case IO_PS_IN_PROGRESS:
 			++invoked_progress;
+			if(progress->estim->current_byte != 0U &&
+					progress->estim->current_byte < progress->estim->total_bytes)
+			{
+				++invoked_within_file;
+			}
 			break;
 	}
 }
@@ -160,5 +171,44 @@ TEST(rm_dir_invokes_ionotif)
 	assert_true(invoked_progress >= 1);
 }
 
+TEST(parallel_cp_reports_progress_within_files)
+{
+	enum { SIZE = 3*1024*1024 };
+	static char block[SIZE];
+	memset(block, 'x', sizeof(block));
+
+	create_dir(SANDBOX_PATH "/dir");
+	FILE *const fp = fopen(SANDBOX_PATH "/dir/large", "wb");
+	assert_non_null(fp);
+	assert_int_equal(1, fwrite(block, sizeof(block), 1, fp));
+	assert_success(fclose(fp));
+
+	ioeta_calculate(estim, SANDBOX_PATH "/dir", 0);
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/dir",
+			.arg2.dst = SANDBOX_PATH "/dir-copy",
+			.arg4.parallel_jobs = 2,
+
+			.estim = estim,
+		};
+		assert_int_equal(IO_RES_SUCCEEDED, ior_cp(&args));
+	}
+
+	assert_true(invoked_within_file >= 1);
+	assert_ulong_equal(SIZE, estim->current_byte);
+	assert_null(estim->lock);
+
+	{
+		io_args_t args = { .arg1.path = SANDBOX_PATH "/dir" };
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+	}
+	{
+		io_args_t args = { .arg1.path = SANDBOX_PATH "/dir-copy" };
+		assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -6,21 +6,31 @@
 #endif
 #include <sys/stat.h> /* chmod() stat */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* _Exit() lstat() */
+#include <fcntl.h> /* O_CREAT O_RDONLY O_WRONLY open() */
+#include <unistd.h> /* _Exit() close() ftruncate() lstat() pread() pwrite()
+                       write() */
 
+#include <errno.h> /* EIO */
 #include <signal.h> /* SIGXFSZ SIG_IGN signal() */
+#include <stdio.h> /* remove() */
 #include <stdlib.h> /* EXIT_FAILURE EXIT_SUCCESS */
+#include <string.h> /* memcmp() memset() */
 
 #include <test-utils.h>
 
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/iop.h"
 #include "../../src/utils/fs.h"
 
 #include "utils.h"
 
 static void file_is_copied(const char original[]);
+#ifndef _WIN32
+static void create_file_of_size(const char path[], int size);
+static int corrupt_complete_copy(void *arg);
+#endif
 
 TEST(dir_is_not_copied)
 {
@@ -156,6 +166,54 @@ TEST(double_block_size_plus_one_file_is_copied)
 			"/various-sizes/double-block-size-plus-one-file");
 }
 
+TEST(copying_reports_progress)
+{
+	const io_cancellation_t no_cancellation = {};
+	const char *const original = TEST_DATA_PATH
+		"/various-sizes/double-block-size-plus-one-file";
+
+	io_args_t args = {
+		.arg1.src = original,
+		.arg2.dst = SANDBOX_PATH "/copy",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(1, args.estim->current_item);
+	assert_int_equal(get_file_size(original), args.estim->current_byte);
+	assert_true(files_are_identical(SANDBOX_PATH "/copy", original));
+
+	ioeta_free(args.estim);
+	delete_test_file(SANDBOX_PATH "/copy");
+}
+
+TEST(fast_file_cloning_falls_back_to_copying)
+{
+	const char *const original = TEST_DATA_PATH "/read/binary-data";
+	int i;
+
+	/* Second time cloning support is taken from cache. */
+	for(i = 0; i < 2; ++i)
+	{
+		io_args_t args = {
+			.arg1.src = original,
+			.arg2.dst = SANDBOX_PATH "/copy",
+			.arg4.fast_file_cloning = 1,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+
+		assert_true(files_are_identical(SANDBOX_PATH "/copy", original));
+		delete_test_file(SANDBOX_PATH "/copy");
+	}
+}
+
 static void
 file_is_copied(const char original[])
 {
@@ -561,6 +619,233 @@ TEST(append_truncates_destination_files_on_error, IF(not_windows))
 	delete_test_file(SANDBOX_PATH "/two-lines");
 }
 
+TEST(holes_of_sparse_files_are_preserved, IF(not_windows))
+{
+	const io_cancellation_t no_cancellation = {};
+	const char *const src = SANDBOX_PATH "/sparse";
+	const char *const dst = SANDBOX_PATH "/sparse-copy";
+	enum { SIZE = 4*1024*1024 };
+	struct stat src_st, dst_st;
+
+	int fd = open(src, O_CREAT | O_WRONLY, 0600);
+	assert_true(fd >= 0);
+	assert_int_equal(4, pwrite(fd, "data", 4, SIZE/2));
+	assert_success(ftruncate(fd, SIZE));
+	assert_success(close(fd));
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg4.sparse_files = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_success(stat(src, &src_st));
+	assert_success(stat(dst, &dst_st));
+	assert_int_equal(SIZE, dst_st.st_size);
+	assert_true(dst_st.st_blocks <= src_st.st_blocks);
+
+	char buf[4];
+	fd = open(dst, O_RDONLY);
+	assert_true(fd >= 0);
+	assert_int_equal(4, pread(fd, buf, 4, SIZE/2));
+	assert_success(close(fd));
+	assert_success(memcmp(buf, "data", 4));
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+TEST(file_is_copied_via_io_uring, IF(not_windows))
+{
+	const io_cancellation_t no_cancellation = {};
+	const char *const src = SANDBOX_PATH "/big";
+	const char *const dst = SANDBOX_PATH "/big-copy";
+	/* More blocks than can be in flight and a partial one at the end. */
+	enum { SIZE = 9*1024*1024 + 123 };
+
+	create_file_of_size(src, SIZE);
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg4.io_uring = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(src, dst));
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+TEST(large_file_is_copied_bypassing_cache, IF(not_windows))
+{
+	const io_cancellation_t no_cancellation = {};
+	const char *const src = SANDBOX_PATH "/big";
+	const char *const dst = SANDBOX_PATH "/big-copy";
+	/* Large enough for direct I/O with a tail that isn't aligned. */
+	enum { SIZE = 64*1024*1024 + 5000 };
+
+	create_file_of_size(src, SIZE);
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg4.bypass_cache = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(src, dst));
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+TEST(copied_data_is_verified, IF(not_windows))
+{
+	const io_cancellation_t no_cancellation = {};
+	const char *const src = SANDBOX_PATH "/file";
+	const char *const dst = SANDBOX_PATH "/file-copy";
+	enum { SIZE = 3*1024*1024 + 77 };
+
+	create_file_of_size(src, SIZE);
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg4.verify_data = 1,
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_int_equal(SIZE, args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_true(files_are_identical(src, dst));
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+TEST(appended_data_is_verified, IF(not_windows))
+{
+	const char *const src = SANDBOX_PATH "/file";
+	const char *const dst = SANDBOX_PATH "/file-copy";
+
+	create_file_of_size(src, 10000);
+	create_file_of_size(dst, 4096);
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg3.crs = IO_CRS_APPEND_TO_FILES,
+		.arg4.verify_data = 1,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, iop_cp(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_true(files_are_identical(src, dst));
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+TEST(mismatch_of_verified_data_fails_copying, IF(not_windows))
+{
+	const char *const src = SANDBOX_PATH "/file";
+	const char *const dst = SANDBOX_PATH "/file-copy";
+
+	create_file_of_size(src, 10000);
+
+	io_args_t args = {
+		.arg1.src = src,
+		.arg2.dst = dst,
+		.arg4.verify_data = 1,
+
+		.cancellation.hook = &corrupt_complete_copy,
+		.cancellation.arg = (void *)dst,
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_FAILED, iop_cp(&args));
+	assert_int_equal(1, args.result.errors.error_count);
+	assert_int_equal(EIO, args.result.errors.errors[0].error_code);
+	assert_string_equal("Copied data doesn't match source file",
+			args.result.errors.errors[0].msg);
+	ioe_errlst_free(&args.result.errors);
+
+	assert_success(remove(src));
+	assert_success(remove(dst));
+}
+
+static void
+create_file_of_size(const char path[], int size)
+{
+	enum { BLOCK = 4096 };
+	char block[BLOCK];
+	int i;
+
+	int fd = open(path, O_CREAT | O_WRONLY, 0600);
+	assert_true(fd >= 0);
+	for(i = 0; i < size; i += BLOCK)
+	{
+		memset(block, 'a' + i/BLOCK%26, BLOCK);
+		const int len = (size - i < BLOCK ? size - i : BLOCK);
+		assert_int_equal(len, write(fd, block, len));
+	}
+	assert_success(close(fd));
+}
+
+/* Cancellation hook that damages destination file (passed in arg) once all of
+ * its data is written, which happens between copying and verification.  Never
+ * requests cancellation. */
+static int
+corrupt_complete_copy(void *arg)
+{
+	const char *const dst = arg;
+
+	struct stat st;
+	if(lstat(dst, &st) == 0 && st.st_size == 10000)
+	{
+		const int fd = open(dst, O_WRONLY);
+		assert_true(fd >= 0);
+		assert_int_equal(1, pwrite(fd, "#", 1, 5000));
+		assert_success(close(fd));
+	}
+	return 0;
+}
+
 #endif
 
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
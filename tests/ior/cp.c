@@ -2,7 +2,7 @@
 
 #include <sys/stat.h> /* stat chmod() */
 #include <sys/types.h> /* stat */
-#include <unistd.h> /* F_OK access() */
+#include <unistd.h> /* F_OK access() link() */
 
 #include <test-utils.h>
 
@@ -15,6 +15,7 @@
 
 static int confirm_overwrite(io_args_t *args, const char src[],
 		const char dst[]);
+static void check_hard_links_are_preserved(int parallel_jobs);
 
 static int confirm_called;
 
@@ -195,6 +196,35 @@ TEST(non_empty_nested_directory_is_copied)
 	}
 }
 
+TEST(tree_is_copied_by_several_jobs)
+{
+	create_non_empty_nested_dir(SANDBOX_PATH "/dir", "nested-dir", "a-file");
+	create_empty_file(SANDBOX_PATH "/dir/b-file");
+	create_empty_file(SANDBOX_PATH "/dir/nested-dir/c-file");
+	clone_file(TEST_DATA_PATH "/read/binary-data", SANDBOX_PATH "/dir/d-file");
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/dir",
+			.arg2.dst = SANDBOX_PATH "/dir-copy",
+			.arg4.parallel_jobs = 3,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_true(file_exists(SANDBOX_PATH "/dir-copy/nested-dir/a-file"));
+	assert_true(file_exists(SANDBOX_PATH "/dir-copy/nested-dir/c-file"));
+	assert_true(file_exists(SANDBOX_PATH "/dir-copy/b-file"));
+	assert_int_equal(get_file_size(TEST_DATA_PATH "/read/binary-data"),
+			get_file_size(SANDBOX_PATH "/dir-copy/d-file"));
+
+	delete_tree(SANDBOX_PATH "/dir");
+	delete_tree(SANDBOX_PATH "/dir-copy");
+}
+
 TEST(fails_to_overwrite_file_by_default)
 {
 	create_empty_file(SANDBOX_PATH "/a-file");
@@ -412,6 +442,34 @@ TEST(merging_overwrites_conflicting_files)
 	}
 }
 
+TEST(appending_merges_directories_and_completes_files)
+{
+	create_empty_dir(SANDBOX_PATH "/from");
+	make_file(SANDBOX_PATH "/from/partial", "abcd");
+	make_file(SANDBOX_PATH "/from/missing", "ab");
+
+	create_empty_dir(SANDBOX_PATH "/to");
+	make_file(SANDBOX_PATH "/to/partial", "ab");
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/from",
+			.arg2.dst = SANDBOX_PATH "/to",
+			.arg3.crs = IO_CRS_APPEND_TO_FILES,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	assert_int_equal(4, get_file_size(SANDBOX_PATH "/to/partial"));
+	assert_int_equal(2, get_file_size(SANDBOX_PATH "/to/missing"));
+
+	delete_tree(SANDBOX_PATH "/from");
+	delete_tree(SANDBOX_PATH "/to");
+}
+
 TEST(fails_to_copy_directory_inside_itself)
 {
 	create_empty_dir(SANDBOX_PATH "/empty-dir");
@@ -652,6 +710,54 @@ TEST(symlink_to_dir_is_symlink_after_copy, IF(not_windows))
 	}
 }
 
+TEST(hard_links_are_preserved, IF(not_windows))
+{
+	check_hard_links_are_preserved(/*parallel_jobs=*/0);
+}
+
+TEST(hard_links_are_preserved_by_several_jobs, IF(not_windows))
+{
+	check_hard_links_are_preserved(/*parallel_jobs=*/3);
+}
+
+static void
+check_hard_links_are_preserved(int parallel_jobs)
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	clone_file(TEST_DATA_PATH "/read/binary-data", SANDBOX_PATH "/dir/a");
+	assert_success(link(SANDBOX_PATH "/dir/a", SANDBOX_PATH "/dir/b"));
+	assert_success(link(SANDBOX_PATH "/dir/a", SANDBOX_PATH "/dir/sub/c"));
+	clone_file(TEST_DATA_PATH "/read/binary-data", SANDBOX_PATH "/dir/d");
+
+	{
+		io_args_t args = {
+			.arg1.src = SANDBOX_PATH "/dir",
+			.arg2.dst = SANDBOX_PATH "/dir-copy",
+			.arg4.parallel_jobs = parallel_jobs,
+		};
+		ioe_errlst_init(&args.result.errors);
+
+		assert_int_equal(IO_RES_SUCCEEDED, ior_cp(&args));
+		assert_int_equal(0, args.result.errors.error_count);
+	}
+
+	struct stat a, b, c, d;
+	assert_success(os_lstat(SANDBOX_PATH "/dir-copy/a", &a));
+	assert_success(os_lstat(SANDBOX_PATH "/dir-copy/b", &b));
+	assert_success(os_lstat(SANDBOX_PATH "/dir-copy/sub/c", &c));
+	assert_success(os_lstat(SANDBOX_PATH "/dir-copy/d", &d));
+	assert_int_equal(3, a.st_nlink);
+	assert_true(a.st_ino == b.st_ino);
+	assert_true(a.st_ino == c.st_ino);
+	assert_int_equal(1, d.st_nlink);
+	assert_int_equal(get_file_size(TEST_DATA_PATH "/read/binary-data"),
+			a.st_size);
+
+	delete_tree(SANDBOX_PATH "/dir");
+	delete_tree(SANDBOX_PATH "/dir-copy");
+}
+
 static int
 confirm_overwrite(io_args_t *args, const char src[], const char dst[])
 {
@@ -73,6 +73,31 @@ TEST(path_in_errors_has_no_double_slashes, IF(regular_unix_user))
 	delete_dir(SANDBOX_PATH "/dir2");
 }
 
+TEST(tree_removal_error_is_reported_with_full_path, IF(regular_unix_user))
+{
+	io_args_t args = {
+		.arg1.path = SANDBOX_PATH "/dir",
+
+		.result.errors = IOE_ERRLST_INIT,
+	};
+
+	assert_success(os_mkdir(SANDBOX_PATH "/dir", 0700));
+	assert_success(os_mkdir(SANDBOX_PATH "/dir/sub", 0700));
+	create_empty_file(SANDBOX_PATH "/dir/sub/file");
+	assert_success(chmod(SANDBOX_PATH "/dir/sub", 0500));
+
+	assert_int_equal(IO_RES_FAILED, ior_rm(&args));
+	assert_int_equal(1, args.result.errors.error_count);
+	assert_string_equal(SANDBOX_PATH "/dir/sub/file",
+			args.result.errors.errors[0].path);
+	ioe_errlst_free(&args.result.errors);
+
+	assert_success(chmod(SANDBOX_PATH "/dir/sub", 0700));
+	delete_file(SANDBOX_PATH "/dir/sub/file");
+	delete_dir(SANDBOX_PATH "/dir/sub");
+	delete_dir(SANDBOX_PATH "/dir");
+}
+
 static IoErrCbResult
 handle_errors(struct io_args_t *args, const ioe_err_t *err)
 {
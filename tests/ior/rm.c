@@ -2,7 +2,13 @@
 
 #include <unistd.h> /* F_OK access() */
 
+#include <stdio.h> /* snprintf() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
+#include "../../src/io/ioeta.h"
 #include "../../src/io/ior.h"
 #include "../../src/utils/fs.h"
 
@@ -65,5 +71,70 @@ TEST(non_empty_directory_is_removed)
 	assert_failure(access(DIRECTORY_NAME, F_OK));
 }
 
+TEST(tree_is_removed_with_progress)
+{
+	const io_cancellation_t no_cancellation = {};
+	char path[PATH_MAX + 1];
+	int i, j;
+
+	create_empty_dir(SANDBOX_PATH "/tree");
+	for(i = 0; i < 3; ++i)
+	{
+		snprintf(path, sizeof(path), SANDBOX_PATH "/tree/%d", i);
+		create_empty_dir(path);
+		for(j = 0; j < 3; ++j)
+		{
+			snprintf(path, sizeof(path), SANDBOX_PATH "/tree/%d/%d", i, j);
+			create_empty_dir(path);
+			snprintf(path, sizeof(path), SANDBOX_PATH "/tree/%d/%d/file", i, j);
+			create_empty_file(path);
+		}
+		snprintf(path, sizeof(path), SANDBOX_PATH "/tree/%d/file", i);
+		clone_file(TEST_DATA_PATH "/read/two-lines", path);
+	}
+
+	io_args_t args = {
+		.arg1.path = SANDBOX_PATH "/tree",
+
+		.estim = ioeta_alloc(NULL, no_cancellation),
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	/* 1 + 3 + 3*3 directories and 3*3 + 3 files. */
+	assert_int_equal(25, args.estim->current_item);
+	assert_int_equal(3*get_file_size(TEST_DATA_PATH "/read/two-lines"),
+			args.estim->current_byte);
+	ioeta_free(args.estim);
+
+	assert_false(file_exists(SANDBOX_PATH "/tree"));
+}
+
+TEST(symlinks_to_directories_in_tree_are_not_followed, IF(not_windows))
+{
+	create_empty_dir(SANDBOX_PATH "/outside");
+	create_empty_file(SANDBOX_PATH "/outside/file");
+	create_empty_dir(SANDBOX_PATH "/tree");
+	create_empty_dir(SANDBOX_PATH "/tree/dir");
+	assert_success(make_symlink(SANDBOX_PATH "/outside",
+				SANDBOX_PATH "/tree/dir/link"));
+
+	io_args_t args = {
+		.arg1.path = SANDBOX_PATH "/tree",
+	};
+	ioe_errlst_init(&args.result.errors);
+
+	assert_int_equal(IO_RES_SUCCEEDED, ior_rm(&args));
+	assert_int_equal(0, args.result.errors.error_count);
+
+	assert_false(file_exists(SANDBOX_PATH "/tree"));
+	assert_true(file_exists(SANDBOX_PATH "/outside/file"));
+
+	remove_file(SANDBOX_PATH "/outside/file");
+	remove_dir(SANDBOX_PATH "/outside");
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
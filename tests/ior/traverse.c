@@ -0,0 +1,162 @@
+#include <stic.h>
+
+#include <sys/stat.h> /* stat */
+#include <dirent.h> /* DT_DIR */
+#include <fcntl.h> /* AT_SYMLINK_NOFOLLOW fstatat() */
+#include <unistd.h> /* chdir() symlink() */
+
+#include <string.h> /* strcat() strlen() strrchr() */
+
+#include <test-utils.h>
+
+#include "../../src/compat/dtype.h"
+#include "../../src/compat/fs_limits.h"
+#include "../../src/io/private/traverser.h"
+#include "../../src/utils/fs.h"
+
+#include "utils.h"
+
+static VisitResult log_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param);
+static VisitResult count_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param);
+
+/* Log of visitation. */
+static char log_buf[1024];
+
+/* Number of directories entered and left. */
+static int entered, left;
+
+SETUP()
+{
+	log_buf[0] = '\0';
+	entered = 0;
+	left = 0;
+}
+
+TEST(root_file_is_visited_as_file)
+{
+	create_empty_file(SANDBOX_PATH "/file");
+
+	assert_int_equal(IO_RES_SUCCEEDED,
+			traverse_ex(SANDBOX_PATH "/file", TF_STAT, &log_visitor, NULL));
+	assert_string_equal("F(file)", log_buf);
+
+	delete_file(SANDBOX_PATH "/file");
+}
+
+TEST(tree_is_visited_in_depth_first_order)
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	create_empty_file(SANDBOX_PATH "/dir/sub/file");
+
+	assert_int_equal(IO_RES_SUCCEEDED,
+			traverse_ex(SANDBOX_PATH "/dir", TF_STAT, &log_visitor, NULL));
+	assert_string_equal("E(dir)E(sub)F(file)L(sub)L(dir)", log_buf);
+
+	delete_tree(SANDBOX_PATH "/dir");
+}
+
+TEST(symlink_to_dir_is_visited_as_file, IF(not_windows))
+{
+	create_dir(SANDBOX_PATH "/dir");
+	create_dir(SANDBOX_PATH "/dir/sub");
+	assert_success(symlink("sub", SANDBOX_PATH "/dir/link"));
+	delete_dir(SANDBOX_PATH "/dir/sub");
+
+	assert_int_equal(IO_RES_SUCCEEDED,
+			traverse_ex(SANDBOX_PATH "/dir", TF_STAT, &log_visitor, NULL));
+	assert_string_equal("E(dir)F(link)L(dir)", log_buf);
+
+	delete_file(SANDBOX_PATH "/dir/link");
+	delete_dir(SANDBOX_PATH "/dir");
+}
+
+TEST(deep_tree_is_traversed, IF(not_windows))
+{
+	enum { DEPTH = 200 };
+
+	char *const saved_cwd = save_cwd();
+
+	char root[PATH_MAX + 1];
+	make_abs_path(root, sizeof(root), SANDBOX_PATH, "dir", saved_cwd);
+	create_dir(root);
+	assert_success(chdir(root));
+
+	/* Relative paths are used to not hit limit on path length. */
+	int i;
+	for(i = 1; i < DEPTH; ++i)
+	{
+		create_dir("d");
+		assert_success(chdir("d"));
+	}
+
+	restore_cwd(saved_cwd);
+
+	assert_int_equal(IO_RES_SUCCEEDED,
+			traverse_ex(root, TF_NONE, &count_visitor, NULL));
+	assert_int_equal(DEPTH, entered);
+	assert_int_equal(DEPTH, left);
+
+	delete_tree(root);
+}
+
+/* Logs actions and checks consistency of entries.  Returns VR_OK. */
+static VisitResult
+log_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
+{
+	const char *const name = (entry->dir_fd == -1)
+	                        ? strrchr(entry->name, '/') + 1
+	                        : entry->name;
+
+	/* Name matches the tail of the path. */
+	assert_string_equal(name, full_path + strlen(full_path) - strlen(name));
+
+	switch(action)
+	{
+		case VA_DIR_ENTER:
+			assert_int_equal(DT_DIR, entry->type);
+			strcat(log_buf, "E(");
+			break;
+		case VA_FILE:
+			strcat(log_buf, "F(");
+			break;
+		case VA_DIR_LEAVE:
+			assert_null(entry->st);
+			strcat(log_buf, "L(");
+			break;
+	}
+	strcat(log_buf, name);
+	strcat(log_buf, ")");
+
+#ifndef _WIN32
+	if(action != VA_DIR_LEAVE)
+	{
+		assert_non_null(entry->st);
+
+		/* Descriptor allows querying information relative to it. */
+		struct stat st;
+		assert_success(fstatat(entry->dir_fd == -1 ? AT_FDCWD : entry->dir_fd,
+					entry->name, &st, AT_SYMLINK_NOFOLLOW));
+		assert_true(st.st_ino == entry->st->st_ino);
+	}
+#endif
+
+	return VR_OK;
+}
+
+/* Counts directories.  Returns VR_OK. */
+static VisitResult
+count_visitor(const char full_path[], VisitAction action,
+		const visit_entry_t *entry, void *param)
+{
+	assert_null(entry->st);
+	entered += (action == VA_DIR_ENTER);
+	left += (action == VA_DIR_LEAVE);
+	return VR_OK;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
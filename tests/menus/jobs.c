@@ -2,8 +2,11 @@
 
 #include <unistd.h> /* usleep() */
 
+#include <stdlib.h> /* free() */
+
 #include <test-utils.h>
 
+#include "../../src/cfg/config.h"
 #include "../../src/compat/pthread.h"
 #include "../../src/engine/cmds.h"
 #include "../../src/engine/keys.h"
@@ -11,9 +14,11 @@
 #include "../../src/modes/modes.h"
 #include "../../src/modes/wk.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/str.h"
 #include "../../src/background.h"
 #include "../../src/cmd_core.h"
+#include "../../src/journal.h"
 #include "../../src/status.h"
 
 static void task(bg_op_t *bg_op, void *arg);
@@ -116,6 +121,31 @@ TEST(e_press_with_errors)
 	assert_int_equal(1, menu_get_current()->len);
 }
 
+TEST(interrupted_operations_are_listed_and_can_be_discarded)
+{
+	char *const saved_cwd = save_cwd();
+	make_abs_path(cfg.journal_dir, sizeof(cfg.journal_dir), SANDBOX_PATH,
+			"journal", saved_cwd);
+	free(saved_cwd);
+
+	char *src[] = { "/src" };
+	char *dst[] = { "/dst" };
+	journal_free(journal_create("descr", /*move=*/0, JC_FAIL, src, dst, 1));
+
+	(void)vle_keys_exec(WK_r);
+	assert_int_equal(2, menu_get_current()->len);
+	assert_string_equal("1/0       job", menu_get_current()->items[0]);
+	assert_string_equal("0/1       (interrupted) descr",
+			menu_get_current()->items[1]);
+
+	(void)vle_keys_exec(WK_j WK_d WK_d);
+	assert_int_equal(1, menu_get_current()->len);
+	assert_string_equal("1/0       job", menu_get_current()->items[0]);
+
+	remove_dir(SANDBOX_PATH "/journal");
+	cfg.journal_dir[0] = '\0';
+}
+
 static void
 task(bg_op_t *bg_op, void *arg)
 {
@@ -6,6 +6,7 @@
 
 #include <test-utils.h>
 
+#include "../../src/cfg/config.h"
 #include "../../src/compat/pthread.h"
 #include "../../src/engine/var.h"
 #include "../../src/engine/variables.h"
@@ -19,6 +20,13 @@
 static void on_job_exit(struct bg_job_t *job, void *data);
 static void task(bg_op_t *bg_op, void *arg);
 static void wait_until_locked(pthread_spinlock_t *lock);
+static void gate_task(bg_op_t *bg_op, void *arg);
+static void order_task(bg_op_t *bg_op, void *arg);
+static void dev_slot_task(bg_op_t *bg_op, void *arg);
+static void wait_for_value(int *value, int expected);
+
+/* Counter of finished order_task() invocations. */
+static int finished;
 
 SETUP_ONCE()
 {
@@ -264,6 +272,118 @@ TEST(background_redirects_streams_properly, IF(not_windows))
 	assert_success(bg_and_wait_for_errors("echo a", &no_cancellation));
 }
 
+TEST(finished_task_is_reported_as_an_event)
+{
+	int order = 0;
+	finished = 0;
+
+	bg_check();
+	assert_false(bg_has_events());
+
+	assert_success(bg_execute("", "", 0, 0, &order_task, &order));
+	wait_for_value(&order, 1);
+	wait_for_bg();
+
+	assert_true(bg_has_events());
+	bg_check();
+	assert_false(bg_has_events());
+}
+
+TEST(number_of_running_tasks_is_limited)
+{
+	int gate = 0, order = 0;
+	finished = 0;
+	cfg.bg_jobs = 1;
+
+	assert_success(bg_execute("", "", 0, 0, &gate_task, &gate));
+	wait_for_value(&gate, 1);
+	assert_success(bg_execute("", "", 0, 0, &order_task, &order));
+
+	usleep(50000);
+	assert_int_equal(0, __atomic_load_n(&order, __ATOMIC_ACQUIRE));
+
+	__atomic_store_n(&gate, 2, __ATOMIC_RELEASE);
+	wait_for_value(&order, 1);
+
+	wait_for_bg();
+	cfg.bg_jobs = 0;
+}
+
+TEST(tasks_are_started_before_operations)
+{
+	int gate = 0, op_order = 0, task_order = 0;
+	finished = 0;
+	cfg.bg_jobs = 1;
+
+	assert_success(bg_execute("", "", 0, 0, &gate_task, &gate));
+	wait_for_value(&gate, 1);
+	assert_success(bg_execute("", "", 0, 1, &order_task, &op_order));
+	assert_success(bg_execute("", "", 0, 0, &order_task, &task_order));
+
+	__atomic_store_n(&gate, 2, __ATOMIC_RELEASE);
+	wait_for_value(&op_order, 2);
+	assert_int_equal(1, __atomic_load_n(&task_order, __ATOMIC_ACQUIRE));
+
+	wait_for_bg();
+	cfg.bg_jobs = 0;
+}
+
+TEST(operations_on_the_same_device_are_limited)
+{
+	int gates[2] = { 0, 0 };
+	int same_dev_order = 0, no_dev_order = 0;
+	finished = 0;
+	cfg.bg_jobs = 8;
+
+	assert_success(bg_execute_on(SANDBOX_PATH, "", "", 0, 1, &gate_task,
+				&gates[0]));
+	assert_success(bg_execute_on(SANDBOX_PATH, "", "", 0, 1, &gate_task,
+				&gates[1]));
+	wait_for_value(&gates[0], 1);
+	wait_for_value(&gates[1], 1);
+
+	assert_success(bg_execute_on(SANDBOX_PATH, "", "", 0, 1, &order_task,
+				&same_dev_order));
+	assert_success(bg_execute_on(NULL, "", "", 0, 1, &order_task,
+				&no_dev_order));
+	wait_for_value(&no_dev_order, 1);
+
+	usleep(50000);
+	assert_int_equal(0, __atomic_load_n(&same_dev_order, __ATOMIC_ACQUIRE));
+
+	__atomic_store_n(&gates[0], 2, __ATOMIC_RELEASE);
+	wait_for_value(&same_dev_order, 2);
+
+	__atomic_store_n(&gates[1], 2, __ATOMIC_RELEASE);
+	wait_for_bg();
+	cfg.bg_jobs = 0;
+}
+
+TEST(files_written_to_the_same_device_are_limited)
+{
+	int acquired = 0;
+	cfg.bg_jobs = 8;
+
+	bg_dev_acquire((dev_t)1, 2);
+	bg_dev_acquire((dev_t)1, 2);
+
+	assert_success(bg_execute("", "", 0, 1, &dev_slot_task, &acquired));
+
+	/* Other devices aren't affected. */
+	bg_dev_acquire((dev_t)2, 2);
+	bg_dev_release((dev_t)2);
+
+	usleep(50000);
+	assert_int_equal(0, __atomic_load_n(&acquired, __ATOMIC_ACQUIRE));
+
+	bg_dev_release((dev_t)1);
+	wait_for_value(&acquired, 1);
+	bg_dev_release((dev_t)1);
+
+	wait_for_bg();
+	cfg.bg_jobs = 0;
+}
+
 static void
 task(bg_op_t *bg_op, void *arg)
 {
@@ -284,5 +404,50 @@ wait_until_locked(pthread_spinlock_t *lock)
 	}
 }
 
+/* Reports being started by setting *arg to 1 and waits until it's set to 2. */
+static void
+gate_task(bg_op_t *bg_op, void *arg)
+{
+	int *gate = arg;
+	__atomic_store_n(gate, 1, __ATOMIC_RELEASE);
+	while(__atomic_load_n(gate, __ATOMIC_ACQUIRE) != 2)
+	{
+		usleep(1000);
+	}
+}
+
+/* Records order in which it was run into *arg. */
+static void
+order_task(bg_op_t *bg_op, void *arg)
+{
+	const int order = __atomic_add_fetch(&finished, 1, __ATOMIC_SEQ_CST);
+	__atomic_store_n((int *)arg, order, __ATOMIC_RELEASE);
+}
+
+/* Takes a slot of device #1 and sets *arg to one. */
+static void
+dev_slot_task(bg_op_t *bg_op, void *arg)
+{
+	bg_dev_acquire((dev_t)1, 2);
+	__atomic_store_n((int *)arg, 1, __ATOMIC_RELEASE);
+	bg_dev_release((dev_t)1);
+}
+
+/* Waits until *value becomes equal to expected. */
+static void
+wait_for_value(int *value, int expected)
+{
+	int counter = 0;
+	while(__atomic_load_n(value, __ATOMIC_ACQUIRE) != expected)
+	{
+		usleep(5000);
+		if(++counter > 100)
+		{
+			assert_fail("Waiting for too long.");
+			return;
+		}
+	}
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -10,6 +10,7 @@
 
 #include "../../src/ui/ui.h"
 #include "../../src/compare.h"
+#include "../../src/filelist.h"
 
 /* These tests are about comparison strategies and not about handling of unusual
  * situations or results of operations in compare views. */
@@ -449,5 +450,178 @@ TEST(content_difference_is_detected)
 	remove_dir(SANDBOX_PATH "/b");
 }
 
+TEST(partial_single_pane_compare_lists_processed_files)
+{
+	copy_file(TEST_DATA_PATH "/read/dos-eof", SANDBOX_PATH "/dos-eof-1");
+	copy_file(TEST_DATA_PATH "/read/dos-eof", SANDBOX_PATH "/dos-eof-2");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-1");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-2");
+
+	cancel_countdown = 3;
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	assert_true(compare_one_pane(&lwin, CT_CONTENTS, LT_ALL, CF_NONE));
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_string_equal("partial compare", lwin.custom.title);
+	assert_int_equal(3, lwin.list_rows);
+	assert_string_equal("dos-eof-1", lwin.dir_entry[0].name);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_string_equal("utf8-bom-1", lwin.dir_entry[2].name);
+	assert_int_equal(2, lwin.dir_entry[2].id);
+
+	assert_success(remove(SANDBOX_PATH "/dos-eof-1"));
+	assert_success(remove(SANDBOX_PATH "/dos-eof-2"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-1"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-2"));
+}
+
+TEST(partial_single_pane_unique_is_not_listed)
+{
+	copy_file(TEST_DATA_PATH "/read/dos-eof", SANDBOX_PATH "/dos-eof");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-1");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-2");
+
+	cancel_countdown = 2;
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	assert_true(compare_one_pane(&lwin, CT_CONTENTS, LT_UNIQUE, CF_NONE));
+
+	assert_false(flist_custom_active(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/dos-eof"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-1"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-2"));
+}
+
+TEST(partial_two_panes_compare_leaves_out_unprocessed_matches)
+{
+	/* Three files on the left and the first two on the right. */
+	cancel_countdown = 5;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_true(compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW));
+
+	check_compare_invariants(2);
+	assert_string_equal("partial diff", lwin.custom.title);
+
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
+	assert_string_equal("", lwin.dir_entry[1].name);
+	assert_string_equal("same-content-different-name-2", rwin.dir_entry[1].name);
+}
+
+TEST(partial_two_panes_compare_by_paths_keeps_processed_paths)
+{
+	/* Three files on the left and the first three on the right. */
+	cancel_countdown = 6;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_true(compare_two_panes(CT_CONTENTS, LT_ALL, CF_GROUP_PATHS | CF_SHOW));
+
+	assert_int_equal(3, lwin.list_rows);
+	assert_int_equal(3, rwin.list_rows);
+	assert_string_equal("partial diff", lwin.custom.title);
+
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
+	assert_string_equal("", lwin.dir_entry[1].name);
+	assert_string_equal("same-content-different-name-2", rwin.dir_entry[1].name);
+	assert_string_equal("same-name-different-content", lwin.dir_entry[2].name);
+	assert_string_equal("same-name-different-content", rwin.dir_entry[2].name);
+	assert_true(lwin.dir_entry[2].id != rwin.dir_entry[2].id);
+}
+
+TEST(two_panes_compare_cancelled_on_the_left_is_dropped)
+{
+	cancel_countdown = 2;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_true(compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW));
+
+	assert_false(flist_custom_active(&lwin));
+	assert_false(flist_custom_active(&rwin));
+}
+
+TEST(intermediate_results_do_not_change_two_pane_results)
+{
+	preview_period = 1;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_success(compare_two_panes(CT_CONTENTS, LT_DUPS,
+				CF_GROUP_PATHS | CF_SHOW));
+	preview_period = 256;
+
+	check_compare_invariants(3);
+	assert_string_equal("dups diff", lwin.custom.title);
+	assert_int_equal(2, lwin.custom.diff_stats.identical);
+	assert_int_equal(2, rwin.custom.diff_stats.identical);
+
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
+	assert_string_equal("", lwin.dir_entry[1].name);
+	assert_string_equal("same-content-different-name-2", rwin.dir_entry[1].name);
+	assert_string_equal("same-name-same-content", lwin.dir_entry[2].name);
+	assert_string_equal("same-name-same-content", rwin.dir_entry[2].name);
+}
+
+TEST(intermediate_results_are_replaced_by_partial_two_pane_results)
+{
+	/* Three files on the left and the first two on the right. */
+	preview_period = 1;
+	cancel_countdown = 5;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare/a");
+	strcpy(rwin.curr_dir, TEST_DATA_PATH "/compare/b");
+	assert_true(compare_two_panes(CT_CONTENTS, LT_ALL, CF_SHOW));
+	preview_period = 256;
+
+	check_compare_invariants(2);
+	assert_string_equal("partial diff", lwin.custom.title);
+	assert_int_equal(1, lwin.custom.diff_stats.identical);
+	assert_int_equal(1, lwin.custom.diff_stats.unique_right);
+
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_string_equal("same-content-different-name-1", rwin.dir_entry[0].name);
+	assert_string_equal("", lwin.dir_entry[1].name);
+	assert_string_equal("same-content-different-name-2", rwin.dir_entry[1].name);
+}
+
+TEST(intermediate_results_do_not_change_single_pane_results)
+{
+	preview_period = 1;
+	strcpy(lwin.curr_dir, TEST_DATA_PATH "/compare");
+	assert_success(compare_one_pane(&lwin, CT_CONTENTS, LT_DUPS, CF_NONE));
+	preview_period = 256;
+
+	assert_int_equal(CV_COMPARE, lwin.custom.type);
+	assert_string_equal("dups", lwin.custom.title);
+	assert_int_equal(5, lwin.list_rows);
+	assert_string_equal("same-content-different-name-1", lwin.dir_entry[0].name);
+	assert_int_equal(1, lwin.dir_entry[0].id);
+	assert_int_equal(1, lwin.dir_entry[1].id);
+	assert_int_equal(1, lwin.dir_entry[2].id);
+	assert_string_equal("same-name-same-content", lwin.dir_entry[3].name);
+	assert_int_equal(2, lwin.dir_entry[3].id);
+	assert_int_equal(2, lwin.dir_entry[4].id);
+}
+
+TEST(no_intermediate_results_for_single_pane_unique)
+{
+	copy_file(TEST_DATA_PATH "/read/dos-eof", SANDBOX_PATH "/dos-eof");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-1");
+	copy_file(TEST_DATA_PATH "/read/utf8-bom", SANDBOX_PATH "/utf8-bom-2");
+
+	preview_period = 1;
+	cancel_countdown = 3;
+	strcpy(lwin.curr_dir, SANDBOX_PATH);
+	assert_true(compare_one_pane(&lwin, CT_CONTENTS, LT_UNIQUE, CF_NONE));
+	preview_period = 256;
+
+	assert_false(flist_custom_active(&lwin));
+
+	assert_success(remove(SANDBOX_PATH "/dos-eof"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-1"));
+	assert_success(remove(SANDBOX_PATH "/utf8-bom-2"));
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 : */
@@ -1,6 +1,7 @@
 #include <stic.h>
 
 #include <stddef.h> /* NULL */
+#include <stdio.h> /* rename() snprintf() */
 #include <string.h> /* memset() strcpy() */
 #include <time.h> /* time() */
 
@@ -8,10 +9,19 @@
 
 #include "../../src/cfg/config.h"
 #include "../../src/compat/os.h"
+#include "../../src/compat/pthread.h"
 #include "../../src/ui/ui.h"
+#include "../../src/utils/fs.h"
 #include "../../src/utils/str.h"
 #include "../../src/status.h"
 
+/* Number of threads in concurrent tests. */
+#define NTHREADS 4
+/* Number of updates made by each thread in concurrent tests. */
+#define NUPDATES 1000
+
+static void * update_sizes(void *arg);
+
 SETUP()
 {
 	update_string(&cfg.shell, "");
@@ -21,6 +31,8 @@ SETUP()
 TEARDOWN()
 {
 	update_string(&cfg.shell, NULL);
+	cfg.config_dir[0] = '\0';
+	cfg.dir_size_cache = 0;
 }
 
 TEST(size_does_not_clobber_nitems)
@@ -114,6 +126,121 @@ TEST(symlink_inode_resolution, IF(not_windows))
 	remove_dir(SANDBOX_PATH "/dir");
 }
 
+TEST(sizes_are_preserved_between_runs)
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.dir_size_cache = 10;
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, 11);
+	dcache_store();
+	assert_success(stats_reset(&cfg));
+
+	uint64_t size, nitems;
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, &nitems);
+	assert_ulong_equal(10, size);
+	assert_ulong_equal(DCACHE_UNKNOWN, nitems);
+
+	remove_file(SANDBOX_PATH "/dirsizes");
+}
+
+TEST(only_newest_sizes_are_preserved)
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.dir_size_cache = 1;
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN);
+	dcache_set_at(TEST_DATA_PATH "/rename", 0, 20, DCACHE_UNKNOWN);
+	dcache_set_size_timestamp(TEST_DATA_PATH "/read", time(NULL) - 100);
+	dcache_store();
+	assert_success(stats_reset(&cfg));
+
+	uint64_t size;
+	dcache_get_at(TEST_DATA_PATH "/read", 0, 0, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	dcache_get_at(TEST_DATA_PATH "/rename", 0, 0, &size, NULL);
+	assert_ulong_equal(20, size);
+
+	remove_file(SANDBOX_PATH "/dirsizes");
+}
+
+TEST(sizes_stored_by_other_instances_are_kept)
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+	cfg.dir_size_cache = 10;
+
+	/* Another instance stores its cache. */
+	dcache_set_at(TEST_DATA_PATH "/rename", 0, 20, DCACHE_UNKNOWN);
+	dcache_store();
+	assert_success(rename(SANDBOX_PATH "/dirsizes", SANDBOX_PATH "/other"));
+	assert_success(stats_reset(&cfg));
+
+	/* This instance reads the cache before the other one stores it. */
+	uint64_t size;
+	dcache_get_at(TEST_DATA_PATH "/read", 0, 0, &size, NULL);
+	assert_ulong_equal(DCACHE_UNKNOWN, size);
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, DCACHE_UNKNOWN);
+	assert_success(rename(SANDBOX_PATH "/other", SANDBOX_PATH "/dirsizes"));
+	dcache_store();
+	assert_success(stats_reset(&cfg));
+
+	dcache_get_at(TEST_DATA_PATH "/read", time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(10, size);
+	dcache_get_at(TEST_DATA_PATH "/rename", time(NULL) - 10, 0, &size, NULL);
+	assert_ulong_equal(20, size);
+
+	remove_file(SANDBOX_PATH "/dirsizes");
+}
+
+TEST(sizes_are_not_stored_by_default)
+{
+	copy_str(cfg.config_dir, sizeof(cfg.config_dir), SANDBOX_PATH);
+
+	dcache_set_at(TEST_DATA_PATH "/read", 0, 10, 11);
+	dcache_store();
+
+	assert_false(path_exists(SANDBOX_PATH "/dirsizes", NODEREF));
+}
+
+TEST(parent_sizes_are_updated_concurrently)
+{
+	create_dir(SANDBOX_PATH "/top");
+	dcache_set_at(SANDBOX_PATH "/top", 0, 100, DCACHE_UNKNOWN);
+
+	int i;
+	pthread_t ids[NTHREADS];
+	for(i = 0; i < NTHREADS; ++i)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), SANDBOX_PATH "/top/%d", i);
+		create_dir(path);
+	}
+	for(i = 0; i < NTHREADS; ++i)
+	{
+		assert_success(pthread_create(&ids[i], NULL, &update_sizes,
+					(void *)(long)i));
+	}
+	for(i = 0; i < NTHREADS; ++i)
+	{
+		assert_success(pthread_join(ids[i], NULL));
+	}
+
+	uint64_t size;
+	dcache_get_at(SANDBOX_PATH "/top", 0, 0, &size, NULL);
+	assert_ulong_equal(100 + NTHREADS*NUPDATES, size);
+
+	for(i = 0; i < NTHREADS; ++i)
+	{
+		char path[64];
+		snprintf(path, sizeof(path), SANDBOX_PATH "/top/%d", i);
+
+		dcache_get_at(path, 0, 0, &size, NULL);
+		assert_ulong_equal(NUPDATES - 1, size);
+
+		remove_dir(path);
+	}
+	remove_dir(SANDBOX_PATH "/top");
+}
+
 /* dir_entry_t::inode doesn't exist on Windows. */
 #ifndef _WIN32
 
@@ -139,5 +266,26 @@ TEST(inode_is_taken_into_account)
 
 #endif
 
+/* Sets sizes of a subdirectory and propagates them to its parents.  Returns
+ * NULL. */
+static void *
+update_sizes(void *arg)
+{
+	char path[64];
+	snprintf(path, sizeof(path), SANDBOX_PATH "/top/%d", (int)(long)arg);
+
+	int i;
+	for(i = 0; i < NUPDATES; ++i)
+	{
+		dcache_set_at(path, 0, i, DCACHE_UNKNOWN);
+		dcache_update_parent_sizes(path, 1);
+
+		uint64_t size;
+		dcache_get_at(path, 0, 0, &size, NULL);
+	}
+
+	return NULL;
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
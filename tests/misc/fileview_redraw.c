@@ -0,0 +1,309 @@
+#include <stic.h>
+
+#include <curses.h>
+
+#include <stdio.h> /* FILE fclose() fopen() snprintf() */
+#include <stdlib.h> /* free() */
+#include <string.h> /* memcmp() strdup() */
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/ui/color_scheme.h"
+#include "../../src/ui/column_view.h"
+#include "../../src/ui/fileview.h"
+#include "../../src/ui/ui.h"
+#include "../../src/utils/dynarray.h"
+#include "../../src/filelist.h"
+#include "../../src/opt_handlers.h"
+#include "../../src/status.h"
+
+/* Size of the window of the view. */
+#define ROWS 10
+#define COLS 30
+
+static int have_screen(void);
+static void set_files(int count);
+static void check_matches_full_redraw(void);
+static void snapshot(chtype shot[ROWS][COLS + 1]);
+
+static SCREEN *screen;
+static FILE *term_out;
+static FILE *term_in;
+
+SETUP_ONCE()
+{
+	term_out = fopen("/dev/null", "w");
+	term_in = fopen("/dev/null", "r");
+	if(term_out != NULL && term_in != NULL)
+	{
+		screen = newterm("xterm", term_out, term_in);
+	}
+}
+
+TEARDOWN_ONCE()
+{
+	if(screen != NULL)
+	{
+		endwin();
+		delscreen(screen);
+		screen = NULL;
+	}
+	if(term_out != NULL)
+	{
+		fclose(term_out);
+	}
+	if(term_in != NULL)
+	{
+		fclose(term_in);
+	}
+}
+
+SETUP()
+{
+	if(screen == NULL)
+	{
+		return;
+	}
+
+	view_setup(&lwin);
+	view_setup(&rwin);
+	curr_view = &lwin;
+	other_view = &rwin;
+
+	opt_handlers_setup();
+	fview_setup();
+
+	cfg.display_statusline = 0;
+	cfg.scroll_off = 0;
+	curr_stats.load_stage = 2;
+	fview_draw_in_tests = 1;
+
+	lwin.columns = columns_create();
+	load_view_columns_option(&lwin, "-{name}");
+
+	lwin.win = newwin(ROWS, COLS, 0, 0);
+	lwin.title = newwin(1, COLS, 0, 0);
+	lwin.window_rows = ROWS;
+	lwin.window_cols = COLS;
+	lwin.window_cells = ROWS;
+	lwin.column_count = 1;
+	lwin.run_size = 1;
+
+	set_files(100);
+	lwin.list_pos = 0;
+	lwin.top_line = 0;
+	lwin.curr_line = 0;
+	lwin.num_type = NT_NONE;
+	draw_dir_list(&lwin);
+}
+
+TEARDOWN()
+{
+	if(screen == NULL)
+	{
+		return;
+	}
+
+	fview_draw_in_tests = 0;
+	curr_stats.load_stage = 0;
+
+	delwin(lwin.win);
+	delwin(lwin.title);
+	lwin.win = NULL;
+	lwin.title = NULL;
+
+	columns_free(lwin.columns);
+	lwin.columns = NULL;
+	columns_teardown();
+
+	opt_handlers_teardown();
+
+	view_teardown(&lwin);
+	view_teardown(&rwin);
+}
+
+TEST(full_redraw_draws_files, IF(have_screen))
+{
+	char line[COLS + 1];
+	assert_int_equal(COLS, mvwinnstr(lwin.win, ROWS - 1, 0, line, COLS));
+	assert_string_starts_with("file009", line);
+}
+
+TEST(scrolling_by_a_line_matches_full_redraw, IF(have_screen))
+{
+	lwin.list_pos = ROWS;
+	fview_position_updated(&lwin);
+	assert_int_equal(1, lwin.top_line);
+	check_matches_full_redraw();
+
+	lwin.list_pos = 0;
+	fview_position_updated(&lwin);
+	assert_int_equal(0, lwin.top_line);
+	check_matches_full_redraw();
+}
+
+TEST(scrolling_by_window_height_matches_full_redraw, IF(have_screen))
+{
+	lwin.list_pos = 2*ROWS - 1;
+	fview_position_updated(&lwin);
+	assert_int_equal(ROWS, lwin.top_line);
+	check_matches_full_redraw();
+
+	lwin.list_pos = 5*ROWS;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+
+	lwin.list_pos = 0;
+	fview_position_updated(&lwin);
+	assert_int_equal(0, lwin.top_line);
+	check_matches_full_redraw();
+}
+
+TEST(selection_changes_are_drawn_on_scrolling, IF(have_screen))
+{
+	cfg.cs.color[SELECTED_COLOR].attr = A_BOLD;
+
+	lwin.dir_entry[5].selected = 1;
+	lwin.dir_entry[ROWS].selected = 1;
+	lwin.selected_files = 2;
+
+	lwin.list_pos = ROWS;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+
+	lwin.dir_entry[5].selected = 0;
+	lwin.selected_files = 1;
+
+	lwin.list_pos = ROWS + 1;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+
+	cfg.cs.color[SELECTED_COLOR].attr = 0;
+}
+
+TEST(search_match_changes_are_drawn_on_scrolling, IF(have_screen))
+{
+	lwin.dir_entry[3].search_match = 1;
+	lwin.dir_entry[3].match_left = 0;
+	lwin.dir_entry[3].match_right = 4;
+	lwin.matches = 1;
+
+	lwin.list_pos = ROWS;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+
+	lwin.dir_entry[3].search_match = 0;
+	lwin.matches = 0;
+
+	lwin.list_pos = ROWS + 1;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+}
+
+TEST(relative_numbers_are_updated, IF(have_screen))
+{
+	lwin.num_type = NT_REL;
+	draw_dir_list(&lwin);
+
+	lwin.list_pos = 3;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+
+	lwin.list_pos = ROWS + 2;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+}
+
+TEST(erased_window_is_drawn_from_scratch, IF(have_screen))
+{
+	ui_view_erase(&lwin, 0);
+
+	lwin.list_pos = ROWS;
+	fview_position_updated(&lwin);
+	check_matches_full_redraw();
+}
+
+TEST(shrinking_list_clears_stale_rows, IF(have_screen))
+{
+	/* Relative numbers make every movement of the cursor redraw the list. */
+	lwin.num_type = NT_REL;
+	draw_dir_list(&lwin);
+
+	set_files(3);
+	lwin.list_pos = 2;
+	fview_position_updated(&lwin);
+
+	int row;
+	for(row = 3; row < ROWS; ++row)
+	{
+		char line[COLS + 1];
+		assert_int_equal(COLS, mvwinnstr(lwin.win, row, 0, line, COLS));
+		assert_string_equal("                              ", line);
+	}
+
+	check_matches_full_redraw();
+}
+
+/* Replaces list of files of the left view with the specified number of
+ * files. */
+static void
+set_files(int count)
+{
+	int i;
+	for(i = 0; i < lwin.list_rows; ++i)
+	{
+		free(lwin.dir_entry[i].name);
+	}
+	dynarray_free(lwin.dir_entry);
+
+	lwin.list_rows = count;
+	lwin.dir_entry = dynarray_cextend(NULL, count*sizeof(*lwin.dir_entry));
+	for(i = 0; i < count; ++i)
+	{
+		char name[16];
+		snprintf(name, sizeof(name), "file%03d", i);
+		lwin.dir_entry[i].name = strdup(name);
+		lwin.dir_entry[i].type = FT_REG;
+		lwin.dir_entry[i].origin = lwin.curr_dir;
+		lwin.dir_entry[i].hi_num = -1;
+	}
+}
+
+/* Checks that contents of the window doesn't change after drawing it from
+ * scratch. */
+static void
+check_matches_full_redraw(void)
+{
+	chtype before[ROWS][COLS + 1], after[ROWS][COLS + 1];
+
+	snapshot(before);
+	draw_dir_list(&lwin);
+	snapshot(after);
+
+	int row;
+	for(row = 0; row < ROWS; ++row)
+	{
+		assert_int_equal(0, memcmp(before[row], after[row], sizeof(before[row])));
+	}
+}
+
+/* Stores contents of the window of the left view including attributes. */
+static void
+snapshot(chtype shot[ROWS][COLS + 1])
+{
+	int row;
+	for(row = 0; row < ROWS; ++row)
+	{
+		assert_int_equal(COLS, mvwinchnstr(lwin.win, row, 0, shot[row], COLS));
+	}
+}
+
+static int
+have_screen(void)
+{
+	return (screen != NULL);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
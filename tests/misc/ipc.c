@@ -6,6 +6,7 @@
 
 #include <test-utils.h>
 
+#include "../../src/utils/selector.h"
 #include "../../src/utils/str.h"
 #include "../../src/utils/string_array.h"
 #include "../../src/background.h"
@@ -19,6 +20,7 @@ static char * test_ipc_eval_error(const char expr[]);
 static void other_instance(bg_op_t *bg_op, void *arg);
 static int enabled_and_not_in_wine(void);
 static int enabled_and_not_windows(void);
+static int enabled_with_fifos(void);
 
 static const char NAME[] = "vifm-test";
 static int nmessages;
@@ -222,6 +224,36 @@ TEST(checking_ipc_from_ipc_handler_is_noop, IF(enabled_and_not_windows))
 	ipc_free(ipc2);
 }
 
+TEST(descriptor_reports_incoming_messages, IF(enabled_with_fifos))
+{
+	char msg[] = "test message";
+	char *data[] = { msg, NULL };
+
+	ipc_t *const ipc1 = ipc_init(NAME, &test_ipc_args, &test_ipc_eval);
+	ipc_t *const ipc2 = ipc_init(NAME, &test_ipc_args2, &test_ipc_eval);
+
+	const int fd = ipc_get_fd(ipc2);
+	assert_true(fd != -1);
+
+	selector_t *const selector = selector_alloc();
+	assert_non_null(selector);
+	selector_add(selector, fd);
+
+	assert_false(selector_wait(selector, 0));
+	assert_success(ipc_send(ipc1, ipc_get_name(ipc2), data));
+	assert_true(selector_wait(selector, 1000));
+	assert_true(ipc_check(ipc2));
+
+	/* Disconnected client doesn't leave the descriptor in ready state. */
+	assert_false(selector_wait(selector, 0));
+
+	selector_free(selector);
+	ipc_free(ipc1);
+	ipc_free(ipc2);
+
+	assert_int_equal(2, nmessages2);
+}
+
 TEST(no_send_to_self, IF(enabled_and_not_in_wine))
 {
 	char msg[] = "test message";
@@ -318,5 +350,15 @@ enabled_and_not_windows(void)
 #endif
 }
 
+static int
+enabled_with_fifos(void)
+{
+#if !defined(_WIN32) && !defined(__CYGWIN__)
+	return ipc_enabled();
+#else
+	return 0;
+#endif
+}
+
 /* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
 /* vim: set cinoptions+=t0 filetype=c : */
@@ -680,6 +680,30 @@ TEST(autocd)
 	assert_false(cfg.auto_cd);
 }
 
+TEST(bgjobs)
+{
+	assert_success(cmds_dispatch("set bgjobs=4", &lwin, CIT_COMMAND));
+	assert_int_equal(4, cfg.bg_jobs);
+
+	assert_failure(cmds_dispatch("set bgjobs=0", &lwin, CIT_COMMAND));
+	assert_int_equal(4, cfg.bg_jobs);
+
+	assert_success(cmds_dispatch("set bgjobs=8", &lwin, CIT_COMMAND));
+	assert_int_equal(8, cfg.bg_jobs);
+}
+
+TEST(copyjobs)
+{
+	assert_success(cmds_dispatch("set copyjobs=4", &lwin, CIT_COMMAND));
+	assert_int_equal(4, cfg.copy_jobs);
+
+	assert_failure(cmds_dispatch("set copyjobs=0", &lwin, CIT_COMMAND));
+	assert_int_equal(4, cfg.copy_jobs);
+
+	assert_success(cmds_dispatch("set copyjobs=1", &lwin, CIT_COMMAND));
+	assert_int_equal(1, cfg.copy_jobs);
+}
+
 TEST(iooptions)
 {
 	assert_success(cmds_dispatch("set iooptions=fastfilecloning", &lwin,
@@ -690,6 +714,27 @@ TEST(iooptions)
 	assert_success(cmds_dispatch("set iooptions=datasync", &lwin, CIT_COMMAND));
 	assert_false(cfg.fast_file_cloning);
 	assert_true(cfg.data_sync);
+	assert_false(cfg.sparse_files);
+
+	assert_success(cmds_dispatch("set iooptions=sparsefiles", &lwin,
+				CIT_COMMAND));
+	assert_false(cfg.data_sync);
+	assert_true(cfg.sparse_files);
+	assert_false(cfg.io_uring);
+
+	assert_success(cmds_dispatch("set iooptions=iouring", &lwin, CIT_COMMAND));
+	assert_false(cfg.sparse_files);
+	assert_true(cfg.io_uring);
+	assert_false(cfg.bypass_cache);
+
+	assert_success(cmds_dispatch("set iooptions=nocache", &lwin, CIT_COMMAND));
+	assert_false(cfg.io_uring);
+	assert_true(cfg.bypass_cache);
+	assert_false(cfg.verify_copies);
+
+	assert_success(cmds_dispatch("set iooptions=verify", &lwin, CIT_COMMAND));
+	assert_false(cfg.bypass_cache);
+	assert_true(cfg.verify_copies);
 }
 
 TEST(mouse)
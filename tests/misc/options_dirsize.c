@@ -0,0 +1,42 @@
+#include <stic.h>
+
+#include <test-utils.h>
+
+#include "../../src/cfg/config.h"
+#include "../../src/cmd_core.h"
+#include "../../src/ui/ui.h"
+
+SETUP()
+{
+	cmds_init();
+	curr_view = &lwin;
+	opt_handlers_setup();
+}
+
+TEARDOWN()
+{
+	opt_handlers_teardown();
+	curr_view = NULL;
+	vle_cmds_reset();
+}
+
+TEST(dirsizecache)
+{
+	assert_success(cmds_dispatch("set dirsizecache=100", &lwin, CIT_COMMAND));
+	assert_int_equal(100, cfg.dir_size_cache);
+
+	assert_failure(cmds_dispatch("set dirsizecache=-1", &lwin, CIT_COMMAND));
+	assert_int_equal(0, cfg.dir_size_cache);
+}
+
+TEST(dirsizewatch)
+{
+	assert_success(cmds_dispatch("set dirsizewatch=100", &lwin, CIT_COMMAND));
+	assert_int_equal(100, cfg.dir_size_watch);
+
+	assert_failure(cmds_dispatch("set dirsizewatch=-1", &lwin, CIT_COMMAND));
+	assert_int_equal(0, cfg.dir_size_watch);
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 : */
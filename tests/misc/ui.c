@@ -14,6 +14,7 @@
 #include "../../src/ui/ui.h"
 #include "../../src/utils/str.h"
 #include "../../src/filelist.h"
+#include "../../src/status.h"
 
 static void check_tab_title(const tab_info_t *tab_info, const char text[]);
 static char * identity(const char path[]);
@@ -566,6 +567,37 @@ TEST(mouse_map_tlsview)
 	assert_int_equal(FVM_NONE, fview_map_coordinates(&lwin, 6, 5));
 }
 
+TEST(refreshes_within_frames_are_queued)
+{
+	ui_frame_begin();
+	ui_frame_begin();
+
+	ui_refresh_win(lwin.win);
+	assert_true(ui_frame_pending());
+
+	ui_frame_end();
+	assert_true(ui_frame_pending());
+
+	ui_frame_flush();
+	assert_false(ui_frame_pending());
+	assert_true(ui_frame_time_left() <= 16);
+
+	ui_frame_end();
+	assert_false(ui_frame_pending());
+}
+
+TEST(refreshes_of_silenced_ui_are_not_queued)
+{
+	ui_frame_begin();
+
+	stats_silence_ui(1);
+	ui_refresh_win(lwin.win);
+	assert_false(ui_frame_pending());
+	stats_silence_ui(0);
+
+	ui_frame_end();
+}
+
 static void
 check_tab_title(const tab_info_t *tab_info, const char text[])
 {
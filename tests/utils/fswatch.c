@@ -2,6 +2,8 @@
 
 #include <stdio.h> /* remove() snprintf() */
 
+#include <test-utils.h>
+
 #include "../../src/compat/fs_limits.h"
 #include "../../src/compat/os.h"
 #include "../../src/utils/fs.h"
@@ -45,6 +47,61 @@ TEST(two_watches_for_the_same_directory)
 	fswatch_free(watch1);
 }
 
+TEST(events_are_delivered_to_all_watches, IF(using_inotify))
+{
+	assert_success(os_mkdir(SANDBOX_PATH "/testdir", 0700));
+
+	fswatch_t *watch1, *watch2, *watch3;
+	assert_non_null(watch1 = fswatch_create(sandbox));
+	assert_non_null(watch2 = fswatch_create(sandbox));
+	assert_non_null(watch3 = fswatch_create(SANDBOX_PATH "/testdir"));
+
+	create_file(SANDBOX_PATH "/testdir/file");
+
+	/* Polling one watch doesn't lose events of other ones. */
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll(watch1));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch3));
+	assert_int_equal(FSWS_UNCHANGED, fswatch_poll(watch2));
+
+	assert_success(remove(SANDBOX_PATH "/testdir/file"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch3));
+	assert_success(remove(SANDBOX_PATH "/testdir"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch1));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch2));
+	assert_int_equal(FSWS_ERRORED, fswatch_poll(watch3));
+
+	fswatch_free(watch3);
+	fswatch_free(watch2);
+	fswatch_free(watch1);
+}
+
+TEST(freeing_watch_keeps_others_working, IF(using_inotify))
+{
+	fswatch_t *watch1, *watch2;
+	assert_non_null(watch1 = fswatch_create(sandbox));
+	assert_non_null(watch2 = fswatch_create(sandbox));
+	fswatch_free(watch1);
+
+	assert_success(os_mkdir(SANDBOX_PATH "/testdir", 0700));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch2));
+	assert_success(remove(SANDBOX_PATH "/testdir"));
+	assert_int_equal(FSWS_UPDATED, fswatch_poll(watch2));
+
+	fswatch_free(watch2);
+}
+
+TEST(descriptor_is_available_while_there_are_watches, IF(using_inotify))
+{
+	assert_int_equal(-1, fswatch_get_fd());
+
+	fswatch_t *watch;
+	assert_non_null(watch = fswatch_create(sandbox));
+	assert_true(fswatch_get_fd() != -1);
+	fswatch_free(watch);
+
+	assert_int_equal(-1, fswatch_get_fd());
+}
+
 TEST(events_are_accumulated, IF(using_inotify))
 {
 	fswatch_t *watch;
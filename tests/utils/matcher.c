@@ -8,8 +8,10 @@
 
 #include "../../src/int/file_magic.h"
 #include "../../src/utils/fs.h"
+#include "../../src/utils/macros.h"
 #include "../../src/utils/matcher.h"
 #include "../../src/utils/str.h"
+#include "../../src/utils/string_array.h"
 
 static void check_glob(matcher_t *m);
 static void check_fast_globs(matcher_t *m);
@@ -401,6 +403,39 @@ TEST(comma_escaping)
 	matcher_free(m);
 }
 
+TEST(simple_globs_are_extracted)
+{
+	char *error;
+	matcher_t *m;
+	char **globs;
+	int count;
+
+	assert_non_null(m = matcher_alloc("{a,,b,*.ext,*.tar.gz}", 0, 1, "", &error));
+	assert_null(error);
+	globs = matcher_get_simple_globs(m, &count);
+	assert_int_equal(3, count);
+	assert_string_equal("a,b", globs[0]);
+	assert_string_equal("*.ext", globs[1]);
+	assert_string_equal("*.tar.gz", globs[2]);
+	free_string_array(globs, count);
+	matcher_free(m);
+
+	const char *const not_simple[] = {
+		"{*.ext,*rc}", "{*.ext,pre*}", "{*.a*b}", "{mid\\*dle}", "{*.[ch]}",
+		"!{*.ext}", "{{*.ext}}", "/\\.ext$/", "<text/plain>",
+	};
+
+	int i;
+	for(i = 0; i < (int)ARRAY_LEN(not_simple); ++i)
+	{
+		assert_non_null(m = matcher_alloc(not_simple[i], 0, 1, "", &error));
+		assert_null(error);
+		assert_null(matcher_get_simple_globs(m, &count));
+		assert_int_equal(0, count);
+		matcher_free(m);
+	}
+}
+
 TEST(mime_type_pattern, IF(has_mime_type_detection))
 {
 	char *error;
@@ -0,0 +1,153 @@
+#include <stic.h>
+
+#include <unistd.h> /* close() pipe() usleep() write() */
+
+#include <stddef.h> /* NULL */
+
+#include <test-utils.h>
+
+#include "../../src/compat/pthread.h"
+#include "../../src/utils/selector.h"
+
+static void * waker(void *arg);
+
+TEST(timeout_is_reported, IF(not_windows))
+{
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+
+	assert_false(selector_wait(selector, 0));
+	assert_false(selector_wait(selector, 10));
+
+	selector_free(selector);
+}
+
+TEST(ready_item_is_reported, IF(not_windows))
+{
+	int fds[2];
+	assert_success(pipe(fds));
+
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+	selector_add(selector, fds[0]);
+
+	assert_int_equal(1, write(fds[1], "x", 1));
+	assert_true(selector_wait(selector, -1));
+	assert_true(selector_is_ready(selector, fds[0]));
+
+	selector_remove(selector, fds[0]);
+	assert_false(selector_wait(selector, 0));
+
+	selector_free(selector);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+TEST(pending_wake_up_ends_wait, IF(not_windows))
+{
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+
+	selector_wake(selector);
+	selector_wake(selector);
+	assert_true(selector_wait(selector, -1));
+
+	/* Requests aren't accumulated. */
+	assert_false(selector_wait(selector, 0));
+
+	selector_free(selector);
+}
+
+TEST(wake_up_from_another_thread_ends_wait, IF(not_windows))
+{
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+
+	pthread_t id;
+	assert_success(pthread_create(&id, NULL, &waker, selector));
+	assert_true(selector_wait(selector, -1));
+	assert_success(pthread_join(id, NULL));
+
+	selector_free(selector);
+}
+
+TEST(reset_keeps_ability_to_wake_up, IF(not_windows))
+{
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+
+	selector_reset(selector);
+	selector_wake(selector);
+	assert_true(selector_wait(selector, -1));
+
+	selector_free(selector);
+}
+
+TEST(reset_drops_items_that_are_not_added_again, IF(not_windows))
+{
+	int fds1[2], fds2[2];
+	assert_success(pipe(fds1));
+	assert_success(pipe(fds2));
+
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+	selector_add(selector, fds1[0]);
+	selector_add(selector, fds2[0]);
+
+	assert_int_equal(1, write(fds1[1], "x", 1));
+	assert_int_equal(1, write(fds2[1], "x", 1));
+
+	selector_reset(selector);
+	selector_add(selector, fds2[0]);
+
+	assert_true(selector_wait(selector, 0));
+	assert_false(selector_is_ready(selector, fds1[0]));
+	assert_true(selector_is_ready(selector, fds2[0]));
+
+	selector_free(selector);
+	close(fds1[0]);
+	close(fds1[1]);
+	close(fds2[0]);
+	close(fds2[1]);
+}
+
+TEST(reused_descriptor_is_watched_after_reset, IF(not_windows))
+{
+	int fds[2];
+	assert_success(pipe(fds));
+
+	selector_t *selector = selector_alloc();
+	assert_non_null(selector);
+	selector_add(selector, fds[0]);
+	assert_false(selector_wait(selector, 0));
+
+	/* Closing the descriptor removes it from epoll set behind our back. */
+	const int old_fd = fds[0];
+	close(fds[0]);
+	close(fds[1]);
+	assert_success(pipe(fds));
+	assert_int_equal(old_fd, fds[0]);
+
+	selector_reset(selector);
+	selector_add(selector, fds[0]);
+
+	assert_int_equal(1, write(fds[1], "x", 1));
+	assert_true(selector_wait(selector, 0));
+	assert_true(selector_is_ready(selector, fds[0]));
+
+	selector_free(selector);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+/* Wakes up selector after a delay.  Returns NULL. */
+static void *
+waker(void *arg)
+{
+	usleep(10000);
+	selector_wake(arg);
+	return NULL;
+}
+
+/* vim: set tabstop=2 softtabstop=2 shiftwidth=2 noexpandtab cinoptions-=(0 : */
+/* vim: set cinoptions+=t0 filetype=c : */
@@ -90,6 +90,45 @@ TEST(utf8_nstrsw_works, IF(utf8_locale))
 	}
 }
 
+TEST(long_ascii_runs_are_measured_correctly)
+{
+	const char str[] = "0123456789abcdefghij";
+
+	assert_int_equal(20, utf8_strsw(str));
+	assert_int_equal(13, utf8_nstrsw(str, 13));
+	assert_int_equal(13, utf8_strsnlen(str, 13));
+	assert_int_equal(13, utf8_nstrsnlen(str, 13));
+	assert_int_equal(20, utf8_strsnlen(str, 100));
+	assert_int_equal(0, utf8_stro(str));
+	assert_int_equal(0, utf8_strso(str));
+}
+
+TEST(control_characters_break_ascii_runs)
+{
+	const char str[] = "0123456\x01" "89abcdef\x7f";
+
+	assert_int_equal(18, utf8_strsw(str));
+	assert_int_equal(7, utf8_strsnlen(str, 8));
+	assert_int_equal(7, utf8_nstrsnlen(str, 8));
+	assert_int_equal(8, utf8_nstrsnlen(str, 9));
+	assert_int_equal(18, utf8_strsw_with_tabs(str, 8));
+}
+
+TEST(ascii_runs_around_multibyte_characters, IF(utf8_locale))
+{
+	const char str[] = "abcdefghi师jklmnopqrs\xcc\x81t";
+
+	assert_int_equal(22, utf8_strsw(str));
+	assert_int_equal(9, utf8_nstrsw(str, 9));
+	assert_int_equal(11, utf8_nstrsw(str, 10));
+	assert_int_equal(9, utf8_strsnlen(str, 10));
+	assert_int_equal(12, utf8_strsnlen(str, 11));
+	assert_int_equal(strlen(str) - 1, utf8_strsnlen(str, 21));
+	assert_int_equal(strlen(str) - 1, utf8_nstrsnlen(str, 21));
+	assert_int_equal(3, utf8_stro(str));
+	assert_int_equal(3, utf8_strso(str));
+}
+
 #ifdef _WIN32
 
 TEST(utf16_roundtrip, IF(utf8_locale))